@@ -0,0 +1,365 @@
+// Benchmarks that run without a window.
+// Usage: bench.bin [maxThreads]
+//
+// Scaling: a large field of grid instances is projected, culled and turned into
+// screen-space segments with 1, 2, 4, ... threads of the job system.
+// Prints time per frame, throughput and speedup over one thread,
+// and time per frame with the app's major, axis and highlighted lines.
+//
+// Picking: grid cells under many pixels are found with one batched call.
+//
+// Points: a large point cloud is drawn into a pixel buffer, all of it and
+// decimated, by all threads.
+//
+// Bandwidth: a frame-sized buffer is cleared and then filled by copying from
+// another, like reading back a frame. The buffer is allocated each frame, kept
+// from `malloc`, or kept from `Mem_AllocLarge`. Prints GB/s.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "Clock.h"
+#include "Grid.h"
+#include "Jobs.h"
+#include "Lines.h"
+#include "M_PI.h"
+#include "Mem.h"
+#include "Ortho.h"
+#include "Points.h"
+
+#define BENCH_CHUNKS 256
+#define BENCH_TILES_PER_SIDE 256
+#define BENCH_WARMUP_FRAMES 3
+#define BENCH_FRAMES 20
+#define BENCH_PICK_PIXELS (1 << 20)
+#define BENCH_POINTS 10000000
+
+// Return milliseconds per frame of emitting `instances` with `numThreads` threads,
+// styled by `styles` if not NULL.
+static double TimeEmit(const int numThreads, const Grid *const grid,
+    const Grid_Instance *const instances, const size_t numInstances,
+    const Grid_Styles *const styles,
+    const Ortho_View *const view, Lines *const chunkLines, Lines *const lines)
+{
+    Jobs jobs;
+    Jobs_Init(&jobs, numThreads);
+
+    Grid_Projection proj;
+    Grid_InitProjection(&proj);
+
+    uint64_t totalNs = 0;
+
+    for (int frame = 0; frame < BENCH_WARMUP_FRAMES + BENCH_FRAMES; frame += 1) {
+        const uint64_t startNs = Clock_GetTimeNs();
+
+        Grid_Project(grid, view, &proj);
+        Lines_Clear(lines);
+        Grid_EmitInstancesParallel(&proj, view, instances, numInstances, styles,
+            &jobs, chunkLines, BENCH_CHUNKS, lines);
+
+        if (frame >= BENCH_WARMUP_FRAMES) {
+            totalNs += Clock_GetTimeNs() - startNs;
+        }
+    }
+
+    Grid_DeinitProjection(&proj);
+    Jobs_Deinit(&jobs);
+
+    return (double)totalNs / BENCH_FRAMES / 1e6;
+}
+
+static void BenchScaling(const int maxThreads) {
+    const Grid grid = {
+        .cellWidth = 22.0,
+        .numCellsX = 22,
+        .numCellsY = 11
+    };
+
+    const size_t numInstances = (size_t)BENCH_TILES_PER_SIDE * BENCH_TILES_PER_SIDE;
+    Grid_Instance *const instances = Mem_Alloc(numInstances * sizeof(Grid_Instance));
+
+    const double tileWidth = grid.cellWidth * grid.numCellsX;
+    const double tileHeight = grid.cellWidth * grid.numCellsY;
+
+    for (size_t i = 0; i < numInstances; i += 1) {
+        const int tx = (int)(i % BENCH_TILES_PER_SIDE) - BENCH_TILES_PER_SIDE / 2;
+        const int ty = (int)(i / BENCH_TILES_PER_SIDE) - BENCH_TILES_PER_SIDE / 2;
+
+        instances[i] = (Grid_Instance) {
+            .offset = (V3d) {tx * tileWidth, ty * tileHeight, 0.0},
+            .color = (Rgba) {55, 55, 255, 255}
+        };
+    }
+
+    // Zoomed out so that most instances are on screen and many straddle its edges.
+    Ortho_View view;
+    Ortho_InitView(&view, (V3d) {0.0, 0.0, -500.0},
+        5.0 * M_PI / 4.0, M_PI / 4.0,
+        1920.0 * 60.0, 1080.0 * 60.0, 1920, 1080);
+
+    const size_t numLines = Grid_NumLines(&grid);
+    const size_t chunkSize = Grid_ChunkSize(numInstances, BENCH_CHUNKS);
+
+    Lines lines;
+    Lines_Init(&lines);
+    Lines_Reserve(&lines, numInstances * numLines, numInstances * GRID_NUM_STYLES);
+
+    Lines *const chunkLines = Mem_Alloc(BENCH_CHUNKS * sizeof(Lines));
+
+    for (int k = 0; k < BENCH_CHUNKS; k += 1) {
+        Lines_Init(&chunkLines[k]);
+        Lines_Reserve(&chunkLines[k], chunkSize * numLines, chunkSize * GRID_NUM_STYLES);
+    }
+
+    // As in the app, with the mouse over a cell of row 3.
+    const Grid_Styles styles = {
+        .cellWidth = grid.cellWidth,
+        .highlight = true,
+        .highlightRow = 3,
+        .highlightColor = (Rgba) {230, 180, 0, 255},
+        .axisColor = (Rgba) {0, 150, 0, 255},
+        .majorEvery = 5,
+        .majorColor = (Rgba) {20, 20, 120, 255}
+    };
+
+    fprintf(stdout, "Scaling: %zu grid instances, %zu lines each, %d CPUs online\n",
+        numInstances, numLines, Jobs_NumCpus());
+    fprintf(stdout, "%8s %12s %14s %9s %11s %16s\n",
+        "threads", "ms/frame", "Msegs/s", "speedup", "efficiency", "styled ms/frame");
+
+    double baseMs = 0.0;
+
+    for (int threads = 1; threads <= maxThreads; threads *= 2) {
+        const double styledMs = TimeEmit(threads, &grid, instances, numInstances, &styles,
+            &view, chunkLines, &lines);
+        const double ms = TimeEmit(threads, &grid, instances, numInstances, NULL,
+            &view, chunkLines, &lines);
+
+        if (threads == 1) {
+            baseMs = ms;
+        }
+
+        const double speedup = baseMs / ms;
+
+        fprintf(stdout, "%8d %12.3f %14.2f %9.2f %10.0f%% %16.3f\n",
+            threads, ms, (double)lines.numSegs / ms / 1e3, speedup, 100.0 * speedup / threads,
+            styledMs);
+    }
+
+    for (int k = 0; k < BENCH_CHUNKS; k += 1) {
+        Lines_Deinit(&chunkLines[k]);
+    }
+
+    Mem_Free(chunkLines);
+    Lines_Deinit(&lines);
+    Mem_Free(instances);
+}
+
+static void BenchPicking(void) {
+    const Grid grid = {
+        .cellWidth = 22.0,
+        .numCellsX = 22,
+        .numCellsY = 11
+    };
+
+    Ortho_View view;
+    Ortho_InitView(&view, (V3d) {500.0, 500.0, -500.0},
+        5.0 * M_PI / 4.0, M_PI / 4.0,
+        1920.0, 1080.0, 1920, 1080);
+
+    Ortho_PlaneMap map;
+    Ortho_InitPlaneMap(&view, 0.0, &map);
+
+    float *const px = Mem_Alloc(BENCH_PICK_PIXELS * sizeof(float));
+    float *const py = Mem_Alloc(BENCH_PICK_PIXELS * sizeof(float));
+    Grid_Cell *const cells = Mem_Alloc(BENCH_PICK_PIXELS * sizeof(Grid_Cell));
+
+    // Pixels spread over the whole screen.
+    for (size_t i = 0; i < BENCH_PICK_PIXELS; i += 1) {
+        px[i] = (float)((i * 7919) % 1920);
+        py[i] = (float)((i * 104729) % 1080);
+    }
+
+    size_t numHits = 0;
+    uint64_t totalNs = 0;
+
+    for (int frame = 0; frame < BENCH_WARMUP_FRAMES + BENCH_FRAMES; frame += 1) {
+        const uint64_t startNs = Clock_GetTimeNs();
+        numHits = Grid_PickCells(&grid, &map, px, py, BENCH_PICK_PIXELS, cells);
+
+        if (frame >= BENCH_WARMUP_FRAMES) {
+            totalNs += Clock_GetTimeNs() - startNs;
+        }
+    }
+
+    const double ns = (double)totalNs / BENCH_FRAMES;
+
+    fprintf(stdout, "Picking: %d pixels per call, %zu hit cells, %.2f ms per call, %.2f ns per pixel\n",
+        BENCH_PICK_PIXELS, numHits, ns / 1e6, ns / BENCH_PICK_PIXELS);
+
+    Mem_Free(cells);
+    Mem_Free(py);
+    Mem_Free(px);
+}
+
+// Return milliseconds per frame of drawing the first `numToDraw` of `points`.
+static double TimePoints(Jobs *const jobs, const Points *const points, const Ortho_View *const view,
+    const size_t numToDraw, Points_Target *const target, size_t *const numDrawn)
+{
+    uint64_t totalNs = 0;
+
+    for (int frame = 0; frame < BENCH_WARMUP_FRAMES + BENCH_FRAMES; frame += 1) {
+        const uint64_t startNs = Clock_GetTimeNs();
+        *numDrawn = Points_Draw(points, view, numToDraw, jobs, target);
+
+        if (frame >= BENCH_WARMUP_FRAMES) {
+            totalNs += Clock_GetTimeNs() - startNs;
+        }
+    }
+
+    return (double)totalNs / BENCH_FRAMES / 1e6;
+}
+
+static void BenchPoints(const int numThreads) {
+    Points points = {
+        .numPoints = BENCH_POINTS,
+        .x = Mem_Alloc(BENCH_POINTS * sizeof(float)),
+        .y = Mem_Alloc(BENCH_POINTS * sizeof(float)),
+        .z = Mem_Alloc(BENCH_POINTS * sizeof(float)),
+        .colors = Mem_Alloc(BENCH_POINTS * sizeof(uint32_t)),
+        .min = {-1000.0, -1000.0, -50.0},
+        .max = {1000.0, 1000.0, 50.0}
+    };
+
+    // Scattered over the bounding box in no particular order, like a shuffled file.
+    uint64_t state = 88172645463325252u;
+
+    for (size_t i = 0; i < BENCH_POINTS; i += 1) {
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+
+        points.x[i] = (float)((double)(state & 0xFFFFF) / 0xFFFFF * 2000.0 - 1000.0);
+        points.y[i] = (float)((double)((state >> 20) & 0xFFFFF) / 0xFFFFF * 2000.0 - 1000.0);
+        points.z[i] = (float)((double)((state >> 40) & 0xFFFFF) / 0xFFFFF * 100.0 - 50.0);
+        points.colors[i] = 0xFF000000u | (uint32_t)(state >> 40);
+    }
+
+    Jobs jobs;
+    Jobs_Init(&jobs, numThreads);
+
+    Points_Target target;
+    Points_InitTarget(&target);
+    Points_ResizeTarget(&target, 1920, 1080);
+
+    // Looking at the middle of the cloud, zoomed out to see all of it, then zoomed in.
+    const double planeWidths[2] = {6000.0, 500.0};
+
+    for (int z = 0; z < 2; z += 1) {
+        const V3d forward = Ortho_SphericalToCartesian(5.0 * M_PI / 4.0, M_PI / 4.0);
+
+        Ortho_View view;
+        Ortho_InitView(&view, V3d_Mul(forward, -2000.0),
+            5.0 * M_PI / 4.0, M_PI / 4.0,
+            planeWidths[z], planeWidths[z] * 1080.0 / 1920.0, 1920, 1080);
+
+        size_t numDrawn;
+        const double allMs = TimePoints(&jobs, &points, &view, BENCH_POINTS, &target, &numDrawn);
+
+        fprintf(stdout, "Points: plane width %.0f, %d threads, all %d: %zu drawn, %.2f ms per frame\n",
+            planeWidths[z], numThreads, BENCH_POINTS, numDrawn, allMs);
+
+        const size_t numToDraw = Points_NumToDraw(&points, &view, 2.0);
+        const double decimatedMs = TimePoints(&jobs, &points, &view, numToDraw, &target, &numDrawn);
+
+        fprintf(stdout, "Points: plane width %.0f, %d threads, decimated to %zu: %zu drawn, %.2f ms per frame\n",
+            planeWidths[z], numThreads, numToDraw, numDrawn, decimatedMs);
+    }
+
+    Points_DeinitTarget(&target);
+    Jobs_Deinit(&jobs);
+
+    Mem_Free(points.colors);
+    Mem_Free(points.z);
+    Mem_Free(points.y);
+    Mem_Free(points.x);
+}
+
+// Bytes per second in GB/s of moving `numBytes` `BENCH_FRAMES` times in `totalNs`.
+static double GigabytesPerSec(const size_t numBytes, const uint64_t totalNs) {
+    return (double)numBytes * BENCH_FRAMES / (double)totalNs;
+}
+
+// Time clearing and reading back into a buffer of `numBytes`.
+// `kept` is NULL to allocate a new buffer each frame, else the buffer to reuse.
+static void TimeBandwidth(const char *const name, uint8_t *const kept,
+    const uint8_t *const src, const size_t numBytes)
+{
+    uint64_t clearNs = 0;
+    uint64_t readNs = 0;
+
+    for (int frame = 0; frame < BENCH_WARMUP_FRAMES + BENCH_FRAMES; frame += 1) {
+        const uint64_t startNs = Clock_GetTimeNs();
+        uint8_t *const buf = (kept != NULL) ? kept : Mem_Alloc(numBytes);
+
+        memset(buf, frame, numBytes);
+
+        const uint64_t clearedNs = Clock_GetTimeNs();
+
+        memcpy(buf, src, numBytes);
+
+        const uint64_t endNs = Clock_GetTimeNs();
+
+        // Keep the copy from being dropped.
+        if (buf[numBytes / 2] != src[numBytes / 2]) {
+            fprintf(stderr, "%s: Copy mismatch\n", __func__);
+            exit(1);
+        }
+
+        if (kept == NULL) {
+            Mem_Free(buf);
+        }
+
+        if (frame >= BENCH_WARMUP_FRAMES) {
+            clearNs += clearedNs - startNs;
+            readNs += endNs - clearedNs;
+        }
+    }
+
+    fprintf(stdout, "Bandwidth: %zu MiB, %-20s clear %6.2f GB/s, readback %6.2f GB/s\n",
+        numBytes >> 20, name, GigabytesPerSec(numBytes, clearNs), GigabytesPerSec(numBytes, readNs));
+}
+
+static void BenchBandwidth(void) {
+    // 1080p and 4K frames of 32-bit pixels.
+    const size_t sizes[2] = {(size_t)1920 * 1080 * 4, (size_t)3840 * 2160 * 4};
+
+    for (int i = 0; i < 2; i += 1) {
+        uint8_t *const src = Mem_AllocLarge(sizes[i], MEM_TAG_OTHER);
+        memset(src, 0x5A, sizes[i]);
+
+        TimeBandwidth("malloc each frame", NULL, src, sizes[i]);
+
+        uint8_t *const heap = Mem_Alloc(sizes[i]);
+        TimeBandwidth("malloc kept", heap, src, sizes[i]);
+        Mem_Free(heap);
+
+        uint8_t *const large = Mem_AllocLarge(sizes[i], MEM_TAG_OTHER);
+        TimeBandwidth(Mem_DescribeBlock(large), large, src, sizes[i]);
+        Mem_Free(large);
+
+        Mem_Free(src);
+    }
+}
+
+int main(int argc, char **argv) {
+    const int maxThreads = (argc > 1) ? atoi(argv[1]) : Jobs_NumCpus();
+
+    BenchScaling((maxThreads < 1) ? 1 : maxThreads);
+    BenchPicking();
+    BenchPoints((maxThreads < 1) ? 1 : maxThreads);
+    BenchBandwidth();
+
+    return 0;
+}
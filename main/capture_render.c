@@ -0,0 +1,167 @@
+// Render a line capture (L key) to images.
+// Usage: capture_render.bin [--svg] [--scale S] capture.oglc outDir
+//
+// Writes `<outDir>/frame_<n>.bmp`, or `.svg` with `--svg`, for every frame.
+// `--scale` renders at S times the resolution the frames were captured at.
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "Capture.h"
+#include "Lines.h"
+#include "Raster.h"
+
+// Scale pixel coordinate `v`. Pixel centers stay pixel centers.
+static float ScaleCoord(const float v, const double scale) {
+    return (float)((v + 0.5) * scale - 0.5);
+}
+
+static void ScaleLines(Lines *const lines, const double scale) {
+    for (size_t i = 0; i < lines->numSegs; i += 1) {
+        Lines_Seg *const seg = &lines->segs[i];
+        seg->x1 = ScaleCoord(seg->x1, scale);
+        seg->y1 = ScaleCoord(seg->y1, scale);
+        seg->x2 = ScaleCoord(seg->x2, scale);
+        seg->y2 = ScaleCoord(seg->y2, scale);
+    }
+}
+
+static bool WriteSvg(const char *const path, const int width, const int height,
+    const Lines *const lines)
+{
+    FILE *const file = fopen(path, "w");
+
+    if (file == NULL) {
+        fprintf(stderr, "%s: Failed to open %s\n", __func__, path);
+        return false;
+    }
+
+    // Segment endpoints are pixel centers, hence the half pixel offset.
+    fprintf(file,
+        "<svg xmlns=\"http://www.w3.org/2000/svg\" width=\"%d\" height=\"%d\">\n"
+        "<rect width=\"100%%\" height=\"100%%\" fill=\"#ffffff\"/>\n"
+        "<g transform=\"translate(0.5 0.5)\" stroke-linecap=\"square\">\n",
+        width, height);
+
+    for (size_t r = 0; r < lines->numRuns; r += 1) {
+        const Lines_Run *const run = &lines->runs[r];
+
+        fprintf(file, "<g stroke=\"#%02x%02x%02x\" stroke-opacity=\"%.3f\">\n",
+            run->color.r, run->color.g, run->color.b, run->color.a / 255.0);
+
+        for (size_t i = run->start; i < run->start + run->count; i += 1) {
+            const Lines_Seg seg = lines->segs[i];
+            fprintf(file, "<line x1=\"%g\" y1=\"%g\" x2=\"%g\" y2=\"%g\"/>\n",
+                seg.x1, seg.y1, seg.x2, seg.y2);
+        }
+
+        fprintf(file, "</g>\n");
+    }
+
+    fprintf(file, "</g>\n</svg>\n");
+
+    if (fclose(file) != 0) {
+        fprintf(stderr, "%s: Failed to write %s\n", __func__, path);
+        return false;
+    }
+
+    return true;
+}
+
+static void PrintUsage(FILE *const file, const char *const program) {
+    fprintf(file, "Usage: %s [--svg] [--scale S] capture.oglc outDir\n", program);
+}
+
+int main(int argc, char **argv) {
+    bool svg = false;
+    double scale = 1.0;
+    const char *inPath = NULL;
+    const char *outDir = NULL;
+
+    for (int i = 1; i < argc; i += 1) {
+        if (strcmp(argv[i], "--svg") == 0) {
+            svg = true;
+        }
+        else if (strcmp(argv[i], "--scale") == 0 && i + 1 < argc) {
+            i += 1;
+            scale = atof(argv[i]);
+        }
+        else if (inPath == NULL) {
+            inPath = argv[i];
+        }
+        else if (outDir == NULL) {
+            outDir = argv[i];
+        }
+        else {
+            PrintUsage(stderr, argv[0]);
+            return 1;
+        }
+    }
+
+    if (inPath == NULL || outDir == NULL || scale <= 0.0) {
+        PrintUsage(stderr, argv[0]);
+        return 1;
+    }
+
+    FILE *const file = fopen(inPath, "rb");
+
+    if (file == NULL) {
+        fprintf(stderr, "Failed to open %s\n", inPath);
+        return 1;
+    }
+
+    if (!Capture_ReadHeader(file)) {
+        fclose(file);
+        return 1;
+    }
+
+    Lines lines;
+    Lines_Init(&lines);
+
+    Raster raster;
+    Raster_Init(&raster);
+
+    Capture_Frame frame;
+    int status = 0;
+    int numFrames = 0;
+    bool ok = true;
+
+    while (ok && (status = Capture_ReadFrame(file, &frame, &lines)) == 1) {
+        const int width = (int)(frame.screenWidth * scale + 0.5);
+        const int height = (int)(frame.screenHeight * scale + 0.5);
+
+        if (scale != 1.0) {
+            ScaleLines(&lines, scale);
+        }
+
+        char path[1024];
+        snprintf(path, sizeof(path), "%s/frame_%u.%s",
+            outDir, (unsigned)frame.frameNum, svg ? "svg" : "bmp");
+
+        if (svg) {
+            ok = WriteSvg(path, width, height, &lines);
+        }
+        else {
+            Raster_Resize(&raster, width, height);
+            Raster_Clear(&raster, (Rgba) {255, 255, 255, 255});
+            Raster_DrawLines(&raster, &lines);
+            ok = Raster_WriteBmp(&raster, path);
+        }
+
+        numFrames += 1;
+    }
+
+    if (status < 0) {
+        ok = false;
+    }
+
+    fprintf(stdout, "Rendered %d frames.\n", numFrames);
+
+    Raster_Deinit(&raster);
+    Lines_Deinit(&lines);
+    fclose(file);
+
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,139 @@
+// Read frames shared by the app with `--export NAME` and report latency.
+// Usage: export_reader.bin NAME [SECONDS]
+//
+// Sleeps until each frame is published, then reads every pixel in place.
+// Prints once a second and at the end: frames read, frames missed or
+// overwritten while being read, and latency from the start of each frame
+// and from its publishing to the reader waking up.
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "Clock.h"
+#include "Export.h"
+
+#define READER_MAX_SAMPLES 4096
+
+typedef struct Latencies {
+    uint64_t frameNs[READER_MAX_SAMPLES];   // From the start of the frame.
+    uint64_t publishNs[READER_MAX_SAMPLES]; // From the frame being published.
+    size_t count;
+} Latencies;
+
+static int CompareU64(const void *a, const void *b) {
+    const uint64_t x = *(const uint64_t *)a;
+    const uint64_t y = *(const uint64_t *)b;
+    return (x > y) - (x < y);
+}
+
+// Return the value at fraction `q` of sorted `values`.
+static double Quantile(const uint64_t *const values, const size_t count, const double q) {
+    return (double)values[(size_t)(q * (double)(count - 1) + 0.5)];
+}
+
+static void PrintLatencies(const char *const label, Latencies *const lat) {
+    if (lat->count == 0) {
+        fprintf(stdout, "%s: no frames\n", label);
+        return;
+    }
+
+    qsort(lat->frameNs, lat->count, sizeof(uint64_t), CompareU64);
+    qsort(lat->publishNs, lat->count, sizeof(uint64_t), CompareU64);
+
+    fprintf(stdout, "%s: %zu frames. Frame start to reader: median %.2f ms, p99 %.2f ms, max %.2f ms. "
+        "Publish to reader: median %.1f us, p99 %.1f us, max %.1f us\n",
+        label, lat->count,
+        Quantile(lat->frameNs, lat->count, 0.5) / 1e6,
+        Quantile(lat->frameNs, lat->count, 0.99) / 1e6,
+        (double)lat->frameNs[lat->count - 1] / 1e6,
+        Quantile(lat->publishNs, lat->count, 0.5) / 1e3,
+        Quantile(lat->publishNs, lat->count, 0.99) / 1e3,
+        (double)lat->publishNs[lat->count - 1] / 1e3);
+}
+
+int main(int argc, char **argv) {
+    if (argc < 2 || argc > 3) {
+        fprintf(stderr, "Usage: %s NAME [SECONDS]\n", argv[0]);
+        return 1;
+    }
+
+    const double seconds = (argc > 2) ? atof(argv[2]) : 10.0;
+
+    Export_Reader reader;
+
+    if (!Export_Attach(&reader, argv[1])) {
+        return 1;
+    }
+
+    // One window of samples for each second and one for the whole run.
+    static Latencies second;
+    static Latencies total;
+
+    uint64_t last = 0;
+    uint64_t numMissed = 0;
+    uint64_t numTorn = 0;
+    uint64_t checksum = 0;
+
+    const uint64_t startNs = Clock_GetTimeNs();
+    uint64_t reportNs = startNs + 1000000000u;
+
+    while (Clock_GetTimeNs() - startNs < (uint64_t)(seconds * 1e9)) {
+        const uint64_t frame = Export_Wait(&reader, last, 100000000u);
+        const uint64_t wakeNs = Clock_GetTimeNs();
+
+        if (frame > last) {
+            Export_Frame view;
+
+            if (last > 0) {
+                numMissed += frame - last - 1;
+            }
+
+            last = frame;
+
+            if (!Export_GetFrame(&reader, frame, &view)) {
+                numTorn += 1;
+                continue;
+            }
+
+            // Use the pixels where they are.
+            const size_t numPixels = (size_t)view.width * (size_t)view.height;
+            uint64_t sum = 0;
+
+            for (size_t i = 0; i < numPixels; i += 1) {
+                sum += view.pixels[i];
+            }
+
+            if (!Export_StillValid(&reader, &view)) {
+                numTorn += 1;
+                continue;
+            }
+
+            checksum += sum;
+
+            Latencies *const windows[2] = {&second, &total};
+
+            for (int w = 0; w < 2; w += 1) {
+                if (windows[w]->count < READER_MAX_SAMPLES) {
+                    windows[w]->frameNs[windows[w]->count] = wakeNs - view.frameNs;
+                    windows[w]->publishNs[windows[w]->count] = wakeNs - view.publishNs;
+                    windows[w]->count += 1;
+                }
+            }
+        }
+
+        if (wakeNs >= reportNs) {
+            PrintLatencies("Last second", &second);
+            second.count = 0;
+            reportNs += 1000000000u;
+        }
+    }
+
+    PrintLatencies("Total", &total);
+    fprintf(stdout, "Missed %" PRIu64 " frames, %" PRIu64 " overwritten while read. Checksum %016" PRIx64 "\n",
+        numMissed, numTorn, checksum);
+
+    Export_Detach(&reader);
+
+    return 0;
+}
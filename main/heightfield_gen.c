@@ -0,0 +1,64 @@
+// Write a synthetic heightfield in the tiled format read by `Terrain`.
+// Usage: heightfield_gen.bin [dir] [tilesPerSide]
+// Tiles are centered on the world origin.
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "M_PI.h"
+#include "Terrain.h"
+
+// Height of vertex (i, j). A few overlapping waves and a slow ramp.
+static float Height(const int i, const int j) {
+    const double x = i;
+    const double y = j;
+
+    return (float)(
+        40.0 * sin(x * 2.0 * M_PI / 97.0) * cos(y * 2.0 * M_PI / 131.0)
+        + 15.0 * sin((x + y) * 2.0 * M_PI / 23.0)
+        + 0.05 * (x - y));
+}
+
+int main(int argc, char **argv) {
+    const char *const dir = (argc > 1) ? argv[1] : "heightfield";
+    const int tilesPerSide = (argc > 2) ? atoi(argv[2]) : 16;
+
+    static float heights[TERRAIN_TILE_SIZE * TERRAIN_TILE_SIZE];
+    char path[1024];
+
+    const int first = -(tilesPerSide / 2);
+
+    for (int ty = first; ty < first + tilesPerSide; ty += 1) {
+        for (int tx = first; tx < first + tilesPerSide; tx += 1) {
+            for (int j = 0; j < TERRAIN_TILE_SIZE; j += 1) {
+                for (int i = 0; i < TERRAIN_TILE_SIZE; i += 1) {
+                    heights[j * TERRAIN_TILE_SIZE + i] =
+                        Height(tx * TERRAIN_TILE_SIZE + i, ty * TERRAIN_TILE_SIZE + j);
+                }
+            }
+
+            snprintf(path, sizeof(path), "%s/tile_%d_%d.bin", dir, tx, ty);
+
+            FILE *const file = fopen(path, "wb");
+
+            if (file == NULL) {
+                fprintf(stderr, "Failed to open %s for writing. Does the directory exist?\n", path);
+                return 1;
+            }
+
+            const size_t numHeights = TERRAIN_TILE_SIZE * TERRAIN_TILE_SIZE;
+
+            if (fwrite(heights, sizeof(float), numHeights, file) != numHeights) {
+                fprintf(stderr, "Failed to write %s\n", path);
+                fclose(file);
+                return 1;
+            }
+
+            fclose(file);
+        }
+    }
+
+    fprintf(stdout, "Wrote %d tiles to %s/\n", tilesPerSide * tilesPerSide, dir);
+
+    return 0;
+}
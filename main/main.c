@@ -1,8 +1,193 @@
 #include "App.h"
+#include "Batch.h"
+#include "Grid.h"
+#include "Jobs.h"
+#include "Mem.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static void PrintUsage(FILE *const file, const char *const program) {
+    fprintf(file,
+        "Usage: %s [options]\n"
+        "  --perf         Print hardware counter summary per frame stage on exit.\n"
+        "  --perf-frames  Like --perf and also print counters for every frame.\n"
+        "  --mem-check    Report heap allocations in the steady-state frame loop\n"
+        "                 and print allocation statistics on exit.\n"
+        "  --threads N    Threads for per-frame work. Default: one per CPU.\n"
+        "  --prof HZ      Sample call stacks HZ times per second of CPU time.\n"
+        "                 P and exiting write folded stacks under screenshots/.\n"
+        "  --points FILE  Load a point cloud (see `Points.h`) and show it. C toggles it.\n"
+        "  --record-rect X Y W H\n"
+        "                 Record (R) only this rectangle of the screen, in pixels.\n"
+        "  --record-scale N\n"
+        "                 Shrink recorded frames by N: 1, 2 or 4. Default: 1.\n"
+        "  --no-governor  Never lower quality to keep up the frame rate.\n"
+        "  --replay S     Keep the last S seconds of frames in memory to save with B.\n"
+        "                 0 turns it off. Default: 30.\n"
+        "  --export NAME  Share each frame with other processes through shared memory\n"
+        "                 object NAME, e.g. /ortho-grid. See `export_reader.bin`.\n"
+        "  --batch POSES OUTDIR\n"
+        "                 Render every camera pose listed in file POSES to .bmp images\n"
+        "                 under OUTDIR without opening a window, then exit.\n"
+        "                 See `Batch.h` for the file format. Uses --threads.\n"
+        "  --tiled        With --batch, render the tiled field of grid instances.\n"
+        "  --help         Print this message.\n",
+        program);
+}
+
+// Render the poses in `posesPath` offline. Return the exit code.
+static int RunBatch(const char *const posesPath, const char *const outDir,
+    const bool tiled, const int numThreads)
+{
+    size_t numPoses = 0;
+    Batch_Pose *const poses = Batch_ReadPoses(posesPath, &numPoses);
+
+    if (poses == NULL) {
+        return 1;
+    }
+
+    const Grid grid = {
+        .cellWidth = APP_GRID_CELL_WIDTH,
+        .numCellsX = APP_GRID_NUM_CELLS_X,
+        .numCellsY = APP_GRID_NUM_CELLS_Y
+    };
+
+    const int tilesPerSide = tiled ? APP_GRID_TILES_PER_SIDE : 1;
+    const size_t numInstances = (size_t)tilesPerSide * (size_t)tilesPerSide;
+    Grid_Instance *const instances = Mem_Alloc(numInstances * sizeof(Grid_Instance));
+    Grid_MakeTiles(&grid, tilesPerSide, APP_GRID_COLOR, APP_GRID_ALT_COLOR, instances);
+
+    // Lines styled as in the app. Nothing is hovered.
+    const Grid_Styles styles = {
+        .cellWidth = grid.cellWidth,
+        .highlight = false,
+        .axisColor = APP_GRID_AXIS_COLOR,
+        .majorEvery = APP_GRID_MAJOR_EVERY,
+        .majorColor = APP_GRID_MAJOR_COLOR
+    };
+
+    const Batch_Scene scene = {
+        .grid = &grid,
+        .instances = instances,
+        .numInstances = numInstances,
+        .styles = &styles,
+        .background = (Rgba) {255, 255, 255, 255}
+    };
+
+    const bool ok = Batch_Render(&scene, poses, numPoses, outDir,
+        (numThreads > 0) ? numThreads : Jobs_NumCpus());
+
+    Mem_Free(instances);
+    Mem_Free(poses);
+
+    return ok ? 0 : 1;
+}
+
+int main(int argc, char **argv) {
+    AppOptions options = {
+        .perfCounters = false,
+        .perfPrintFrames = false,
+        .memCheck = false,
+        .numThreads = 0,
+        .profHz = 0,
+        .pointsPath = NULL,
+        .recordRect = {0, 0, 0, 0},
+        .recordScale = 1,
+        .governor = true,
+        .replaySeconds = 30.0,
+        .exportName = NULL
+    };
+
+    const char *batchPoses = NULL;
+    const char *batchOutDir = NULL;
+    bool batchTiled = false;
+
+    for (int i = 1; i < argc; i += 1) {
+        if (strcmp(argv[i], "--perf") == 0) {
+            options.perfCounters = true;
+        }
+        else if (strcmp(argv[i], "--perf-frames") == 0) {
+            options.perfCounters = true;
+            options.perfPrintFrames = true;
+        }
+        else if (strcmp(argv[i], "--mem-check") == 0) {
+            options.memCheck = true;
+        }
+        else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+            i += 1;
+            options.numThreads = atoi(argv[i]);
+        }
+        else if (strcmp(argv[i], "--prof") == 0 && i + 1 < argc) {
+            i += 1;
+            options.profHz = atoi(argv[i]);
+        }
+        else if (strcmp(argv[i], "--points") == 0 && i + 1 < argc) {
+            i += 1;
+            options.pointsPath = argv[i];
+        }
+        else if (strcmp(argv[i], "--record-rect") == 0 && i + 4 < argc) {
+            options.recordRect = (SDL_Rect) {
+                atoi(argv[i + 1]), atoi(argv[i + 2]), atoi(argv[i + 3]), atoi(argv[i + 4])
+            };
+            i += 4;
+
+            if (options.recordRect.w <= 0 || options.recordRect.h <= 0) {
+                fprintf(stderr, "--record-rect needs a positive width and height\n");
+                return 1;
+            }
+        }
+        else if (strcmp(argv[i], "--record-scale") == 0 && i + 1 < argc) {
+            i += 1;
+            options.recordScale = atoi(argv[i]);
+
+            if (options.recordScale != 1 && options.recordScale != 2 && options.recordScale != 4) {
+                fprintf(stderr, "--record-scale must be 1, 2 or 4\n");
+                return 1;
+            }
+        }
+        else if (strcmp(argv[i], "--no-governor") == 0) {
+            options.governor = false;
+        }
+        else if (strcmp(argv[i], "--replay") == 0 && i + 1 < argc) {
+            i += 1;
+            options.replaySeconds = atof(argv[i]);
+
+            if (options.replaySeconds < 0.0) {
+                fprintf(stderr, "--replay must not be negative\n");
+                return 1;
+            }
+        }
+        else if (strcmp(argv[i], "--export") == 0 && i + 1 < argc) {
+            i += 1;
+            options.exportName = argv[i];
+        }
+        else if (strcmp(argv[i], "--batch") == 0 && i + 2 < argc) {
+            batchPoses = argv[i + 1];
+            batchOutDir = argv[i + 2];
+            i += 2;
+        }
+        else if (strcmp(argv[i], "--tiled") == 0) {
+            batchTiled = true;
+        }
+        else if (strcmp(argv[i], "--help") == 0) {
+            PrintUsage(stdout, argv[0]);
+            return 0;
+        }
+        else {
+            fprintf(stderr, "Unknown option: %s\n", argv[i]);
+            PrintUsage(stderr, argv[0]);
+            return 1;
+        }
+    }
+
+    if (batchPoses != NULL) {
+        return RunBatch(batchPoses, batchOutDir, batchTiled, options.numThreads);
+    }
 
-int main(void) {
     App app;
-    App_Init(&app);
+    App_Init(&app, &options);
     App_Run(&app);
     App_Deinit(&app);
 
@@ -0,0 +1,94 @@
+// Write a synthetic point cloud in the format read by `Points`.
+// Usage: points_gen.bin [path] [numPoints]
+// Points lie on a wavy surface centered on the world origin, colored by height,
+// in random order so that decimation thins them out evenly.
+
+#include <math.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "M_PI.h"
+#include "Points.h"
+
+// Points written per `fwrite`.
+#define BLOCK_SIZE 65536
+
+// Side of the square the points cover, in world units.
+#define EXTENT 2000.0
+
+static uint64_t rngState = 0x9E3779B97F4A7C15u;
+
+// Uniform in [0.0, 1.0). xorshift64*.
+static double Random(void) {
+    rngState ^= rngState >> 12;
+    rngState ^= rngState << 25;
+    rngState ^= rngState >> 27;
+    return (double)((rngState * 0x2545F4914F6CDD1Du) >> 11) * 0x1.0p-53;
+}
+
+static double Height(const double x, const double y) {
+    return 60.0 * sin(x * 2.0 * M_PI / 700.0) * cos(y * 2.0 * M_PI / 900.0)
+        + 12.0 * sin((x + y) * 2.0 * M_PI / 130.0);
+}
+
+// Blue at the lowest, white at the highest.
+static uint32_t HeightColor(const double z) {
+    const double t = fmin(fmax((z + 72.0) / 144.0, 0.0), 1.0);
+    const uint32_t r = (uint32_t)(40.0 + 215.0 * t);
+    const uint32_t g = (uint32_t)(90.0 + 165.0 * t);
+    const uint32_t b = (uint32_t)(200.0 + 55.0 * t);
+    return 0xFF000000u | (r << 16) | (g << 8) | b;
+}
+
+int main(int argc, char **argv) {
+    const char *const path = (argc > 1) ? argv[1] : "points.ogpc";
+    const uint64_t numPoints = (argc > 2) ? strtoull(argv[2], NULL, 10) : 10000000;
+
+    FILE *const file = fopen(path, "wb");
+
+    if (file == NULL) {
+        fprintf(stderr, "Failed to open %s for writing\n", path);
+        return 1;
+    }
+
+    // Written as is, so assumes a little-endian machine like the reader.
+    const uint32_t version = POINTS_VERSION;
+    uint8_t header[16];
+    memcpy(header, "OGPC", 4);
+    memcpy(header + 4, &version, 4);
+    memcpy(header + 8, &numPoints, 8);
+
+    static uint8_t block[BLOCK_SIZE * 16];
+    bool ok = fwrite(header, sizeof(header), 1, file) == 1;
+
+    for (uint64_t first = 0; ok && first < numPoints; first += BLOCK_SIZE) {
+        const size_t n = (numPoints - first < BLOCK_SIZE) ? (size_t)(numPoints - first) : BLOCK_SIZE;
+
+        for (size_t k = 0; k < n; k += 1) {
+            // Independent random positions, so any subset is spread evenly.
+            const double x = (Random() - 0.5) * EXTENT;
+            const double y = (Random() - 0.5) * EXTENT;
+            const double z = Height(x, y);
+
+            const float xyz[3] = {(float)x, (float)y, (float)z};
+            const uint32_t color = HeightColor(z);
+
+            memcpy(block + k * 16, xyz, 12);
+            memcpy(block + k * 16 + 12, &color, 4);
+        }
+
+        ok = fwrite(block, 16, n, file) == n;
+    }
+
+    if (fclose(file) != 0 || !ok) {
+        fprintf(stderr, "Failed to write %s\n", path);
+        return 1;
+    }
+
+    fprintf(stdout, "Wrote %llu points to %s\n", (unsigned long long)numPoints, path);
+
+    return 0;
+}
@@ -0,0 +1,61 @@
+// Write the frames of an instant replay (B key) as images.
+// Usage: replay_extract.bin replay.ogrp outDir
+//
+// Writes `<outDir>/frame_<n>.bmp` for every frame, n from 1, and prints
+// the time of each frame since the first.
+
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdio.h>
+
+#include "Raster.h"
+#include "Replay.h"
+
+int main(int argc, char **argv) {
+    if (argc != 3) {
+        fprintf(stderr, "Usage: %s replay.ogrp outDir\n", argv[0]);
+        return 1;
+    }
+
+    FILE *const file = fopen(argv[1], "rb");
+
+    if (file == NULL) {
+        fprintf(stderr, "Failed to open %s\n", argv[1]);
+        return 1;
+    }
+
+    if (!Replay_ReadHeader(file)) {
+        fclose(file);
+        return 1;
+    }
+
+    Raster raster;
+    Raster_Init(&raster);
+
+    uint64_t timeNs;
+    int status = 0;
+    int numFrames = 0;
+    bool ok = true;
+
+    while (ok && (status = Replay_ReadFrame(file, &raster, &timeNs)) == 1) {
+        numFrames += 1;
+
+        char path[1024];
+        snprintf(path, sizeof(path), "%s/frame_%d.bmp", argv[2], numFrames);
+
+        ok = Raster_WriteBmp(&raster, path);
+
+        fprintf(stdout, "%s %.3f s\n", path, (double)timeNs / 1e9);
+    }
+
+    if (status < 0) {
+        ok = false;
+    }
+
+    fprintf(stdout, "Wrote %d frames.\n", numFrames);
+
+    Raster_Deinit(&raster);
+    fclose(file);
+
+    return ok ? 0 : 1;
+}
@@ -1,52 +1,112 @@
 #include "App.h"
 
+#include <limits.h>
+#include <string.h>
 #include <time.h>
 
 #include "Clock.h"
+#include "Downscale.h"
 #include "M_PI.h"
+#include "Mem.h"
+#include "Ortho.h"
+#include "Perf.h"
+#include "Prof.h"
 #include "Sdlu.h"
 #include "V3d.h"
 
-// Save .bmp image of given renderer to given path.
+#define APP_FRAME_PATH_LEN 1024
+
+// Save .bmp image of the recorded part of the renderer output to given path,
+// shrunk by `app->recordScale`. Only that part is read back.
 // Print to stderr if error.
-static void SaveBmp(SDL_Renderer *const renderer, const char *const path) {
+static void SaveBmp(App *const app, const char *const path) {
     int w;
     int h;
-    Sdlu_GetRendererOutputSize(renderer, &w, &h);
-
-    // https://wiki.libsdl.org/SDL_CreateRGBSurface
-#if SDL_BYTEORDER == SDL_BIG_ENDIAN
-    const Uint32 rmask = 0xff000000;
-    const Uint32 gmask = 0x00ff0000;
-    const Uint32 bmask = 0x0000ff00;
-    const Uint32 amask = 0x000000ff;
-#else
-    const Uint32 rmask = 0x000000ff;
-    const Uint32 gmask = 0x0000ff00;
-    const Uint32 bmask = 0x00ff0000;
-    const Uint32 amask = 0xff000000;
-#endif
-
-    SDL_Surface *const surface = SDL_CreateRGBSurface(0, w, h, 32, rmask, gmask, bmask, amask);
-
-    if (surface == NULL) {
+    Sdlu_GetRendererOutputSize(app->renderer, &w, &h);
+
+    // The recorded rectangle, clipped to the output.
+    SDL_Rect rect = {0, 0, w, h};
+
+    if (app->recordRect.w > 0 && app->recordRect.h > 0) {
+        const int x2 = (app->recordRect.x + app->recordRect.w < w) ? app->recordRect.x + app->recordRect.w : w;
+        const int y2 = (app->recordRect.y + app->recordRect.h < h) ? app->recordRect.y + app->recordRect.h : h;
+
+        rect.x = (app->recordRect.x > 0) ? app->recordRect.x : 0;
+        rect.y = (app->recordRect.y > 0) ? app->recordRect.y : 0;
+        rect.w = x2 - rect.x;
+        rect.h = y2 - rect.y;
+    }
+
+    int scale = app->recordScale;
+
+    // Shed by the governor when over budget.
+    if (app->governed && app->governor.level >= GOVERNOR_SMALL_CAPTURE && scale < 4) {
+        scale *= 2;
+    }
+
+    const int outW = rect.w / scale;
+    const int outH = rect.h / scale;
+
+    if (outW <= 0 || outH <= 0) {
         fprintf(stderr, "FAILED TO SAVE SCREENSHOT. "
-            "SDL_CreateRGBSurface error: %s\n", SDL_GetError());
+            "Recorded rectangle is outside the %dx%d output.\n", w, h);
 
         return;
     }
 
-    const int rrp_code = SDL_RenderReadPixels(renderer, NULL,
-        surface->format->format,
-        surface->pixels,
-        surface->pitch);
+    // Room for the read back pixels followed by the downscaled ones.
+    const size_t numRead = (size_t)rect.w * (size_t)rect.h;
+    const size_t numPixels = numRead + ((scale > 1) ? (size_t)outW * (size_t)outH : 0);
+
+    if (numPixels > app->recordPixelsCap) {
+        // The surface points into the old pixels.
+        SDL_FreeSurface(app->recordSurface);
+        app->recordSurface = NULL;
+
+        Mem_Free(app->recordPixels);
+        app->recordPixels = Mem_AllocLarge(numPixels * sizeof(uint32_t), MEM_TAG_CAPTURE);
+        app->recordPixelsCap = numPixels;
+    }
+
+    // Pixels are 32-bit values 0xAARRGGBB whatever the byte order.
+    const int rrp_code = SDL_RenderReadPixels(app->renderer, &rect,
+        SDL_PIXELFORMAT_ARGB8888,
+        app->recordPixels,
+        rect.w * (int)sizeof(uint32_t));
 
     if (rrp_code != 0) {
         fprintf(stderr, "FAILED TO SAVE SCREENSHOT. "
             "SDL_RenderReadPixels error: %d: %s\n",
             rrp_code, SDL_GetError());
 
-        goto cleanup;
+        return;
+    }
+
+    uint32_t *pixels = app->recordPixels;
+
+    if (scale > 1) {
+        pixels = app->recordPixels + numRead;
+        Downscale_Box(app->recordPixels, (size_t)rect.w, rect.w, rect.h, scale,
+            pixels, (size_t)outW);
+    }
+
+    // The surface wraps the pixels and is kept until the recorded size changes.
+    SDL_Surface *surface = app->recordSurface;
+
+    if (surface == NULL || surface->pixels != pixels || surface->w != outW || surface->h != outH) {
+        SDL_FreeSurface(surface);
+
+        surface = SDL_CreateRGBSurfaceFrom(pixels, outW, outH, 32,
+            outW * (int)sizeof(uint32_t),
+            0x00ff0000, 0x0000ff00, 0x000000ff, 0xff000000);
+        app->recordSurface = surface;
+
+        if (surface == NULL) {
+            fprintf(stderr, "FAILED TO SAVE SCREENSHOT. "
+                "SDL_CreateRGBSurfaceFrom error: %s\n", SDL_GetError());
+
+            return;
+        }
     }
 
     const int sbmp_code = SDL_SaveBMP(surface, path);
@@ -55,14 +115,136 @@ static void SaveBmp(SDL_Renderer *const renderer, const char *const path) {
         fprintf(stderr, "FAILED TO SAVE SCREENSHOT. "
             "SDL_SaveBMP error: %d: %s\n",
             sbmp_code, SDL_GetError());
-
-        goto cleanup;
     }
 
     // printf("Saved screenshot: %s\n", path);
+}
+
+static void SetGridTiles(App *const app, const int tilesPerSide);
+static void WriteProfile(void);
+static void ToggleLineCapture(App *const app);
+static void SaveReplay(App *const app);
+
+static void ToggleHeightfieldMode(App *const app) {
+    app->heightfieldMode = !app->heightfieldMode;
+
+    if (app->heightfieldMode) {
+        if (!app->terrainStarted) {
+            Terrain_Init(&app->terrain, APP_HEIGHTFIELD_DIR,
+                app->grid.cellWidth, APP_HEIGHTFIELD_BUDGET_BYTES);
+            app->terrainStarted = true;
+        }
+
+        Lines_Reserve(&app->lines, Terrain_MaxSegs(), APP_JOB_CHUNKS);
+        Layers_Reserve(&app->lineLayers, Terrain_MaxSegs(), APP_JOB_CHUNKS);
 
-    cleanup:
-    SDL_FreeSurface(surface);
+        for (int k = 0; k < APP_JOB_CHUNKS; k += 1) {
+            Lines_Reserve(&app->chunkLines[k], Terrain_MaxSegsPerChunk(APP_JOB_CHUNKS), 1);
+        }
+
+        app->memWarmupFrames = APP_MEM_WARMUP_FRAMES;
+
+        fprintf(stdout, "Heightfield mode on. Reading tiles from %s/\n", APP_HEIGHTFIELD_DIR);
+    }
+    else {
+        fprintf(stdout, "Heightfield mode off.\n");
+        Terrain_PrintStats(&app->terrain, stdout);
+    }
+}
+
+// Value of heatmap cell (i, j) at `seconds`. Slowly drifting waves.
+static float HeatmapValue(const int i, const int j, const double seconds) {
+    return (float)(sin(i * 0.05 + seconds) * cos(j * 0.04 - seconds * 0.7));
+}
+
+static void ToggleHeatmapMode(App *const app) {
+    app->heatmapMode = !app->heatmapMode;
+
+    if (app->heatmapMode && !app->heatmapStarted) {
+        const int side = APP_HEATMAP_CELLS_PER_SIDE;
+        const Grid_Cell firstCell = {-side / 2, -side / 2};
+        Heatmap_Init(&app->heatmap, &app->grid, firstCell, side, side);
+
+        const Rgba stops[4] = {
+            {40, 60, 200, 255},
+            {60, 200, 220, 255},
+            {250, 220, 60, 255},
+            {220, 40, 30, 255}
+        };
+        Heatmap_SetColorMap(&app->heatmap, stops, 4, -1.0f, 1.0f);
+
+        for (int j = 0; j < side; j += 1) {
+            for (int i = 0; i < side; i += 1) {
+                Heatmap_SetValue(&app->heatmap, i, j, HeatmapValue(i, j, 0.0));
+            }
+        }
+
+        app->heatmapNextRow = 0;
+        app->heatmapStarted = true;
+    }
+
+    // SDL's command buffers grow for the heatmap's vertices on the first frames it is drawn.
+    if (app->heatmapMode) {
+        app->memWarmupFrames = APP_MEM_WARMUP_FRAMES;
+    }
+
+    fprintf(stdout, "Heatmap mode %s.\n", app->heatmapMode ? "on" : "off");
+}
+
+// Give the next few heatmap rows new values, as if data were streaming in.
+static void UpdateHeatmapValues(App *const app, const uint64_t timeNs) {
+    const double seconds = (double)timeNs / 1e9;
+    Heatmap *const heatmap = &app->heatmap;
+
+    for (int r = 0; r < APP_HEATMAP_ROWS_PER_FRAME; r += 1) {
+        const int j = app->heatmapNextRow;
+
+        for (int i = 0; i < heatmap->numCellsX; i += 1) {
+            Heatmap_SetValue(heatmap, i, j, HeatmapValue(i, j, seconds));
+        }
+
+        app->heatmapNextRow = (j + 1) % heatmap->numCellsY;
+    }
+}
+
+static void TogglePointsMode(App *const app) {
+    if (!app->pointsLoaded) {
+        fprintf(stdout, "No point cloud. Start with --points FILE.\n");
+        return;
+    }
+
+    app->pointsMode = !app->pointsMode;
+
+    // The first frame with points may create the target and its texture.
+    app->memWarmupFrames = APP_MEM_WARMUP_FRAMES;
+
+    fprintf(stdout, "Point cloud %s.\n", app->pointsMode ? "on" : "off");
+}
+
+// Copy the drawn points to the texture and draw it over the whole screen.
+static void DrawPoints(App *const app) {
+    const Points_Target *const target = &app->pointsTarget;
+
+    if (app->pointsTexture == NULL
+        || app->pointsTextureWidth != target->width
+        || app->pointsTextureHeight != target->height)
+    {
+        if (app->pointsTexture != NULL) {
+            SDL_DestroyTexture(app->pointsTexture);
+        }
+
+        app->pointsTexture = Sdlu_CreateTexture(app->renderer, SDL_PIXELFORMAT_ARGB8888,
+            SDL_TEXTUREACCESS_STREAMING, target->width, target->height);
+        app->pointsTextureWidth = target->width;
+        app->pointsTextureHeight = target->height;
+
+        // Pixels without a point have alpha 0.
+        Sdlu_SetTextureBlendMode(app->pointsTexture, SDL_BLENDMODE_BLEND);
+    }
+
+    Sdlu_UpdateTexture(app->pointsTexture, NULL, (const void *)target->pixels,
+        target->width * (int)sizeof(uint32_t));
+    Sdlu_RenderCopy(app->renderer, app->pointsTexture, NULL, NULL);
 }
 
 static void UpdateProjPlaneDimensions(App *const app) {
@@ -70,7 +252,7 @@ static void UpdateProjPlaneDimensions(App *const app) {
     app->projPlaneHeight = app->baseProjPlaneHeight * app->projPlaneFactor;
 }
 
-void App_Init(App *const app) {
+void App_Init(App *const app, const AppOptions *const options) {
     Sdlu_Init(SDL_INIT_VIDEO);
 
     const int windowWidth = 800;
@@ -85,6 +267,12 @@ void App_Init(App *const app) {
     app->renderer = Sdlu_CreateRenderer(app->window, -1, SDL_RENDERER_ACCELERATED);
     app->quit = false;
     app->recording = false;
+    app->recordRect = options->recordRect;
+    app->recordScale = (options->recordScale > 0) ? options->recordScale : 1;
+    app->recordPixels = NULL;
+    app->recordPixelsCap = 0;
+    app->recordSurface = NULL;
+    app->capturingLines = false;
 
     app->cameraPos = (V3d) {500.0, 500.0, -500.0};
     app->horizLookRads = 5.0 * M_PI / 4.0;
@@ -96,6 +284,94 @@ void App_Init(App *const app) {
 
     UpdateProjPlaneDimensions(app);
 
+    app->grid = (Grid) {
+        .cellWidth = APP_GRID_CELL_WIDTH,
+        .numCellsX = APP_GRID_NUM_CELLS_X,
+        .numCellsY = APP_GRID_NUM_CELLS_Y
+    };
+
+    app->gridInstances = NULL;
+    app->numGridInstances = 0;
+    app->gridTiled = false;
+    app->hovering = false;
+    app->hoverCell = GRID_NO_CELL;
+
+    app->heightfieldMode = false;
+    app->terrainStarted = false;
+
+    app->heatmapMode = false;
+    app->heatmapStarted = false;
+
+    app->pointsLoaded = false;
+    app->pointsTexture = NULL;
+    Points_InitTarget(&app->pointsTarget);
+
+    if (options->pointsPath != NULL) {
+        if (!Points_Load(&app->points, options->pointsPath)) {
+            exit(1);
+        }
+
+        fprintf(stdout, "Loaded %zu points from %s\n",
+            app->points.numPoints, options->pointsPath);
+
+        app->pointsLoaded = true;
+    }
+
+    app->pointsMode = app->pointsLoaded;
+
+    app->showLabels = true;
+    Labels_Init(&app->labels, app->renderer);
+
+    Grid_InitProjection(&app->gridProjection);
+    Grid_InitProjection(&app->coarseGridProjection);
+    Grid_InitProjectionCache(&app->gridProjectionCache);
+    Lines_Init(&app->lines);
+    Layers_Init(&app->lineLayers);
+
+    for (int k = 0; k < APP_JOB_CHUNKS; k += 1) {
+        Lines_Init(&app->chunkLines[k]);
+    }
+
+    const int numThreads = (options->numThreads > 0) ? options->numThreads : Jobs_NumCpus();
+    Jobs_Init(&app->jobs, numThreads);
+
+    SetGridTiles(app, 1);
+
+    app->memCheck = options->memCheck;
+    Mem_SetChecking(options->memCheck);
+
+    // Counters stay disabled unless asked for or if unavailable.
+    app->perf = (Perf) { .enabled = false };
+
+    if (options->perfCounters) {
+        Perf_Init(&app->perf, options->perfPrintFrames, &app->jobs);
+    }
+
+    // Started last so that startup is not in the profile.
+    if (options->profHz > 0) {
+        Prof_Start(options->profHz);
+    }
+
+    // Budget of one frame of `App_Run`.
+    app->governed = options->governor;
+    Governor_Init(&app->governor, APP_FRAME_PERIOD_NS, true);
+
+    // Runs without sharing frames if the shared memory cannot be set up.
+    app->exporting = options->exportName != NULL
+        && Export_Open(&app->frameExport, options->exportName, APP_EXPORT_SLOTS,
+            APP_EXPORT_MAX_WIDTH, APP_EXPORT_MAX_HEIGHT);
+
+    if (app->exporting) {
+        fprintf(stdout, "Sharing frames as %s\n", options->exportName);
+    }
+
+    app->replaying = options->replaySeconds > 0.0;
+
+    if (app->replaying) {
+        Replay_Init(&app->replay, options->replaySeconds, APP_REPLAY_RING_BYTES,
+            (int)(1000000000 / APP_FRAME_PERIOD_NS));
+    }
+
     Sdlu_SetRelativeMouseMode(SDL_TRUE);
 }
 
@@ -138,6 +414,8 @@ static void PollEvents(App *const app, const double ddeltaNs) {
 
                         UpdateProjPlaneDimensions(app);
 
+                        app->memWarmupFrames = APP_MEM_WARMUP_FRAMES;
+
                         break;
                     }
                     case SDL_WINDOWEVENT_FOCUS_GAINED:
@@ -156,6 +434,10 @@ static void PollEvents(App *const app, const double ddeltaNs) {
             }
             case SDL_MOUSEBUTTONDOWN:
             {
+                if (app->hovering) {
+                    fprintf(stdout, "Cell (%d, %d)\n", app->hoverCell.x, app->hoverCell.y);
+                }
+
                 break;
             }
             case SDL_MOUSEMOTION:
@@ -226,6 +508,20 @@ static void PollEvents(App *const app, const double ddeltaNs) {
                         app->horizLookRads = rads + (M_PI / 4.0);
                         break;
                     }
+                    case SDLK_t:
+                    {
+                        // Toggle between one grid and a large field of grid instances.
+                        app->gridTiled = !app->gridTiled;
+                        SetGridTiles(app, app->gridTiled ? APP_GRID_TILES_PER_SIDE : 1);
+
+                        fprintf(stdout, "Grid instances: %zu\n", app->numGridInstances);
+                        break;
+                    }
+                    case SDLK_h:
+                    {
+                        ToggleHeightfieldMode(app);
+                        break;
+                    }
                     case SDLK_r:
                     {
                         if (!app->recording) {
@@ -253,6 +549,37 @@ static void PollEvents(App *const app, const double ddeltaNs) {
                         app->recording = !app->recording;
                         break;
                     }
+                    case SDLK_p:
+                    {
+                        // Write the profile so far and start a new one.
+                        WriteProfile();
+                        break;
+                    }
+                    case SDLK_m:
+                    {
+                        ToggleHeatmapMode(app);
+                        break;
+                    }
+                    case SDLK_l:
+                    {
+                        ToggleLineCapture(app);
+                        break;
+                    }
+                    case SDLK_c:
+                    {
+                        TogglePointsMode(app);
+                        break;
+                    }
+                    case SDLK_g:
+                    {
+                        app->showLabels = !app->showLabels;
+                        break;
+                    }
+                    case SDLK_b:
+                    {
+                        SaveReplay(app);
+                        break;
+                    }
                 }
 
                 break;
@@ -293,100 +620,367 @@ static void PollEvents(App *const app, const double ddeltaNs) {
     }
 }
 
-// Orthographically project the given point onto the plane described
-// by the given vectors.
-// Use the app's camera position.
-// Assume the look vectors are unit magnitude.
-static V3d OrthoProject(App *app, V3d point, V3d lookRight, V3d lookUp) {
-    V3d relativePoint = V3d_Sub(point, app->cameraPos);
-
-    return (V3d) {
-        V3d_Dot(relativePoint, lookRight),
-        V3d_Dot(relativePoint, lookUp),
-        0.0
-    };
+// // Currently not used.
+// static void MaybeDrawPoint(App *app, const Ortho_View *view, V3d point) {
+//     const V3d pixel = Ortho_Project(view, point);
+//
+//     if (Ortho_IsVisible(view, pixel)) {
+//         fprintf(stdout, "pixel: (%lf, %lf)\n", pixel.x, pixel.y);
+//
+//         Sdlu_RenderDrawPoint(
+//             app->renderer, (int)round(pixel.x), (int)round(pixel.y));
+//     }
+// }
+
+// Write the samples of the profiler, if running, under `screenshots`.
+static void WriteProfile(void) {
+    if (!Prof_IsRunning()) {
+        return;
+    }
+
+    struct timespec ts;
+    if (timespec_get(&ts, TIME_UTC) == 0) {
+        fprintf(stderr, "FAILED TO WRITE PROFILE. timespec_get error\n");
+        return;
+    }
+
+    char path[APP_FRAME_PATH_LEN];
+    snprintf(path, APP_FRAME_PATH_LEN, "screenshots/profile_%ld_%09ld.folded",
+        (long)ts.tv_sec, (long)ts.tv_nsec);
+
+    if (Prof_WriteFolded(path)) {
+        fprintf(stdout, "Wrote profile to %s\n", path);
+    }
 }
 
-// Return the point projected onto the screen
-// as a vector where [0.0, 0.0] means top-left of top-left pixel of screen
-// and [1.0, 1.0] means bottom-right of bottom-right pixel of screen.
-// Use the app's camera position and projection plane dimensions.
-static V3d PointToScreenProportions(App *app, V3d point, V3d lookRight, V3d lookUp) {
-    V3d projected = OrthoProject(app, point, lookRight, lookUp);
-
-    return (V3d) {
-        (+projected.x + (app->projPlaneWidth  / 2.0)) / app->projPlaneWidth,
-        (-projected.y + (app->projPlaneHeight / 2.0)) / app->projPlaneHeight,
-        0.0
-    };
+// Start or stop writing the line segments of each frame
+// to a new file under `screenshots`.
+static void ToggleLineCapture(App *const app) {
+    if (app->capturingLines) {
+        Capture_Close(&app->capture);
+        app->capturingLines = false;
+        return;
+    }
+
+    struct timespec ts;
+    if (timespec_get(&ts, TIME_UTC) == 0) {
+        fprintf(stderr, "FAILED TO START LINE CAPTURE. timespec_get error\n");
+        return;
+    }
+
+    char path[APP_FRAME_PATH_LEN];
+    snprintf(path, APP_FRAME_PATH_LEN, "screenshots/lines_%ld.oglc", (long)ts.tv_sec);
+
+    if (Capture_Open(&app->capture, path)) {
+        fprintf(stdout, "Capturing lines to %s\n", path);
+        app->capturingLines = true;
+    }
 }
 
-// Vector with 2 int fields.
-typedef struct V2i {
-    int x;
-    int y;
-} V2i;
+// Ask for the instant replay to be written to a new file under `screenshots`.
+static void SaveReplay(App *const app) {
+    if (!app->replaying) {
+        fprintf(stdout, "Instant replay is off. See --replay.\n");
+        return;
+    }
 
-typedef struct MaybeV2i {
-    bool hasValue;
-    V2i value;
-} MaybeV2i;
+    struct timespec ts;
+    if (timespec_get(&ts, TIME_UTC) == 0) {
+        fprintf(stderr, "FAILED TO SAVE REPLAY. timespec_get error\n");
+        return;
+    }
+
+    char path[APP_FRAME_PATH_LEN];
+    snprintf(path, APP_FRAME_PATH_LEN, "screenshots/replay_%ld.ogrp", (long)ts.tv_sec);
+
+    Replay_Save(&app->replay, path);
+}
 
-static MaybeV2i PointToPixel(App *app, V3d point, V3d lookForward, V3d lookRight, V3d lookUp) {
-    V3d camToPoint = V3d_Sub(point, app->cameraPos);
-    V3d unitCamToPoint = V3d_Unit(camToPoint);
-    if (V3d_Dot(lookForward, unitCamToPoint) <= 0.0) {
-        // Point is behind projection plane. Cannot be seen.
-        return (MaybeV2i) { false };
+// Read the frame just drawn into `pixels`, `screenWidth` per row.
+// If error, print to `stderr` prefixed with `what` and return false.
+static bool ReadFrame(App *const app, const int screenWidth, uint32_t *const pixels,
+    const char *const what)
+{
+    // Pixels are 32-bit values 0xAARRGGBB whatever the byte order.
+    const int rrp_code = SDL_RenderReadPixels(app->renderer, NULL,
+        SDL_PIXELFORMAT_ARGB8888,
+        pixels,
+        screenWidth * (int)sizeof(uint32_t));
+
+    if (rrp_code != 0) {
+        fprintf(stderr, "FAILED TO %s. "
+            "SDL_RenderReadPixels error: %d: %s\n",
+            what, rrp_code, SDL_GetError());
+
+        return false;
     }
 
-    V3d screenProps = PointToScreenProportions(app, point, lookRight, lookUp);
+    return true;
+}
+
+// Read the frame just drawn into the next slot shared with other processes.
+// Return its pixels, or NULL if not read.
+static const uint32_t *ExportFrame(App *const app, const int screenWidth, const int screenHeight,
+    const uint64_t timeNs)
+{
+    uint32_t *const pixels = Export_BeginFrame(&app->frameExport, screenWidth, screenHeight);
 
-    if (screenProps.x < 0.0 || screenProps.y < 0.0 || screenProps.x > 1.0 || screenProps.y > 1.0) {
-        return (MaybeV2i) { false };
+    if (pixels == NULL || !ReadFrame(app, screenWidth, pixels, "EXPORT FRAME")) {
+        return NULL;
     }
 
-    int screenX;
-    int screenY;
+    Export_EndFrame(&app->frameExport, timeNs);
+    return pixels;
+}
 
-    Sdlu_GetRendererOutputSize(app->renderer, &screenX, &screenY);
+// Add the frame just drawn to the instant replay.
+// `shown` is the frame already read back, or NULL to read it back here.
+static void RecordReplayFrame(App *const app, const int screenWidth, const int screenHeight,
+    const uint64_t timeNs, const uint32_t *const shown)
+{
+    uint32_t *const pixels = Replay_BeginFrame(&app->replay, screenWidth, screenHeight);
 
-    return (MaybeV2i) {
-        true,
-        (V2i) {
-            (int)round(screenProps.x * (screenX - 1.0)),
-            (int)round(screenProps.y * (screenY - 1.0))
-        }
+    if (pixels == NULL) {
+        return;
+    }
+
+    // Copying is much cheaper than reading back from the renderer again.
+    if (shown != NULL) {
+        memcpy(pixels, shown, (size_t)screenWidth * (size_t)screenHeight * sizeof(uint32_t));
+    }
+    else if (!ReadFrame(app, screenWidth, pixels, "RECORD REPLAY FRAME")) {
+        Replay_CancelFrame(&app->replay);
+        return;
+    }
+
+    Replay_EndFrame(&app->replay, timeNs);
+}
+
+// Set `*px` and `*py` to the pixel being pointed at: the mouse, or the middle
+// of the screen while the mouse is captured to turn the camera.
+static void GetHoverPixel(App *const app, const int screenWidth, const int screenHeight,
+    double *const px, double *const py)
+{
+    if (SDL_GetRelativeMouseMode()) {
+        *px = (screenWidth - 1.0) / 2.0;
+        *py = (screenHeight - 1.0) / 2.0;
+        return;
+    }
+
+    int mouseX;
+    int mouseY;
+    SDL_GetMouseState(&mouseX, &mouseY);
+
+    // Mouse is in window coordinates, which differ from pixels on high-DPI displays.
+    int windowWidth;
+    int windowHeight;
+    SDL_GetWindowSize(app->window, &windowWidth, &windowHeight);
+
+    *px = (windowWidth > 0) ? mouseX * (double)screenWidth / windowWidth : mouseX;
+    *py = (windowHeight > 0) ? mouseY * (double)screenHeight / windowHeight : mouseY;
+}
+
+// Set the cells covered by the grid instances: from `*first`, `*size` of them.
+static void GetGridField(const App *const app, Grid_Cell *const first, Grid_Cell *const size) {
+    // Matches the layout of `Grid_MakeTiles`.
+    const int tilesPerSide = app->gridTiled ? APP_GRID_TILES_PER_SIDE : 1;
+    const int firstTile = -(tilesPerSide / 2);
+
+    *first = (Grid_Cell) {firstTile * app->grid.numCellsX, firstTile * app->grid.numCellsY};
+    *size = (Grid_Cell) {tilesPerSide * app->grid.numCellsX, tilesPerSide * app->grid.numCellsY};
+}
+
+// Return true if `cell` is part of one of the grid instances.
+static bool IsGridCell(const App *const app, const Grid_Cell cell) {
+    Grid_Cell first;
+    Grid_Cell size;
+    GetGridField(app, &first, &size);
+
+    return cell.x >= first.x && cell.x < first.x + size.x
+        && cell.y >= first.y && cell.y < first.y + size.y;
+}
+
+// Append the outline of `cell` to `lines` in `color`.
+static void EmitCellOutline(Lines *const lines, const Ortho_View *const view,
+    const Grid *const grid, const Grid_Cell cell, const Rgba color)
+{
+    const double x0 = cell.x * grid->cellWidth;
+    const double y0 = cell.y * grid->cellWidth;
+    const double x1 = x0 + grid->cellWidth;
+    const double y1 = y0 + grid->cellWidth;
+
+    const V3d corners[4] = {
+        Ortho_Project(view, (V3d) {x0, y0, 0.0}),
+        Ortho_Project(view, (V3d) {x1, y0, 0.0}),
+        Ortho_Project(view, (V3d) {x1, y1, 0.0}),
+        Ortho_Project(view, (V3d) {x0, y1, 0.0})
     };
+
+    Lines_SetColor(lines, color);
+
+    for (int i = 0; i < 4; i += 1) {
+        const V3d a = corners[i];
+        const V3d b = corners[(i + 1) % 4];
+
+        if (a.z > 0.0 && b.z > 0.0) {
+            Lines_Push(lines, (Lines_Seg) {(float)a.x, (float)a.y, (float)b.x, (float)b.y});
+        }
+    }
 }
 
-// // Currently not used.
-// static void MaybeDrawPoint(App *app, V3d point, V3d look, V3d lookRight, V3d lookUp) {
-//     MaybeV2i maybePixel = PointToPixel(app, point, look, lookRight, lookUp);
-//
-//     if (maybePixel.hasValue) {
-//         fprintf(stdout, "maybePixel: (%d, %d)\n",
-//             maybePixel.value.x, maybePixel.value.y);
-//
-//         Sdlu_RenderDrawPoint(
-//             app->renderer, maybePixel.value.x, maybePixel.value.y);
-//     }
-// }
+// Replace the grid instances with a single grid at the world origin
+// or with a `tilesPerSide` by `tilesPerSide` field of grids
+// centered on the world origin in two alternating colors.
+static void SetGridTiles(App *const app, const int tilesPerSide) {
+    const size_t numInstances = (size_t)tilesPerSide * (size_t)tilesPerSide;
+
+    app->gridInstances = Mem_ReallocTagged(app->gridInstances,
+        numInstances * sizeof(Grid_Instance), MEM_TAG_APP);
+    app->numGridInstances = numInstances;
+
+    Grid_MakeTiles(&app->grid, tilesPerSide,
+        APP_GRID_COLOR, APP_GRID_ALT_COLOR, app->gridInstances);
+
+    // Worst case every instance is visible. Reserve now so drawing never allocates.
+    // Styled instances add a run per style. The hover outline adds one run of 4 lines.
+    const size_t numLines = Grid_NumLines(&app->grid);
+    const size_t chunkSize = Grid_ChunkSize(numInstances, APP_JOB_CHUNKS);
+    const size_t numSegs = numInstances * numLines + 4;
+    const size_t numRuns = numInstances * GRID_NUM_STYLES + 1;
+    Grid_ReserveProjection(&app->gridProjection, numLines);
+    Grid_ReserveProjection(&app->coarseGridProjection, numLines);
+    Grid_ReserveProjection(&app->gridProjectionCache.base, numLines);
+    Lines_Reserve(&app->lines, numSegs, numRuns);
+    Layers_Reserve(&app->lineLayers, numSegs, numRuns);
+
+    for (int k = 0; k < APP_JOB_CHUNKS; k += 1) {
+        Lines_Reserve(&app->chunkLines[k], chunkSize * numLines, chunkSize * GRID_NUM_STYLES + 1);
+    }
 
-// Converting spherical coordinates to a vector.
-// radius = 1.0 so not shown and no need to normalize the vector.
-static inline V3d SphericalToCartesian(const double horizLookRads, const double vertLookRads) {
-    return (V3d) {
-        sin(vertLookRads) * cos(horizLookRads),
-        sin(vertLookRads) * sin(horizLookRads),
-        cos(vertLookRads)
+    // Let SDL's own buffers settle before checking for allocations again.
+    app->memWarmupFrames = APP_MEM_WARMUP_FRAMES;
+}
+
+// Return the smallest number of lines between labels that puts labels at least
+// `minSpacing` pixels apart, when adjacent lines are `lineSpacing` pixels apart.
+// One of 1, 2, 5, 10, 20, 50 and so on.
+static int LabelStep(const double lineSpacing, const double minSpacing) {
+    int step = 1;
+
+    for (int k = 0; step < INT_MAX / 10 && step * lineSpacing < minSpacing; k += 1) {
+        step = (k % 3 == 1) ? step * 5 / 2 : step * 2;
+    }
+
+    return step;
+}
+
+// Like `LabelStep` but, unless every line fits a label, a multiple of
+// `APP_GRID_MAJOR_EVERY` so that only major lines are labeled.
+static int MajorLabelStep(const double lineSpacing, const double minSpacing) {
+    if (lineSpacing >= minSpacing) {
+        return 1;
+    }
+
+    const int major = APP_GRID_MAJOR_EVERY;
+    const int step = LabelStep(lineSpacing * major, minSpacing);
+
+    return (step <= INT_MAX / major) ? major * step : step;
+}
+
+// Where segment `a`-`b` of projections first enters the screen, shrunk by `margin`
+// on each side, in front of the camera. Return false if it never does.
+static bool EnterScreen(const V3d a, const V3d b, const int screenWidth, const int screenHeight,
+    const double margin, V3d *const enter)
+{
+    const V3d d = V3d_Sub(b, a);
+    double t1 = 0.0;
+    double t2 = 1.0;
+
+    // Each side as: inside where `offset + t * slope >= 0`.
+    const double offsets[5] = {
+        a.x - margin, screenWidth - 1.0 - margin - a.x,
+        a.y - margin, screenHeight - 1.0 - margin - a.y,
+        a.z
     };
+    const double slopes[5] = {d.x, -d.x, d.y, -d.y, d.z};
+
+    for (int i = 0; i < 5; i += 1) {
+        if (slopes[i] == 0.0) {
+            if (offsets[i] < 0.0) {
+                return false;
+            }
+        }
+        else {
+            const double t = -offsets[i] / slopes[i];
+
+            if (slopes[i] > 0.0) {
+                t1 = fmax(t1, t);
+            }
+            else {
+                t2 = fmin(t2, t);
+            }
+        }
+    }
+
+    if (t1 > t2) {
+        return false;
+    }
+
+    *enter = V3d_Add(a, V3d_Mul(d, t1));
+    return true;
+}
+
+// Label every line, or if they are too close every few major lines, with its
+// index where it enters the screen coming from the edge of the grid field.
+// Fewer major lines are labeled when zoomed out.
+static void EmitGridLabels(App *const app, const Ortho_View *const view) {
+    Labels_Clear(&app->labels);
+
+    Grid_Cell first;
+    Grid_Cell size;
+    GetGridField(app, &first, &size);
+
+    const double width = app->grid.cellWidth;
+
+    for (int axis = 0; axis < 2; axis += 1) {
+        // Lines of constant x (axis 0) run along y and the other way round.
+        const V3d across = (axis == 0) ? (V3d) {width, 0.0, 0.0} : (V3d) {0.0, width, 0.0};
+        const V3d lineSpacing = Ortho_ProjectOffset(view, across);
+        const int step = MajorLabelStep(hypot(lineSpacing.x, lineSpacing.y), APP_LABEL_SPACING);
+
+        const int firstLine = (axis == 0) ? first.x : first.y;
+        const int lastLine = firstLine + ((axis == 0) ? size.x : size.y);
+        const double start = ((axis == 0) ? first.y : first.x) * width;
+        const double end = start + ((axis == 0) ? size.y : size.x) * width;
+
+        // First multiple of `step`, rounding toward positive infinity.
+        const int q = firstLine / step;
+        int line = (q * step >= firstLine) ? q * step : (q + 1) * step;
+
+        for (; line <= lastLine; line += step) {
+            const double at = line * width;
+            const V3d a = (axis == 0) ? (V3d) {at, start, 0.0} : (V3d) {start, at, 0.0};
+            const V3d b = (axis == 0) ? (V3d) {at, end, 0.0} : (V3d) {end, at, 0.0};
+
+            V3d enter;
+
+            if (!EnterScreen(Ortho_Project(view, a), Ortho_Project(view, b),
+                view->screenWidth, view->screenHeight, APP_LABEL_MARGIN, &enter))
+            {
+                continue;
+            }
+
+            if (!Labels_Add(&app->labels, line, (float)enter.x, (float)enter.y, APP_LABEL_COLOR)) {
+                return;
+            }
+        }
+    }
 }
 
 void App_Run(App *const app) {
     uint64_t oldTimeNs = Clock_GetTimeNs();
     uint64_t accumulatedNs = 0;
-    const uint64_t periodNs = 1000000000 / 60;
+    const uint64_t periodNs = APP_FRAME_PERIOD_NS;
 
     while (!app->quit) {
         const uint64_t newTimeNs = Clock_GetTimeNs();
@@ -408,14 +1002,14 @@ void App_Run(App *const app) {
         // printf("oldTimeNs: %ld newTimeNs: %ld\n", oldTimeNs, newTimeNs);
         // printf("accumulatedNs: %ld\n", accumulatedNs);
 
+        Perf_BeginStage(&app->perf, PERF_STAGE_EVENTS);
         PollEvents(app, ddeltaNs);
+        Perf_EndStage(&app->perf, PERF_STAGE_EVENTS);
 
-        // Direction camera is looking.
-        V3d look = SphericalToCartesian(app->horizLookRads, app->vertLookRads);
+        // Everything from here until presenting should not touch the heap.
+        Mem_BeginNoAlloc();
 
-        // Calculate the up vector.
-        const double lookUpRads = app->vertLookRads + (M_PI / 2.0);
-        V3d lookUp = SphericalToCartesian(app->horizLookRads, lookUpRads);
+        Perf_BeginStage(&app->perf, PERF_STAGE_UPDATE);
 
         V3d xyForward = (V3d) {
             cos(app->horizLookRads),
@@ -430,9 +1024,6 @@ void App_Run(App *const app) {
             0.0
         };
 
-        // Assume camera never has roll (only pitch and yaw).
-        V3d lookRight = xyRight;
-
         const uint8_t *const kbState = SDL_GetKeyboardState(NULL);
 
         // Movement speed.
@@ -466,101 +1057,296 @@ void App_Run(App *const app) {
             app->cameraPos.z += moveFactor * ddeltaNs;
         }
 
+        if (app->heatmapMode) {
+            UpdateHeatmapValues(app, newTimeNs);
+        }
+
         // fprintf(stdout, "Look angles: (%lf, %lf)\n",
         //     app->horizLookRads, app->vertLookRads);
         // printf("app->cameraPos: (%lf, %lf, %lf)\n",
         //     app->cameraPos.x, app->cameraPos.y, app->cameraPos.z);
 
+        Perf_EndStage(&app->perf, PERF_STAGE_UPDATE);
+
         // Render
 
-        // Fill screen with solid color.
-        Sdlu_SetRenderDrawColor(app->renderer, 255, 255, 255, 255);
-        Sdlu_RenderFillRect(app->renderer, NULL);
+        Perf_BeginStage(&app->perf, PERF_STAGE_PROJECT);
 
-        const double cellWidth = 22.0;
-        const double gridWidth = cellWidth * 22.0;
-        const double gridHeight = cellWidth * 11.0;
+        int screenWidth;
+        int screenHeight;
+        Sdlu_GetRendererOutputSize(app->renderer, &screenWidth, &screenHeight);
 
-        Sdlu_SetRenderDrawColor(app->renderer, 55, 55, 255, 255);
+        Ortho_View view;
+        Ortho_InitView(&view,
+            app->cameraPos,
+            app->horizLookRads, app->vertLookRads,
+            app->projPlaneWidth, app->projPlaneHeight,
+            screenWidth, screenHeight);
 
-        // Draw lines on xy plane parallel to x-axis.
-        for (double y = 0.0; y <= gridHeight; y += cellWidth) {
-            // The start and end points of the line in world space.
-            V3d worldStart = (V3d) {0.0, y, 0.0};
-            V3d worldEnd = (V3d) {gridWidth, y, 0.0};
+        Lines_Clear(&app->lines);
 
-            MaybeV2i maybeStart = PointToPixel(app, worldStart, look, lookRight, lookUp);
+        // Work shed by the governor to stay within the frame budget.
+        const Governor_Level quality = app->governed ? app->governor.level : GOVERNOR_FULL;
+        const bool drawOverlays = quality < GOVERNOR_NO_OVERLAYS;
 
-            if (!maybeStart.hasValue) {
-                continue;
+        if (app->heightfieldMode) {
+            // Center the heightfield window where the middle of the screen meets z = 0.
+            V3d center = app->cameraPos;
+
+            if (fabs(view.lookForward.z) > 1e-3) {
+                const double t = -app->cameraPos.z / view.lookForward.z;
+                center = V3d_Add(app->cameraPos, V3d_Mul(view.lookForward, t));
             }
 
-            MaybeV2i maybeEnd = PointToPixel(app, worldEnd, look, lookRight, lookUp);
+            Terrain_EmitParallel(&app->terrain, &view, center, (Rgba) {40, 140, 60, 255},
+                &app->jobs, app->chunkLines, APP_JOB_CHUNKS, &app->lines);
 
-            if (!maybeEnd.hasValue) {
-                continue;
+            app->hovering = false;
+        }
+        else {
+            if (app->heatmapMode) {
+                Heatmap_Update(&app->heatmap, &view, &app->jobs);
             }
 
-            Sdlu_RenderDrawLine(app->renderer,
-                maybeStart.value.x, maybeStart.value.y,
-                maybeEnd.value.x, maybeEnd.value.y);
-        }
+            // Project the template grid once. Every instance is a screen-space shift of it.
+            // If the camera only moved or zoomed since the last projection, shift and scale that.
+            Grid_ProjectCached(&app->grid, &view, &app->gridProjectionCache, &app->gridProjection);
 
-        // Draw lines on xy plane parallel to y-axis.
-        for (double x = 0.0; x <= gridWidth; x += cellWidth) {
-            // The start and end points of the line in world space.
-            V3d worldStart = (V3d) {x, 0.0, 0.0};
-            V3d worldEnd = (V3d) {x, gridHeight, 0.0};
+            const Grid_Projection *gridProjection = &app->gridProjection;
 
-            MaybeV2i maybeStart = PointToPixel(app, worldStart, look, lookRight, lookUp);
+            if (quality >= GOVERNOR_COARSE_GRID) {
+                Grid_ThinProjection(&app->grid, &app->gridProjection, APP_COARSE_GRID_STRIDE,
+                    &app->coarseGridProjection);
+                gridProjection = &app->coarseGridProjection;
+            }
 
-            if (!maybeStart.hasValue) {
-                continue;
+            app->hovering = false;
+
+            if (drawOverlays) {
+                double hoverX;
+                double hoverY;
+                GetHoverPixel(app, screenWidth, screenHeight, &hoverX, &hoverY);
+
+                app->hovering = Grid_PickCell(&app->grid, &view, hoverX, hoverY, &app->hoverCell)
+                    && IsGridCell(app, app->hoverCell);
             }
 
-            MaybeV2i maybeEnd = PointToPixel(app, worldEnd, look, lookRight, lookUp);
+            const Grid_Styles styles = {
+                .cellWidth = app->grid.cellWidth,
+                .highlight = app->hovering,
+                .highlightRow = app->hoverCell.y,
+                .highlightColor = APP_GRID_HIGHLIGHT_COLOR,
+                .axisColor = APP_GRID_AXIS_COLOR,
+                .majorEvery = APP_GRID_MAJOR_EVERY,
+                .majorColor = APP_GRID_MAJOR_COLOR
+            };
+
+            Grid_EmitInstancesParallel(gridProjection, &view,
+                app->gridInstances, app->numGridInstances, &styles,
+                &app->jobs, app->chunkLines, APP_JOB_CHUNKS, &app->lines);
+
+            if (app->hovering) {
+                EmitCellOutline(&app->lines, &view, &app->grid, app->hoverCell, APP_HOVER_COLOR);
+            }
 
-            if (!maybeEnd.hasValue) {
-                continue;
+            if (app->showLabels && drawOverlays) {
+                EmitGridLabels(app, &view);
             }
+        }
+
+        if (app->pointsMode) {
+            // The target only grows when the window does or points are turned on,
+            // both of which restart warmup.
+            Points_ResizeTarget(&app->pointsTarget, screenWidth, screenHeight);
 
-            Sdlu_RenderDrawLine(app->renderer,
-                maybeStart.value.x, maybeStart.value.y,
-                maybeEnd.value.x, maybeEnd.value.y);
+            const size_t numToDraw = Points_NumToDraw(&app->points, &view, APP_POINTS_PER_PIXEL);
+            Points_Draw(&app->points, &view, numToDraw, &app->jobs, &app->pointsTarget);
+        }
+
+        Perf_EndStage(&app->perf, PERF_STAGE_PROJECT);
+
+        Perf_BeginStage(&app->perf, PERF_STAGE_DRAW);
+
+        // Fill screen with solid color.
+        Sdlu_SetRenderDrawColor(app->renderer, 255, 255, 255, 255);
+        Sdlu_RenderFillRect(app->renderer, NULL);
+
+        if (app->heatmapMode && !app->heightfieldMode) {
+            Heatmap_Draw(&app->heatmap, app->renderer);
+        }
+
+        if (app->pointsMode) {
+            DrawPoints(app);
+        }
+
+        // One call per color rather than per segment.
+        Layers_Build(&app->lineLayers, &app->lines);
+        Layers_Draw(&app->lineLayers, app->renderer);
+
+        if (app->showLabels && drawOverlays && !app->heightfieldMode) {
+            Labels_Draw(&app->labels, app->renderer);
         }
 
         // // Draw 4 different-colored points near world origin.
         // Sdlu_SetRenderDrawColor(app->renderer, 255, 255, 255, 255);
-        // MaybeDrawPoint(app, (V3d) {0.0, 0.0, 0.0}, look, lookRight, lookUp);
+        // MaybeDrawPoint(app, &view, (V3d) {0.0, 0.0, 0.0});
         //
         // Sdlu_SetRenderDrawColor(app->renderer, 255, 0, 0, 255);
-        // MaybeDrawPoint(app, (V3d) {100.0, 0.0,  0.0}, look, lookRight, lookUp);
+        // MaybeDrawPoint(app, &view, (V3d) {100.0, 0.0,  0.0});
         //
         // Sdlu_SetRenderDrawColor(app->renderer, 0, 255, 0, 255);
-        // MaybeDrawPoint(app, (V3d) {100.0, 100.0, 0.0}, look, lookRight, lookUp);
+        // MaybeDrawPoint(app, &view, (V3d) {100.0, 100.0, 0.0});
         //
         // Sdlu_SetRenderDrawColor(app->renderer, 0, 0, 255, 255);
-        // MaybeDrawPoint(app, (V3d) {0.0, 100.0, 0.0}, look, lookRight, lookUp);
+        // MaybeDrawPoint(app, &view, (V3d) {0.0, 100.0, 0.0});
+
+        Perf_EndStage(&app->perf, PERF_STAGE_DRAW);
+
+        if (app->memWarmupFrames > 0) {
+            app->memWarmupFrames -= 1;
+        }
+        else {
+            Mem_EndNoAlloc("App_Run update/project/draw");
+        }
+
+        // Read back before presenting, after which the back buffer is undefined.
+        if (app->exporting || app->replaying) {
+            Perf_BeginStage(&app->perf, PERF_STAGE_CAPTURE);
+
+            const uint32_t *shown = NULL;
 
+            if (app->exporting) {
+                shown = ExportFrame(app, screenWidth, screenHeight, newTimeNs);
+            }
+
+            if (app->replaying) {
+                RecordReplayFrame(app, screenWidth, screenHeight, newTimeNs, shown);
+            }
+
+            Perf_EndStage(&app->perf, PERF_STAGE_CAPTURE);
+        }
+
+        Perf_BeginStage(&app->perf, PERF_STAGE_PRESENT);
+        const uint64_t presentStartNs = Clock_GetTimeNs();
         SDL_RenderPresent(app->renderer);
+        const uint64_t presentNs = Clock_GetTimeNs() - presentStartNs;
+        Perf_EndStage(&app->perf, PERF_STAGE_PRESENT);
+
+        if (app->capturingLines) {
+            Perf_BeginStage(&app->perf, PERF_STAGE_CAPTURE);
+
+            const Capture_Frame frame = {
+                .frameNum = app->capture.numFrames + 1,
+                .screenWidth = screenWidth,
+                .screenHeight = screenHeight,
+                .cameraPos = app->cameraPos,
+                .horizLookRads = app->horizLookRads,
+                .vertLookRads = app->vertLookRads,
+                .projPlaneFactor = app->projPlaneFactor
+            };
+
+            if (!Capture_WriteFrame(&app->capture, &frame, &app->lines)) {
+                Capture_Close(&app->capture);
+                app->capturingLines = false;
+            }
+
+            Perf_EndStage(&app->perf, PERF_STAGE_CAPTURE);
+        }
 
         if (app->recording) {
-            #define APP_FRAME_PATH_LEN 1024
+            Perf_BeginStage(&app->perf, PERF_STAGE_CAPTURE);
+
             char path[APP_FRAME_PATH_LEN];
             snprintf(path, APP_FRAME_PATH_LEN, "screenshots/frame_%ld_%d.bmp",
                 app->recordingId, app->frameNum);
 
-            SaveBmp(app->renderer, path);
+            SaveBmp(app, path);
 
             app->frameNum += 1;
+
+            Perf_EndStage(&app->perf, PERF_STAGE_CAPTURE);
         }
 
+        // Presenting can wait for vertical sync, which is not work that can be shed.
+        if (app->governed) {
+            Governor_Update(&app->governor, Clock_GetTimeNs() - newTimeNs - presentNs);
+        }
+
+        Perf_EndFrame(&app->perf);
+        Mem_EndFrame();
+
         end_of_while_loop:
         oldTimeNs = newTimeNs;
     }
 }
 
 void App_Deinit(App *const app) {
+    WriteProfile();
+    Prof_PrintStats(stdout);
+    Prof_Stop();
+
+    if (app->capturingLines) {
+        Capture_Close(&app->capture);
+    }
+
+    if (app->heatmapStarted) {
+        Heatmap_Deinit(&app->heatmap);
+    }
+
+    if (app->pointsTexture != NULL) {
+        SDL_DestroyTexture(app->pointsTexture);
+    }
+
+    Labels_Deinit(&app->labels);
+
+    if (app->pointsLoaded) {
+        Points_Deinit(&app->points);
+    }
+
+    Points_DeinitTarget(&app->pointsTarget);
+
+    if (app->terrainStarted) {
+        Terrain_PrintStats(&app->terrain, stdout);
+        Terrain_Deinit(&app->terrain);
+    }
+
+    if (app->governed) {
+        Governor_PrintSummary(&app->governor, stdout);
+    }
+
+    Layers_PrintSummary(&app->lineLayers, stdout);
+    Layers_Deinit(&app->lineLayers);
+
+    if (app->replaying) {
+        Replay_PrintSummary(&app->replay, stdout);
+        Replay_Deinit(&app->replay);
+    }
+
+    if (app->exporting) {
+        Export_Close(&app->frameExport);
+    }
+
+    Perf_PrintSummary(&app->perf, stdout);
+    Perf_Deinit(&app->perf);
+
+    Jobs_Deinit(&app->jobs);
+
+    for (int k = 0; k < APP_JOB_CHUNKS; k += 1) {
+        Lines_Deinit(&app->chunkLines[k]);
+    }
+
+    Lines_Deinit(&app->lines);
+    Grid_DeinitProjectionCache(&app->gridProjectionCache);
+    Grid_DeinitProjection(&app->coarseGridProjection);
+    Grid_DeinitProjection(&app->gridProjection);
+    Mem_Free(app->gridInstances);
+    SDL_FreeSurface(app->recordSurface);
+    Mem_Free(app->recordPixels);
+
+    if (app->memCheck) {
+        Mem_PrintStats(stdout);
+    }
+
     SDL_DestroyWindow(app->window);
     SDL_DestroyRenderer(app->renderer);
     SDL_Quit();
@@ -6,12 +6,108 @@
 
 #include "SDL2/SDL.h"
 
+#include "Capture.h"
+#include "Export.h"
+#include "Governor.h"
+#include "Grid.h"
+#include "Heatmap.h"
+#include "Jobs.h"
+#include "Labels.h"
+#include "Layers.h"
+#include "Lines.h"
+#include "Perf.h"
+#include "Points.h"
+#include "Replay.h"
+#include "Terrain.h"
 #include "V3d.h"
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
+// Time between frames.
+#define APP_FRAME_PERIOD_NS (1000000000 / 60)
+
+// Lines of each grid instance kept at `GOVERNOR_COARSE_GRID`: one in this many.
+#define APP_COARSE_GRID_STRIDE 2
+
+// Size of one grid instance.
+#define APP_GRID_CELL_WIDTH 22.0
+#define APP_GRID_NUM_CELLS_X 22
+#define APP_GRID_NUM_CELLS_Y 11
+
+// Number of grid instances along each side when the grid is tiled.
+#define APP_GRID_TILES_PER_SIDE 64
+
+// Colors of grid instances. Tiled instances alternate between the two.
+#define APP_GRID_COLOR ((Rgba) {55, 55, 255, 255})
+#define APP_GRID_ALT_COLOR ((Rgba) {255, 120, 55, 255})
+
+// Grid lines styled by where they are in the world, over the instance colors:
+// every `APP_GRID_MAJOR_EVERY` cells, through the origin, and bounding the
+// row of the cell under the mouse.
+#define APP_GRID_MAJOR_EVERY 5
+#define APP_GRID_MAJOR_COLOR ((Rgba) {20, 20, 120, 255})
+#define APP_GRID_AXIS_COLOR ((Rgba) {0, 150, 0, 255})
+#define APP_GRID_HIGHLIGHT_COLOR ((Rgba) {230, 180, 0, 255})
+
+// Outline color of the grid cell under the mouse.
+#define APP_HOVER_COLOR ((Rgba) {220, 30, 30, 255})
+
+// Frames after startup or a change of scene or window size
+// during which steady-state allocation checking is skipped.
+#define APP_MEM_WARMUP_FRAMES 60
+
+// Most chunks per-frame work is split into for the job system.
+// Several per worker so that stealing can even out the load.
+#define APP_JOB_CHUNKS 64
+
+// Heightfield tiles are read from this directory.
+#define APP_HEIGHTFIELD_DIR "heightfield"
+
+// Memory budget of the heightfield tile cache.
+#define APP_HEIGHTFIELD_BUDGET_BYTES (32u * 1024u * 1024u)
+
+// Cells along each side of the heatmap layer, centered on the world origin.
+#define APP_HEATMAP_CELLS_PER_SIDE 1024
+
+// Heatmap rows given new values each frame, to stand in for live data.
+#define APP_HEATMAP_ROWS_PER_FRAME 8
+
+// Grid line labels: text color, fewest pixels between labels, and
+// pixels kept between labels and the screen edge.
+#define APP_LABEL_COLOR ((Rgba) {30, 30, 30, 255})
+#define APP_LABEL_SPACING 48.0
+#define APP_LABEL_MARGIN 12.0
+
+// Point cloud decimation: most points drawn per pixel the cloud covers.
+#define APP_POINTS_PER_PIXEL 2.0
+
+// Instant replay (B key): memory for compressed frames. Fewer seconds than asked
+// for are kept when frames compress poorly.
+#define APP_REPLAY_RING_BYTES ((size_t)256 * 1024 * 1024)
+
+// Frames shared with other processes (`--export`): slots in the ring and the
+// largest frame shared. Slot memory is only used up to the size of the frames.
+#define APP_EXPORT_SLOTS 4
+#define APP_EXPORT_MAX_WIDTH 3840
+#define APP_EXPORT_MAX_HEIGHT 2160
+
+// Settings chosen at startup, e.g. from the command line.
+typedef struct AppOptions {
+    bool perfCounters;    // Sample hardware counters around each stage of a frame.
+    bool perfPrintFrames; // Also print counters for every frame.
+    bool memCheck;        // Flag heap allocations in the steady-state frame loop.
+    int numThreads;       // Threads for per-frame work. 0 means one per CPU.
+    int profHz;           // Sampling profiler rate. 0 means off.
+    const char *pointsPath; // Point cloud file to show. NULL means none.
+    SDL_Rect recordRect;    // Part of the screen recorded (R key). Empty means all of it.
+    int recordScale;        // Recorded frames are shrunk by this: 1, 2 or 4.
+    bool governor;          // Shed work when frames take longer than their period.
+    double replaySeconds;   // Length of the instant replay. 0 means off.
+    const char *exportName; // Shared memory object to share frames through. NULL means none.
+} AppOptions;
+
 typedef struct {
     SDL_Window *window;
     SDL_Renderer *renderer;
@@ -20,6 +116,24 @@ typedef struct {
     bool recording;     // Whether saving each frame.
     time_t recordingId; // Used in frame file names so the frames are grouped.
     uint32_t frameNum;  // Start at 1.
+    SDL_Rect recordRect; // See `AppOptions`.
+    int recordScale;
+    uint32_t *recordPixels; // Pixels read back while recording. Kept between frames.
+    size_t recordPixelsCap;
+    SDL_Surface *recordSurface; // Wraps the saved part of `recordPixels`. Kept between frames.
+
+    // Frames shared with other processes. See `Export.h`.
+    bool exporting;
+    Export frameExport;
+
+    // Last seconds of frames kept in memory to save with B. See `Replay.h`.
+    bool replaying;
+    Replay replay;
+
+    // Whether writing the drawn line segments of each frame to `capture`.
+    // Much smaller than saving pixels. Render them with `capture_render.bin`.
+    bool capturingLines;
+    Capture capture;
 
     // Right-handed coordinate system. Positive z is down. Haha.
 
@@ -43,10 +157,65 @@ typedef struct {
     // Dimensions of projection plane before scaling.
     double baseProjPlaneWidth;
     double baseProjPlaneHeight;
+
+    // Template grid. Drawn once per instance.
+    Grid grid;
+    Grid_Instance *gridInstances;
+    size_t numGridInstances;
+    bool gridTiled; // Whether showing many instances instead of one.
+
+    // Grid cell under the mouse, or under the middle of the screen while
+    // the mouse turns the camera. Found by unprojecting, not by testing cells.
+    bool hovering;
+    Grid_Cell hoverCell;
+
+    // Heightfield mode draws a streamed heightfield instead of the grid instances.
+    bool heightfieldMode;
+    bool terrainStarted; // Whether `terrain` has been initialized.
+    Terrain terrain;
+
+    // Heatmap mode fills grid cells with colors from changing per-cell values.
+    bool heatmapMode;
+    bool heatmapStarted; // Whether `heatmap` has been initialized.
+    Heatmap heatmap;
+    int heatmapNextRow; // Next row to give new values.
+
+    // Grid line indices drawn along where the lines enter the screen.
+    bool showLabels;
+    Labels labels;
+
+    // Point cloud drawn into `pointsTarget` by the job system, then uploaded
+    // to `pointsTexture` and drawn under the lines.
+    bool pointsMode;
+    bool pointsLoaded; // Whether `points` holds a cloud.
+    Points points;
+    Points_Target pointsTarget;
+    SDL_Texture *pointsTexture; // NULL until first drawn.
+    int pointsTextureWidth;
+    int pointsTextureHeight;
+
+    // Per-frame scratch buffers. Kept to avoid reallocating every frame.
+    Grid_Projection gridProjection;
+    Grid_ProjectionCache gridProjectionCache; // Lets panning and zooming skip projecting.
+    Grid_Projection coarseGridProjection; // Thinned `gridProjection` when over budget.
+    Lines lines;
+    Lines chunkLines[APP_JOB_CHUNKS]; // Output of each job chunk before merging into `lines`.
+    Layers lineLayers; // `lines` bucketed by color for drawing.
+
+    Jobs jobs;
+
+    // Lowers quality while frames take longer than their period. See `Governor.h`.
+    bool governed;
+    Governor governor;
+
+    Perf perf; // Hardware counters. Disabled unless requested and available.
+
+    bool memCheck;
+    int memWarmupFrames; // Frames left before allocations are checked again.
 } App;
 
-// Initialize `app`.
-void App_Init(App *const app);
+// Initialize `app` using `options`.
+void App_Init(App *const app, const AppOptions *const options);
 
 // Run the app until user quits.
 void App_Run(App *const app);
@@ -0,0 +1,189 @@
+#include "Batch.h"
+
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "Clock.h"
+#include "Jobs.h"
+#include "Lines.h"
+#include "Mem.h"
+#include "Ortho.h"
+#include "Raster.h"
+
+#define BATCH_LINE_LEN 512
+#define BATCH_PATH_LEN 4096
+
+// Scratch memory of one worker. Reused from pose to pose so that
+// after the first few images nothing is allocated.
+typedef struct BatchWorker {
+    Raster raster;
+    Lines lines;
+    Grid_Projection proj;
+    Grid_ProjectionCache projCache; // Poses that share look angles skip projecting.
+} BatchWorker;
+
+typedef struct BatchCtx {
+    const Batch_Scene *scene;
+    const Batch_Pose *poses;
+    const char *outDir;
+    BatchWorker *workers; // One per worker of the job system.
+    atomic_size_t numFailed;
+    atomic_size_t numSegs; // Total over all images.
+} BatchCtx;
+
+Batch_Pose *Batch_ReadPoses(const char *const path, size_t *const numPoses) {
+    FILE *const file = fopen(path, "r");
+
+    if (file == NULL) {
+        fprintf(stderr, "%s: Failed to open %s\n", __func__, path);
+        return NULL;
+    }
+
+    Batch_Pose *poses = NULL;
+    size_t count = 0;
+    size_t cap = 0;
+    char line[BATCH_LINE_LEN];
+
+    for (int lineNum = 1; fgets(line, sizeof(line), file) != NULL; lineNum += 1) {
+        char first = '\0';
+
+        if (sscanf(line, " %c", &first) != 1 || first == '#') {
+            continue;
+        }
+
+        Batch_Pose pose;
+
+        const int numRead = sscanf(line, "%lf %lf %lf %lf %lf %lf %d %d",
+            &pose.cameraPos.x, &pose.cameraPos.y, &pose.cameraPos.z,
+            &pose.horizLookRads, &pose.vertLookRads, &pose.projPlaneFactor,
+            &pose.width, &pose.height);
+
+        if (numRead != 8 || pose.width <= 0 || pose.height <= 0 || pose.projPlaneFactor <= 0.0) {
+            fprintf(stderr, "%s: %s:%d: Expected "
+                "x y z horizLookRads vertLookRads projPlaneFactor width height\n",
+                __func__, path, lineNum);
+            Mem_Free(poses);
+            fclose(file);
+            return NULL;
+        }
+
+        if (count == cap) {
+            cap = (cap == 0) ? 64 : cap * 2;
+            poses = Mem_Realloc(poses, cap * sizeof(Batch_Pose));
+        }
+
+        poses[count] = pose;
+        count += 1;
+    }
+
+    fclose(file);
+
+    if (count == 0) {
+        fprintf(stderr, "%s: No poses in %s\n", __func__, path);
+        return NULL;
+    }
+
+    *numPoses = count;
+    return poses;
+}
+
+static void RenderPoses(void *const ctx, const size_t chunk, const size_t begin, const size_t end) {
+    (void)chunk;
+
+    BatchCtx *const batch = ctx;
+    const Batch_Scene *const scene = batch->scene;
+    BatchWorker *const worker = &batch->workers[Jobs_WorkerIndex()];
+
+    for (size_t i = begin; i < end; i += 1) {
+        const Batch_Pose *const pose = &batch->poses[i];
+
+        Ortho_View view;
+        Ortho_InitView(&view,
+            pose->cameraPos,
+            pose->horizLookRads, pose->vertLookRads,
+            pose->width * pose->projPlaneFactor, pose->height * pose->projPlaneFactor,
+            pose->width, pose->height);
+
+        Grid_ProjectCached(scene->grid, &view, &worker->projCache, &worker->proj);
+        Lines_Clear(&worker->lines);
+        Grid_EmitInstances(&worker->proj, &view, scene->instances, scene->numInstances, scene->styles,
+            &worker->lines);
+
+        Raster_Resize(&worker->raster, pose->width, pose->height);
+        Raster_Clear(&worker->raster, scene->background);
+        Raster_DrawLines(&worker->raster, &worker->lines);
+
+        atomic_fetch_add_explicit(&batch->numSegs, worker->lines.numSegs, memory_order_relaxed);
+
+        char path[BATCH_PATH_LEN];
+        const int len = snprintf(path, sizeof(path), "%s/pose_%05zu.bmp", batch->outDir, i);
+
+        if (len < 0 || (size_t)len >= sizeof(path)) {
+            fprintf(stderr, "%s: Output path too long\n", __func__);
+            atomic_fetch_add_explicit(&batch->numFailed, 1, memory_order_relaxed);
+        }
+        else if (!Raster_WriteBmp(&worker->raster, path)) {
+            atomic_fetch_add_explicit(&batch->numFailed, 1, memory_order_relaxed);
+        }
+    }
+}
+
+bool Batch_Render(const Batch_Scene *const scene,
+    const Batch_Pose *const poses, const size_t numPoses,
+    const char *const outDir, const int numThreads)
+{
+    Jobs jobs;
+    Jobs_Init(&jobs, numThreads);
+
+    BatchCtx batch = {
+        .scene = scene,
+        .poses = poses,
+        .outDir = outDir,
+        .workers = Mem_Alloc((size_t)jobs.numWorkers * sizeof(BatchWorker))
+    };
+
+    atomic_init(&batch.numFailed, 0);
+    atomic_init(&batch.numSegs, 0);
+
+    for (int w = 0; w < jobs.numWorkers; w += 1) {
+        Raster_Init(&batch.workers[w].raster);
+        Lines_Init(&batch.workers[w].lines);
+        Grid_InitProjection(&batch.workers[w].proj);
+        Grid_InitProjectionCache(&batch.workers[w].projCache);
+    }
+
+    const uint64_t startNs = Clock_GetTimeNs();
+
+    // One pose per task. Poses can differ a lot in size so let stealing balance them.
+    Jobs_Counter counter;
+    Jobs_InitCounter(&counter);
+    Jobs_ParallelFor(&jobs, &counter, numPoses, 1, RenderPoses, &batch);
+    Jobs_Wait(&jobs, &counter);
+
+    const double seconds = (double)(Clock_GetTimeNs() - startNs) / 1e9;
+
+    for (int w = 0; w < jobs.numWorkers; w += 1) {
+        Raster_Deinit(&batch.workers[w].raster);
+        Lines_Deinit(&batch.workers[w].lines);
+        Grid_DeinitProjection(&batch.workers[w].proj);
+        Grid_DeinitProjectionCache(&batch.workers[w].projCache);
+    }
+
+    const int numWorkers = jobs.numWorkers;
+    Mem_Free(batch.workers);
+    Jobs_Deinit(&jobs);
+
+    const size_t numFailed = atomic_load(&batch.numFailed);
+
+    fprintf(stdout, "Rendered %zu images with %d threads in %.3f s: %.1f images/s, %.1f Msegs/s\n",
+        numPoses - numFailed, numWorkers, seconds,
+        (seconds > 0.0) ? (double)(numPoses - numFailed) / seconds : 0.0,
+        (seconds > 0.0) ? (double)atomic_load(&batch.numSegs) / seconds / 1e6 : 0.0);
+
+    if (numFailed > 0) {
+        fprintf(stderr, "%s: %zu images failed\n", __func__, numFailed);
+    }
+
+    return numFailed == 0;
+}
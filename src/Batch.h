@@ -0,0 +1,58 @@
+#ifndef BATCH_H
+#define BATCH_H
+
+// Offline rendering of one scene from many camera poses, without a window.
+// Poses are rendered in parallel on the job system, each worker drawing into
+// its own `Raster`, and written as .bmp images.
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "Grid.h"
+#include "Rgba.h"
+#include "V3d.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Camera state and output size of one image. See `App` for the meaning of the fields.
+// The projection plane is `width * projPlaneFactor` by `height * projPlaneFactor`,
+// as it is in a window of that size.
+typedef struct Batch_Pose {
+    V3d cameraPos;
+    double horizLookRads;
+    double vertLookRads;
+    double projPlaneFactor;
+    int width;
+    int height;
+} Batch_Pose;
+
+// What every pose looks at.
+typedef struct Batch_Scene {
+    const Grid *grid;
+    const Grid_Instance *instances;
+    size_t numInstances;
+    const Grid_Styles *styles; // NULL to draw lines in their instance's color.
+    Rgba background;
+} Batch_Scene;
+
+// Read poses from the text file at `path`, one per line:
+//  x y z horizLookRads vertLookRads projPlaneFactor width height
+// Blank lines and lines starting with `#` are skipped.
+// Return a `Mem_Alloc`ed array and set `*numPoses`.
+// If error, including a file without poses, print to `stderr` and return NULL.
+Batch_Pose *Batch_ReadPoses(const char *const path, size_t *const numPoses);
+
+// Render pose i of `poses` to `<outDir>/pose_<i>.bmp` using `numThreads` threads.
+// `outDir` must exist. Print images per second to `stdout` when done.
+// Return false if any image failed to be written.
+bool Batch_Render(const Batch_Scene *const scene,
+    const Batch_Pose *const poses, const size_t numPoses,
+    const char *const outDir, const int numThreads);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,257 @@
+#include "Capture.h"
+
+#include <inttypes.h>
+#include <math.h>
+#include <string.h>
+
+#include "Mem.h"
+
+#define CAPTURE_MAGIC "OGLC"
+
+// Bytes of a frame record before its runs, including the size field.
+#define CAPTURE_FRAME_HEADER (4 + 4 + 2 + 2 + 6 * 8 + 4)
+
+// Largest coordinate that fits in a u16 in subpixel units.
+#define CAPTURE_MAX_COORD (65535.0f / CAPTURE_SUBPIXELS)
+
+static uint8_t *Put16(uint8_t *const p, const uint16_t v) {
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+    return p + 2;
+}
+
+static uint8_t *Put32(uint8_t *const p, const uint32_t v) {
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+    p[2] = (uint8_t)(v >> 16);
+    p[3] = (uint8_t)(v >> 24);
+    return p + 4;
+}
+
+static uint8_t *PutF64(uint8_t *const p, const double v) {
+    uint64_t bits;
+    memcpy(&bits, &v, sizeof(bits));
+    Put32(p, (uint32_t)bits);
+    return Put32(p + 4, (uint32_t)(bits >> 32));
+}
+
+static uint16_t Get16(const uint8_t *const p) {
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static uint32_t Get32(const uint8_t *const p) {
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static double GetF64(const uint8_t *const p) {
+    const uint64_t bits = (uint64_t)Get32(p) | ((uint64_t)Get32(p + 4) << 32);
+    double v;
+    memcpy(&v, &bits, sizeof(v));
+    return v;
+}
+
+// Return `v` in subpixel units. `v` has been clipped to the screen.
+static uint16_t ToSubpixels(const float v) {
+    return (uint16_t)lroundf(fminf(fmaxf(v, 0.0f), CAPTURE_MAX_COORD) * CAPTURE_SUBPIXELS);
+}
+
+bool Capture_Open(Capture *const capture, const char *const path) {
+    *capture = (Capture) { 0 };
+    capture->file = fopen(path, "wb");
+
+    if (capture->file == NULL) {
+        fprintf(stderr, "%s: Failed to open %s\n", __func__, path);
+        return false;
+    }
+
+    uint8_t header[8];
+    memcpy(header, CAPTURE_MAGIC, 4);
+    Put32(header + 4, CAPTURE_VERSION);
+
+    if (fwrite(header, sizeof(header), 1, capture->file) != 1) {
+        fprintf(stderr, "%s: Failed to write %s\n", __func__, path);
+        fclose(capture->file);
+        capture->file = NULL;
+        return false;
+    }
+
+    capture->numBytes = sizeof(header);
+    return true;
+}
+
+void Capture_Close(Capture *const capture) {
+    if (capture->file != NULL) {
+        if (fclose(capture->file) != 0) {
+            fprintf(stderr, "%s: Failed to close capture file\n", __func__);
+        }
+
+        fprintf(stdout, "Captured %" PRIu32 " frames in %" PRIu64 " bytes (%.0f bytes per frame).\n",
+            capture->numFrames, capture->numBytes,
+            (capture->numFrames > 0) ? (double)capture->numBytes / capture->numFrames : 0.0);
+    }
+
+    Mem_Free(capture->buf);
+    *capture = (Capture) { 0 };
+}
+
+bool Capture_WriteFrame(Capture *const capture,
+    const Capture_Frame *const frame, const Lines *const lines)
+{
+    const size_t maxSize = CAPTURE_FRAME_HEADER + lines->numRuns * 8 + lines->numSegs * 8;
+
+    if (maxSize > capture->bufCap) {
+        capture->bufCap = maxSize + maxSize / 2;
+        capture->buf = Mem_ReallocTagged(capture->buf, capture->bufCap, MEM_TAG_CAPTURE);
+    }
+
+    uint8_t *p = capture->buf + 4; // Size is filled in at the end.
+    p = Put32(p, frame->frameNum);
+    p = Put16(p, (uint16_t)frame->screenWidth);
+    p = Put16(p, (uint16_t)frame->screenHeight);
+    p = PutF64(p, frame->cameraPos.x);
+    p = PutF64(p, frame->cameraPos.y);
+    p = PutF64(p, frame->cameraPos.z);
+    p = PutF64(p, frame->horizLookRads);
+    p = PutF64(p, frame->vertLookRads);
+    p = PutF64(p, frame->projPlaneFactor);
+
+    uint8_t *const numRunsAt = p;
+    p += 4;
+    uint32_t numRuns = 0;
+
+    for (size_t r = 0; r < lines->numRuns; r += 1) {
+        const Lines_Run *const run = &lines->runs[r];
+        uint8_t *const runAt = p;
+        p += 8;
+        uint32_t numSegs = 0;
+
+        for (size_t i = run->start; i < run->start + run->count; i += 1) {
+            Lines_Seg seg = lines->segs[i];
+
+            if (!Lines_Clip(&seg, frame->screenWidth, frame->screenHeight)) {
+                continue;
+            }
+
+            p = Put16(p, ToSubpixels(seg.x1));
+            p = Put16(p, ToSubpixels(seg.y1));
+            p = Put16(p, ToSubpixels(seg.x2));
+            p = Put16(p, ToSubpixels(seg.y2));
+            numSegs += 1;
+        }
+
+        if (numSegs == 0) {
+            p = runAt;
+            continue;
+        }
+
+        runAt[0] = run->color.r;
+        runAt[1] = run->color.g;
+        runAt[2] = run->color.b;
+        runAt[3] = run->color.a;
+        Put32(runAt + 4, numSegs);
+        numRuns += 1;
+    }
+
+    Put32(numRunsAt, numRuns);
+
+    const size_t size = (size_t)(p - capture->buf);
+    Put32(capture->buf, (uint32_t)(size - 4));
+
+    if (fwrite(capture->buf, size, 1, capture->file) != 1) {
+        fprintf(stderr, "%s: Failed to write frame %" PRIu32 "\n", __func__, frame->frameNum);
+        return false;
+    }
+
+    capture->numFrames += 1;
+    capture->numBytes += size;
+    return true;
+}
+
+bool Capture_ReadHeader(FILE *const file) {
+    uint8_t header[8];
+
+    if (fread(header, sizeof(header), 1, file) != 1 || memcmp(header, CAPTURE_MAGIC, 4) != 0) {
+        fprintf(stderr, "%s: Not a capture file\n", __func__);
+        return false;
+    }
+
+    if (Get32(header + 4) != CAPTURE_VERSION) {
+        fprintf(stderr, "%s: Unsupported version %" PRIu32 "\n", __func__, Get32(header + 4));
+        return false;
+    }
+
+    return true;
+}
+
+int Capture_ReadFrame(FILE *const file, Capture_Frame *const frame, Lines *const lines) {
+    uint8_t sizeBytes[4];
+
+    if (fread(sizeBytes, sizeof(sizeBytes), 1, file) != 1) {
+        return feof(file) ? 0 : -1;
+    }
+
+    const size_t size = Get32(sizeBytes);
+
+    if (size < CAPTURE_FRAME_HEADER - 4) {
+        fprintf(stderr, "%s: Bad frame size %zu\n", __func__, size);
+        return -1;
+    }
+
+    uint8_t *const buf = Mem_AllocTagged(size, MEM_TAG_CAPTURE);
+
+    if (fread(buf, size, 1, file) != 1) {
+        fprintf(stderr, "%s: Truncated frame\n", __func__);
+        Mem_Free(buf);
+        return -1;
+    }
+
+    const uint8_t *p = buf;
+    const uint8_t *const end = buf + size;
+
+    frame->frameNum = Get32(p);
+    frame->screenWidth = Get16(p + 4);
+    frame->screenHeight = Get16(p + 6);
+    frame->cameraPos = (V3d) {GetF64(p + 8), GetF64(p + 16), GetF64(p + 24)};
+    frame->horizLookRads = GetF64(p + 32);
+    frame->vertLookRads = GetF64(p + 40);
+    frame->projPlaneFactor = GetF64(p + 48);
+
+    const uint32_t numRuns = Get32(p + 56);
+    p += CAPTURE_FRAME_HEADER - 4;
+
+    Lines_Clear(lines);
+
+    for (uint32_t r = 0; r < numRuns; r += 1) {
+        if (end - p < 8) {
+            break;
+        }
+
+        Lines_SetColor(lines, (Rgba) {p[0], p[1], p[2], p[3]});
+        const uint32_t numSegs = Get32(p + 4);
+        p += 8;
+
+        if ((size_t)(end - p) / 8 < numSegs) {
+            break;
+        }
+
+        for (uint32_t i = 0; i < numSegs; i += 1) {
+            Lines_Push(lines, (Lines_Seg) {
+                (float)Get16(p) / CAPTURE_SUBPIXELS,
+                (float)Get16(p + 2) / CAPTURE_SUBPIXELS,
+                (float)Get16(p + 4) / CAPTURE_SUBPIXELS,
+                (float)Get16(p + 6) / CAPTURE_SUBPIXELS
+            });
+            p += 8;
+        }
+    }
+
+    const bool complete = (p == end);
+    Mem_Free(buf);
+
+    if (!complete) {
+        fprintf(stderr, "%s: Corrupt frame %" PRIu32 "\n", __func__, frame->frameNum);
+        return -1;
+    }
+
+    return 1;
+}
@@ -0,0 +1,90 @@
+#ifndef CAPTURE_H
+#define CAPTURE_H
+
+// Recording of frames as the line segments that were drawn instead of pixels.
+//
+// A capture file is a header followed by one record per frame. All values are
+// little-endian.
+//
+//  Header:
+//   char[4] magic "OGLC"
+//   u32     version (CAPTURE_VERSION)
+//
+//  Frame:
+//   u32     size of the rest of the record in bytes
+//   u32     frame number
+//   u16     screen width
+//   u16     screen height
+//   f64[6]  camera x, y, z, horizLookRads, vertLookRads, projPlaneFactor
+//   u32     number of runs
+//   Per run:
+//    u8[4]  r, g, b, a
+//    u32    number of segments
+//    u16[4] x1, y1, x2, y2 per segment
+//
+// Segments are clipped to the screen and stored in units of
+// 1 / CAPTURE_SUBPIXELS of a pixel, so screens may be up to 16383 pixels wide.
+// Runs left without segments after clipping are not stored.
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "Lines.h"
+#include "V3d.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define CAPTURE_VERSION 1
+#define CAPTURE_SUBPIXELS 4
+
+// Everything about a frame besides its segments.
+typedef struct Capture_Frame {
+    uint32_t frameNum;
+    int screenWidth;
+    int screenHeight;
+    V3d cameraPos;
+    double horizLookRads;
+    double vertLookRads;
+    double projPlaneFactor;
+} Capture_Frame;
+
+typedef struct Capture {
+    FILE *file;
+
+    // One encoded frame. Kept to avoid reallocating every frame.
+    uint8_t *buf;
+    size_t bufCap;
+
+    uint32_t numFrames;
+    uint64_t numBytes; // Written so far, including the header.
+} Capture;
+
+// Create the file at `path` and write the header.
+// If error, print to `stderr` and return false.
+bool Capture_Open(Capture *const capture, const char *const path);
+
+// Close the file and free the internals of `capture`. Print the size written to `stdout`.
+void Capture_Close(Capture *const capture);
+
+// Append `frame` drawn as `lines`.
+// If error, print to `stderr` and return false.
+bool Capture_WriteFrame(Capture *const capture,
+    const Capture_Frame *const frame, const Lines *const lines);
+
+// Read and check the header of a capture file.
+// If error, print to `stderr` and return false.
+bool Capture_ReadHeader(FILE *const file);
+
+// Read the next frame from `file` into `frame` and `lines`. `lines` is cleared first.
+// Return 1 if a frame was read, 0 at the end of the file and -1 if error,
+// after printing to `stderr`.
+int Capture_ReadFrame(FILE *const file, Capture_Frame *const frame, Lines *const lines);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
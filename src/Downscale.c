@@ -0,0 +1,122 @@
+#include "Downscale.h"
+
+#include <string.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+// Average of the `factor` x `factor` block with top-left pixel `block`, one byte at a time.
+static uint32_t AverageBlock(const uint32_t *const block, const size_t pitch, const int factor) {
+    const uint32_t count = (uint32_t)(factor * factor);
+    uint32_t sums[4] = {0, 0, 0, 0};
+
+    for (int y = 0; y < factor; y += 1) {
+        for (int x = 0; x < factor; x += 1) {
+            const uint32_t pixel = block[(size_t)y * pitch + (size_t)x];
+
+            for (int c = 0; c < 4; c += 1) {
+                sums[c] += (pixel >> (8 * c)) & 0xFF;
+            }
+        }
+    }
+
+    uint32_t result = 0;
+
+    for (int c = 0; c < 4; c += 1) {
+        result |= ((sums[c] + count / 2) / count) << (8 * c);
+    }
+
+    return result;
+}
+
+#if defined(__SSE2__)
+
+// 2x2 blocks. Each step reads 4 pixels from each of 2 rows and writes 2 pixels.
+// Returns the number of output pixels written; the caller does the rest.
+static int DownscaleRow2(const uint32_t *const row0, const uint32_t *const row1,
+    const int dstWidth, uint32_t *const dst)
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i round = _mm_set1_epi16(2);
+    int x = 0;
+
+    for (; x + 2 <= dstWidth; x += 2) {
+        const __m128i a = _mm_loadu_si128((const __m128i *)(row0 + 2 * x));
+        const __m128i b = _mm_loadu_si128((const __m128i *)(row1 + 2 * x));
+
+        // Bytes widened to 16 bits. `lo` holds pixels 0 and 1, `hi` pixels 2 and 3.
+        const __m128i lo = _mm_add_epi16(_mm_unpacklo_epi8(a, zero), _mm_unpacklo_epi8(b, zero));
+        const __m128i hi = _mm_add_epi16(_mm_unpackhi_epi8(a, zero), _mm_unpackhi_epi8(b, zero));
+
+        // Add neighbors: pixels 0 + 1 in the low half, 2 + 3 in the high half.
+        __m128i sum = _mm_add_epi16(_mm_unpacklo_epi64(lo, hi), _mm_unpackhi_epi64(lo, hi));
+        sum = _mm_srli_epi16(_mm_add_epi16(sum, round), 2);
+
+        _mm_storel_epi64((__m128i *)(dst + x), _mm_packus_epi16(sum, sum));
+    }
+
+    return x;
+}
+
+// 4x4 blocks. Each step reads 4 pixels from each of 4 rows and writes 1 pixel.
+static int DownscaleRow4(const uint32_t *const row, const size_t pitch,
+    const int dstWidth, uint32_t *const dst)
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i round = _mm_set1_epi16(8);
+
+    for (int x = 0; x < dstWidth; x += 1) {
+        __m128i lo = zero;
+        __m128i hi = zero;
+
+        // At most 16 * 255 per 16-bit lane, so no overflow.
+        for (int y = 0; y < 4; y += 1) {
+            const __m128i a = _mm_loadu_si128((const __m128i *)(row + (size_t)y * pitch + 4 * (size_t)x));
+            lo = _mm_add_epi16(lo, _mm_unpacklo_epi8(a, zero));
+            hi = _mm_add_epi16(hi, _mm_unpackhi_epi8(a, zero));
+        }
+
+        __m128i sum = _mm_add_epi16(lo, hi);
+        sum = _mm_add_epi16(sum, _mm_srli_si128(sum, 8));
+        sum = _mm_srli_epi16(_mm_add_epi16(sum, round), 4);
+
+        dst[x] = (uint32_t)_mm_cvtsi128_si32(_mm_packus_epi16(sum, sum));
+    }
+
+    return dstWidth;
+}
+
+#endif
+
+void Downscale_Box(const uint32_t *const src, const size_t srcPitch,
+    const int srcWidth, const int srcHeight, const int factor,
+    uint32_t *const dst, const size_t dstPitch)
+{
+    const int dstWidth = srcWidth / factor;
+    const int dstHeight = srcHeight / factor;
+
+    for (int y = 0; y < dstHeight; y += 1) {
+        const uint32_t *const row = src + (size_t)(y * factor) * srcPitch;
+        uint32_t *const dstRow = dst + (size_t)y * dstPitch;
+        int x = 0;
+
+        if (factor == 1) {
+            memcpy(dstRow, row, (size_t)dstWidth * sizeof(uint32_t));
+            continue;
+        }
+
+#if defined(__SSE2__)
+        if (factor == 2) {
+            x = DownscaleRow2(row, row + srcPitch, dstWidth, dstRow);
+        }
+        else if (factor == 4) {
+            x = DownscaleRow4(row, srcPitch, dstWidth, dstRow);
+        }
+#endif
+
+        for (; x < dstWidth; x += 1) {
+            dstRow[x] = AverageBlock(row + (size_t)(x * factor), srcPitch, factor);
+        }
+    }
+}
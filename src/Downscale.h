@@ -0,0 +1,27 @@
+#ifndef DOWNSCALE_H
+#define DOWNSCALE_H
+
+// Shrinking 32-bit images by averaging square blocks of pixels (box filter).
+// Each of the 4 bytes of a pixel is averaged on its own, so any channel order works.
+// Uses SSE2 where available.
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Set each pixel of `dst` to the rounded average of the `factor` x `factor`
+// block of `src` it covers. `factor` is 1, 2 or 4.
+// `dst` is `srcWidth / factor` by `srcHeight / factor`. Leftover columns
+// and rows of `src` are ignored. Pitches are in pixels.
+void Downscale_Box(const uint32_t *const src, const size_t srcPitch,
+    const int srcWidth, const int srcHeight, const int factor,
+    uint32_t *const dst, const size_t dstPitch);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,393 @@
+#if defined(__linux__)
+// For `syscall`.
+#define _GNU_SOURCE
+#endif
+
+#include "Export.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include "Clock.h"
+
+#if defined(__linux__)
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <linux/futex.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+#endif
+
+_Static_assert(sizeof(Export_Slot) == 64, "Slots are one cache line each");
+_Static_assert(offsetof(Export_Header, slots) == 64, "Slots start on a cache line");
+_Static_assert(ATOMIC_LLONG_LOCK_FREE == 2, "Shared atomics must be lock-free");
+
+#if defined(__linux__)
+
+// Round `n` up to a multiple of the page size.
+static size_t PageAlign(const size_t n) {
+    const size_t pageSize = (size_t)sysconf(_SC_PAGESIZE);
+    return (n + pageSize - 1) / pageSize * pageSize;
+}
+
+// Not `FUTEX_PRIVATE_FLAG`: the word is shared between processes.
+static long Futex(_Atomic uint32_t *const word, const int op, const uint32_t value,
+    const struct timespec *const timeout)
+{
+    return syscall(SYS_futex, (uint32_t *)word, op, value, timeout, NULL, 0);
+}
+
+bool Export_Open(Export *const exp, const char *const name, const int numSlots,
+    const int maxWidth, const int maxHeight)
+{
+    *exp = (Export) { .fd = -1, .writingSlot = -1 };
+
+    if (numSlots < 2 || numSlots > EXPORT_MAX_SLOTS || maxWidth <= 0 || maxHeight <= 0) {
+        fprintf(stderr, "%s: Bad ring size: %d slots of %dx%d\n",
+            __func__, numSlots, maxWidth, maxHeight);
+        return false;
+    }
+
+    snprintf(exp->name, sizeof(exp->name), "%s", name);
+
+    const size_t headerSize = PageAlign(sizeof(Export_Header));
+    const size_t slotBytes = PageAlign((size_t)maxWidth * (size_t)maxHeight * sizeof(uint32_t));
+
+    exp->size = headerSize + (size_t)numSlots * slotBytes;
+
+    // Never take the name from another running instance. A crashed run can
+    // leave one behind, which has to be removed by hand.
+    exp->fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0600);
+
+    if (exp->fd < 0) {
+        const int error = errno;
+        fprintf(stderr, "%s: shm_open %s failed: %s\n", __func__, name, strerror(error));
+
+        if (error == EEXIST) {
+            fprintf(stderr, "%s: Another instance may be exporting to %s. If not, "
+                "a crashed run left it behind: remove it (/dev/shm%s) and retry.\n",
+                __func__, name, name);
+        }
+
+        return false;
+    }
+
+    // Pages are only backed once written, so slots for big frames cost nothing until used.
+    if (ftruncate(exp->fd, (off_t)exp->size) != 0) {
+        fprintf(stderr, "%s: ftruncate failed: %s\n", __func__, strerror(errno));
+        Export_Close(exp);
+        return false;
+    }
+
+    void *const map = mmap(NULL, exp->size, PROT_READ | PROT_WRITE, MAP_SHARED, exp->fd, 0);
+
+    if (map == MAP_FAILED) {
+        fprintf(stderr, "%s: mmap failed: %s\n", __func__, strerror(errno));
+        Export_Close(exp);
+        return false;
+    }
+
+    exp->header = map;
+    exp->data = (uint8_t *)map + headerSize;
+    exp->frame = 1;
+
+    Export_Header *const header = exp->header;
+    header->version = EXPORT_VERSION;
+    header->numSlots = (uint32_t)numSlots;
+    header->maxWidth = (uint32_t)maxWidth;
+    header->maxHeight = (uint32_t)maxHeight;
+    header->slotBytes = slotBytes;
+    header->dataOffset = headerSize;
+
+    // The object starts zeroed, so the atomics start at 0.
+    // The magic goes last so readers never see a half-written header.
+    atomic_thread_fence(memory_order_release);
+    header->magic = EXPORT_MAGIC;
+
+    return true;
+}
+
+void Export_Close(Export *const exp) {
+    if (exp->header != NULL) {
+        munmap(exp->header, exp->size);
+    }
+
+    if (exp->fd >= 0) {
+        close(exp->fd);
+        shm_unlink(exp->name);
+    }
+
+    if (exp->numTooBig > 0) {
+        fprintf(stdout, "Export: %llu frames were too big for a slot.\n",
+            (unsigned long long)exp->numTooBig);
+    }
+
+    *exp = (Export) { .fd = -1, .writingSlot = -1 };
+}
+
+uint32_t *Export_BeginFrame(Export *const exp, const int width, const int height) {
+    Export_Header *const header = exp->header;
+
+    if ((uint32_t)width > header->maxWidth || (uint32_t)height > header->maxHeight) {
+        exp->numTooBig += 1;
+        return NULL;
+    }
+
+    exp->writingSlot = (int)(exp->frame % header->numSlots);
+    Export_Slot *const slot = &header->slots[exp->writingSlot];
+
+    // Odd: readers of the frame that was here see it change.
+    atomic_store_explicit(&slot->seq, 2 * exp->frame + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+
+    slot->width = (uint32_t)width;
+    slot->height = (uint32_t)height;
+
+    return (uint32_t *)(exp->data + (size_t)exp->writingSlot * header->slotBytes);
+}
+
+void Export_EndFrame(Export *const exp, const uint64_t frameNs) {
+    Export_Header *const header = exp->header;
+    Export_Slot *const slot = &header->slots[exp->writingSlot];
+
+    slot->frameNs = frameNs;
+    slot->publishNs = Clock_GetTimeNs();
+
+    atomic_store_explicit(&slot->seq, 2 * exp->frame + 2, memory_order_release);
+    atomic_store_explicit(&header->latestFrame, exp->frame, memory_order_release);
+    atomic_store_explicit(&header->latest, (uint32_t)exp->frame, memory_order_seq_cst);
+
+    // Pairs with the reader adding itself to `numWaiters` before checking `latest`.
+    if (atomic_load_explicit(&header->numWaiters, memory_order_seq_cst) > 0) {
+        Futex(&header->latest, FUTEX_WAKE, INT_MAX, NULL);
+    }
+
+    exp->frame += 1;
+    exp->writingSlot = -1;
+}
+
+bool Export_Attach(Export_Reader *const reader, const char *const name) {
+    *reader = (Export_Reader) { .fd = -1 };
+
+    reader->fd = shm_open(name, O_RDWR, 0);
+
+    if (reader->fd < 0) {
+        fprintf(stderr, "%s: shm_open %s failed: %s\n", __func__, name, strerror(errno));
+        return false;
+    }
+
+    struct stat st;
+
+    if (fstat(reader->fd, &st) != 0 || (size_t)st.st_size < sizeof(Export_Header)) {
+        fprintf(stderr, "%s: %s is not a frame export\n", __func__, name);
+        Export_Detach(reader);
+        return false;
+    }
+
+    // The header is written to register as a waiter. The pixels are only read.
+    reader->headerSize = PageAlign(sizeof(Export_Header));
+    void *const map = mmap(NULL, reader->headerSize, PROT_READ | PROT_WRITE, MAP_SHARED, reader->fd, 0);
+
+    if (map == MAP_FAILED) {
+        fprintf(stderr, "%s: mmap failed: %s\n", __func__, strerror(errno));
+        Export_Detach(reader);
+        return false;
+    }
+
+    reader->header = map;
+
+    const Export_Header *const header = reader->header;
+
+    if (header->magic != EXPORT_MAGIC || header->version != EXPORT_VERSION) {
+        fprintf(stderr, "%s: %s is not a version %d frame export\n", __func__, name, EXPORT_VERSION);
+        Export_Detach(reader);
+        return false;
+    }
+
+    atomic_thread_fence(memory_order_acquire);
+
+    // Everything below is used to index the slots and the pixels, so a corrupt
+    // or mismatched object must not be trusted.
+    const uint64_t fileSize = (uint64_t)st.st_size;
+    const uint64_t frameBytes = (uint64_t)header->maxWidth * header->maxHeight * sizeof(uint32_t);
+
+    if (header->numSlots < 2 || header->numSlots > EXPORT_MAX_SLOTS
+        || header->maxWidth == 0 || header->maxHeight == 0
+        || header->slotBytes < frameBytes
+        || header->dataOffset != reader->headerSize
+        || fileSize < header->dataOffset
+        || header->slotBytes > (fileSize - header->dataOffset) / header->numSlots)
+    {
+        fprintf(stderr, "%s: %s has a bad layout: %u slots of %llu bytes for %ux%u frames, "
+            "%llu bytes in all\n", __func__, name,
+            (unsigned)header->numSlots, (unsigned long long)header->slotBytes,
+            (unsigned)header->maxWidth, (unsigned)header->maxHeight,
+            (unsigned long long)fileSize);
+        Export_Detach(reader);
+        return false;
+    }
+
+    reader->dataSize = (size_t)st.st_size - reader->headerSize;
+    const void *const data = mmap(NULL, reader->dataSize, PROT_READ, MAP_SHARED,
+        reader->fd, (off_t)reader->headerSize);
+
+    if (data == MAP_FAILED) {
+        fprintf(stderr, "%s: mmap failed: %s\n", __func__, strerror(errno));
+        Export_Detach(reader);
+        return false;
+    }
+
+    reader->data = data;
+
+    return true;
+}
+
+void Export_Detach(Export_Reader *const reader) {
+    if (reader->data != NULL) {
+        munmap((void *)reader->data, reader->dataSize);
+    }
+
+    if (reader->header != NULL) {
+        munmap(reader->header, reader->headerSize);
+    }
+
+    if (reader->fd >= 0) {
+        close(reader->fd);
+    }
+
+    *reader = (Export_Reader) { .fd = -1 };
+}
+
+uint64_t Export_Wait(Export_Reader *const reader, const uint64_t after, const uint64_t timeoutNs) {
+    Export_Header *const header = reader->header;
+    const uint64_t startNs = Clock_GetTimeNs();
+
+    atomic_fetch_add_explicit(&header->numWaiters, 1, memory_order_seq_cst);
+
+    uint64_t latest = atomic_load_explicit(&header->latestFrame, memory_order_acquire);
+
+    while (latest <= after) {
+        const uint64_t waitedNs = Clock_GetTimeNs() - startNs;
+
+        if (waitedNs >= timeoutNs) {
+            break;
+        }
+
+        const uint64_t leftNs = timeoutNs - waitedNs;
+        const struct timespec timeout = {
+            .tv_sec = (time_t)(leftNs / 1000000000u),
+            .tv_nsec = (long)(leftNs % 1000000000u)
+        };
+
+        // Sleeps only if `latest` still holds this value, so a frame published
+        // between the check and the call is not missed.
+        Futex(&header->latest, FUTEX_WAIT, (uint32_t)latest, &timeout);
+
+        latest = atomic_load_explicit(&header->latestFrame, memory_order_acquire);
+    }
+
+    atomic_fetch_sub_explicit(&header->numWaiters, 1, memory_order_relaxed);
+
+    return latest;
+}
+
+bool Export_GetFrame(const Export_Reader *const reader, const uint64_t frame, Export_Frame *const out) {
+    const Export_Header *const header = reader->header;
+    const int slotIndex = (int)(frame % header->numSlots);
+    const Export_Slot *const slot = &header->slots[slotIndex];
+
+    const uint64_t seq = atomic_load_explicit(&slot->seq, memory_order_acquire);
+
+    if (seq != 2 * frame + 2) {
+        return false;
+    }
+
+    // Checked like the header so a bad slot cannot send readers past its pixels.
+    if (slot->width > header->maxWidth || slot->height > header->maxHeight) {
+        return false;
+    }
+
+    *out = (Export_Frame) {
+        .frame = frame,
+        .frameNs = slot->frameNs,
+        .publishNs = slot->publishNs,
+        .width = (int)slot->width,
+        .height = (int)slot->height,
+        .pixels = (const uint32_t *)(reader->data + (size_t)slotIndex * header->slotBytes),
+        .seq = seq,
+        .slot = slotIndex
+    };
+
+    // The fields must be from before any rewrite of the slot.
+    return Export_StillValid(reader, out);
+}
+
+bool Export_StillValid(const Export_Reader *const reader, const Export_Frame *const frame) {
+    atomic_thread_fence(memory_order_acquire);
+    return atomic_load_explicit(&reader->header->slots[frame->slot].seq, memory_order_relaxed) == frame->seq;
+}
+
+#else
+
+bool Export_Open(Export *const exp, const char *const name, const int numSlots,
+    const int maxWidth, const int maxHeight)
+{
+    (void)numSlots;
+    (void)maxWidth;
+    (void)maxHeight;
+
+    *exp = (Export) { .fd = -1, .writingSlot = -1 };
+    fprintf(stderr, "%s: Frame export to %s needs Linux\n", __func__, name);
+    return false;
+}
+
+void Export_Close(Export *const exp) {
+    *exp = (Export) { .fd = -1, .writingSlot = -1 };
+}
+
+uint32_t *Export_BeginFrame(Export *const exp, const int width, const int height) {
+    (void)exp;
+    (void)width;
+    (void)height;
+    return NULL;
+}
+
+void Export_EndFrame(Export *const exp, const uint64_t frameNs) {
+    (void)exp;
+    (void)frameNs;
+}
+
+bool Export_Attach(Export_Reader *const reader, const char *const name) {
+    *reader = (Export_Reader) { .fd = -1 };
+    fprintf(stderr, "%s: Frame export from %s needs Linux\n", __func__, name);
+    return false;
+}
+
+void Export_Detach(Export_Reader *const reader) {
+    *reader = (Export_Reader) { .fd = -1 };
+}
+
+uint64_t Export_Wait(Export_Reader *const reader, const uint64_t after, const uint64_t timeoutNs) {
+    (void)reader;
+    (void)timeoutNs;
+    return after;
+}
+
+bool Export_GetFrame(const Export_Reader *const reader, const uint64_t frame, Export_Frame *const out) {
+    (void)reader;
+    (void)frame;
+    (void)out;
+    return false;
+}
+
+bool Export_StillValid(const Export_Reader *const reader, const Export_Frame *const frame) {
+    (void)reader;
+    (void)frame;
+    return false;
+}
+
+#endif
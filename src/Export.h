@@ -0,0 +1,140 @@
+#ifndef EXPORT_H
+#define EXPORT_H
+
+// Frames shared with other processes on the same host through shared memory.
+//
+// The app creates a POSIX shared memory object (`shm_open`) holding a header
+// and a ring of frame slots, and reads each frame back straight into the next
+// slot. Readers map the object and use the pixels where they are, so a frame
+// is written once and never copied for readers, however many there are.
+//
+// Each slot is a sequence lock. Its `seq` is 2n + 1 while frame n is being
+// written and 2n + 2 once it is complete. A reader checks `seq` before and
+// after using a slot. If it changed, the writer has lapped the reader and the
+// frame must be thrown away. The header's `latest` is the low 32 bits of the
+// newest complete frame number and doubles as a futex: readers sleep on it
+// and the writer wakes them, only making the call when someone is waiting.
+//
+// Pixels are 0xAARRGGBB, `width` per row, in host byte order.
+// Times are `Clock_GetTimeNs` values, which every process on the host shares.
+// Linux only. Elsewhere opening fails.
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define EXPORT_MAGIC 0x4653474Fu // "OGSF" in memory on little-endian machines.
+#define EXPORT_VERSION 1
+
+// Most slots in the ring. More slots give slow readers longer before frames are overwritten.
+#define EXPORT_MAX_SLOTS 16
+
+// Shared between processes, so the layout is fixed and each slot has its own cache line.
+typedef struct Export_Slot {
+    _Atomic uint64_t seq; // 2n + 1 while frame n is written, 2n + 2 when complete. 0 if never used.
+    uint64_t frameNs;     // When the frame started.
+    uint64_t publishNs;   // When the frame was complete.
+    uint32_t width;
+    uint32_t height;
+    uint8_t pad[32];
+} Export_Slot;
+
+typedef struct Export_Header {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t numSlots;
+    uint32_t maxWidth;  // Largest frame a slot holds.
+    uint32_t maxHeight;
+    uint32_t pad0;
+    uint64_t slotBytes;  // Bytes from one slot's pixels to the next.
+    uint64_t dataOffset; // Bytes from the start of the object to slot 0's pixels. Page aligned.
+
+    _Atomic uint64_t latestFrame; // Newest complete frame number. 0 if none yet.
+    _Atomic uint32_t latest;      // Low 32 bits of `latestFrame`. Futex word.
+    _Atomic uint32_t numWaiters;  // Readers asleep on `latest`.
+    uint8_t pad1[8];
+
+    Export_Slot slots[EXPORT_MAX_SLOTS];
+} Export_Header;
+
+// Writer side.
+typedef struct Export {
+    char name[256];
+    int fd;
+    size_t size;
+    Export_Header *header;
+    uint8_t *data;
+    uint64_t frame;    // Number of the frame being written. Starts at 1.
+    int writingSlot;   // -1 if not writing.
+    uint64_t numTooBig; // Frames skipped for being bigger than a slot.
+} Export;
+
+// Reader side.
+typedef struct Export_Reader {
+    int fd;
+    size_t headerSize;
+    size_t dataSize;
+    Export_Header *header;   // Mapped read-write to register as a waiter.
+    const uint8_t *data;     // Mapped read-only.
+} Export_Reader;
+
+// A complete frame in a slot. Valid while `Export_StillValid` says so.
+typedef struct Export_Frame {
+    uint64_t frame;
+    uint64_t frameNs;
+    uint64_t publishNs;
+    int width;
+    int height;
+    const uint32_t *pixels;
+    uint64_t seq; // For `Export_StillValid`.
+    int slot;
+} Export_Frame;
+
+// Create shared memory object `name`, e.g. "/ortho-grid", with `numSlots` slots
+// of up to `maxWidth` x `maxHeight` pixels. Fails if `name` exists, whether
+// another instance is using it or a crash left it behind.
+// If error, print to `stderr` and return false.
+bool Export_Open(Export *const exp, const char *const name, const int numSlots,
+    const int maxWidth, const int maxHeight);
+
+// Remove the shared memory object. Readers keep their mappings until they detach.
+void Export_Close(Export *const exp);
+
+// Return the pixels of the next slot for a `width` x `height` frame, `width` per row.
+// Return NULL, skipping the frame, if it does not fit in a slot.
+// Then call `Export_EndFrame`, or just `Export_BeginFrame` again for the next
+// frame if the pixels could not be filled. Readers never see an unfinished slot.
+uint32_t *Export_BeginFrame(Export *const exp, const int width, const int height);
+
+// Publish the frame from `Export_BeginFrame`, which started at `frameNs`, and wake readers.
+void Export_EndFrame(Export *const exp, const uint64_t frameNs);
+
+// Map shared memory object `name` created by `Export_Open`.
+// Its header is checked against its size, so other objects are refused.
+// If error, print to `stderr` and return false.
+bool Export_Attach(Export_Reader *const reader, const char *const name);
+
+// Unmap everything.
+void Export_Detach(Export_Reader *const reader);
+
+// Wait until a frame newer than `after` is complete or `timeoutNs` passes.
+// Return the newest complete frame number, which is `after` on timeout.
+uint64_t Export_Wait(Export_Reader *const reader, const uint64_t after, const uint64_t timeoutNs);
+
+// Get complete frame number `frame`. Return false if its slot has moved on to a later frame.
+bool Export_GetFrame(const Export_Reader *const reader, const uint64_t frame, Export_Frame *const out);
+
+// Return whether the pixels of `frame` have not started being overwritten.
+// Check after using them.
+bool Export_StillValid(const Export_Reader *const reader, const Export_Frame *const frame);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,106 @@
+#include "Governor.h"
+
+static const char *const levelNames[GOVERNOR_NUM_LEVELS] = {
+    "full", "coarse grid", "no overlays", "small capture"
+};
+
+void Governor_Init(Governor *const governor, const uint64_t budgetNs, const bool printChanges) {
+    *governor = (Governor) {
+        .budgetNs = budgetNs,
+        .estimateNs = 0.0,
+        .level = GOVERNOR_FULL,
+        .restoreFrames = GOVERNOR_RESTORE_FRAMES,
+        .printChanges = printChanges
+    };
+}
+
+static void SetLevel(Governor *const governor, const Governor_Level level) {
+    if (governor->printChanges) {
+        fprintf(stdout, "Governor: %.2f ms estimate for %.2f ms budget. Quality %s -> %s.\n",
+            governor->estimateNs / 1e6, (double)governor->budgetNs / 1e6,
+            levelNames[governor->level], levelNames[level]);
+    }
+
+    governor->lastChangeWasRestore = level < governor->level;
+    governor->level = level;
+    governor->framesSinceChange = 0;
+    governor->framesUnderLowWater = 0;
+}
+
+bool Governor_Update(Governor *const governor, const uint64_t frameNs) {
+    governor->framesAtLevel[governor->level] += 1;
+
+    // The first frame starts the estimate instead of being averaged with 0.
+    if (governor->estimateNs == 0.0) {
+        governor->estimateNs = (double)frameNs;
+    }
+    else {
+        governor->estimateNs += GOVERNOR_EMA_WEIGHT * ((double)frameNs - governor->estimateNs);
+    }
+
+    governor->framesSinceChange += 1;
+
+    if (governor->framesSinceChange < GOVERNOR_SETTLE_FRAMES) {
+        return false;
+    }
+
+    const double budget = (double)governor->budgetNs;
+
+    if (governor->estimateNs > GOVERNOR_HIGH_WATER * budget) {
+        if (governor->level + 1 == GOVERNOR_NUM_LEVELS) {
+            return false;
+        }
+
+        // Lost a level soon after getting it back: wait longer next time.
+        if (governor->lastChangeWasRestore && governor->framesSinceChange < governor->restoreFrames
+            && governor->restoreFrames < GOVERNOR_MAX_RESTORE_FRAMES)
+        {
+            governor->restoreFrames *= 2;
+        }
+
+        SetLevel(governor, governor->level + 1);
+        governor->numLowered += 1;
+        return true;
+    }
+
+    if (governor->estimateNs < GOVERNOR_LOW_WATER * budget) {
+        governor->framesUnderLowWater += 1;
+    }
+    else {
+        governor->framesUnderLowWater = 0;
+    }
+
+    if (governor->level > GOVERNOR_FULL && governor->framesUnderLowWater >= governor->restoreFrames) {
+        SetLevel(governor, governor->level - 1);
+        governor->numRaised += 1;
+        return true;
+    }
+
+    return false;
+}
+
+const char *Governor_LevelName(const Governor_Level level) {
+    return levelNames[level];
+}
+
+void Governor_PrintSummary(const Governor *const governor, FILE *const file) {
+    uint64_t numFrames = 0;
+
+    for (int i = 0; i < GOVERNOR_NUM_LEVELS; i += 1) {
+        numFrames += governor->framesAtLevel[i];
+    }
+
+    if (numFrames == 0) {
+        return;
+    }
+
+    fprintf(file, "Governor over %llu frames (%.2f ms budget): lowered %llu times, raised %llu times.\n",
+        (unsigned long long)numFrames, (double)governor->budgetNs / 1e6,
+        (unsigned long long)governor->numLowered, (unsigned long long)governor->numRaised);
+
+    for (int i = 0; i < GOVERNOR_NUM_LEVELS; i += 1) {
+        fprintf(file, "  %-14s %10llu frames (%5.1f%%)\n", levelNames[i],
+            (unsigned long long)governor->framesAtLevel[i],
+            100.0 * (double)governor->framesAtLevel[i] / (double)numFrames);
+    }
+}
@@ -0,0 +1,79 @@
+#ifndef GOVERNOR_H
+#define GOVERNOR_H
+
+// Frame-budget governor. Keeps a moving estimate of frame time and lowers
+// the quality level while it is over the budget, one level at a time.
+// Quality comes back one level at a time once the estimate has been well
+// under the budget for a while. Separate thresholds and the wait keep it
+// from flapping between levels. A level that is restored and then quickly
+// lost again doubles the wait before the next restore.
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Each level sheds the work of the levels above it and some more.
+typedef enum Governor_Level {
+    GOVERNOR_FULL,          // Everything.
+    GOVERNOR_COARSE_GRID,   // Fewer lines per grid instance.
+    GOVERNOR_NO_OVERLAYS,   // Also no labels or hover outline.
+    GOVERNOR_SMALL_CAPTURE, // Also recorded frames shrunk further.
+    GOVERNOR_NUM_LEVELS
+} Governor_Level;
+
+// Weight of the newest frame in the moving estimate.
+#define GOVERNOR_EMA_WEIGHT 0.125
+
+// Lower quality when the estimate is over this share of the budget.
+#define GOVERNOR_HIGH_WATER 0.9
+
+// Raise quality when the estimate stays under this share of the budget.
+#define GOVERNOR_LOW_WATER 0.6
+
+// Frames after a change before the estimate is trusted again.
+#define GOVERNOR_SETTLE_FRAMES 15
+
+// Frames under the low water mark needed to raise quality. Doubles on
+// flapping, up to the max.
+#define GOVERNOR_RESTORE_FRAMES 120
+#define GOVERNOR_MAX_RESTORE_FRAMES 1920
+
+typedef struct Governor {
+    uint64_t budgetNs;
+    double estimateNs; // Moving average of frame time.
+    Governor_Level level;
+
+    uint64_t framesSinceChange;
+    uint64_t framesUnderLowWater;
+    uint64_t restoreFrames; // Current wait before raising quality.
+    bool lastChangeWasRestore;
+
+    // For instrumentation.
+    uint64_t framesAtLevel[GOVERNOR_NUM_LEVELS];
+    uint64_t numLowered;
+    uint64_t numRaised;
+    bool printChanges; // Whether to print a line to `stdout` for every change.
+} Governor;
+
+// Initialize `governor` at full quality for frames of `budgetNs`.
+void Governor_Init(Governor *const governor, const uint64_t budgetNs, const bool printChanges);
+
+// Add the time of the frame that just ended and maybe change the level.
+// Return true if the level changed.
+bool Governor_Update(Governor *const governor, const uint64_t frameNs);
+
+// Return a short name of `level`.
+const char *Governor_LevelName(const Governor_Level level);
+
+// Print the share of frames at each level and the number of changes.
+void Governor_PrintSummary(const Governor *const governor, FILE *const file);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,651 @@
+#include "Grid.h"
+
+#include <math.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "Mem.h"
+
+void Grid_MakeTiles(const Grid *const grid, const int tilesPerSide,
+    const Rgba color, const Rgba altColor, Grid_Instance *const instances)
+{
+    const double tileWidth = grid->cellWidth * grid->numCellsX;
+    const double tileHeight = grid->cellWidth * grid->numCellsY;
+    const int first = -(tilesPerSide / 2);
+
+    size_t i = 0;
+
+    for (int ty = first; ty < first + tilesPerSide; ty += 1) {
+        for (int tx = first; tx < first + tilesPerSide; tx += 1) {
+            const bool odd = ((tx + ty) & 1) != 0;
+
+            instances[i] = (Grid_Instance) {
+                .offset = (V3d) {tx * tileWidth, ty * tileHeight, 0.0},
+                .color = odd ? altColor : color
+            };
+
+            i += 1;
+        }
+    }
+}
+
+void Grid_InitProjection(Grid_Projection *const proj) {
+    *proj = (Grid_Projection) { 0 };
+}
+
+void Grid_DeinitProjection(Grid_Projection *const proj) {
+    // All six arrays share the allocation of `x1`.
+    Mem_Free(proj->x1);
+    Mem_Free(proj->lineIndex);
+    *proj = (Grid_Projection) { 0 };
+}
+
+void Grid_ReserveProjection(Grid_Projection *const proj, const size_t numLines) {
+    if (numLines <= proj->linesCap) {
+        return;
+    }
+
+    double *const block = Mem_ReallocTagged(proj->x1, 6 * numLines * sizeof(double), MEM_TAG_GRID);
+
+    proj->x1 = block;
+    proj->y1 = block + numLines;
+    proj->z1 = block + numLines * 2;
+    proj->x2 = block + numLines * 3;
+    proj->y2 = block + numLines * 4;
+    proj->z2 = block + numLines * 5;
+    proj->lineIndex = Mem_ReallocTagged(proj->lineIndex, numLines * sizeof(int), MEM_TAG_GRID);
+    proj->linesCap = numLines;
+}
+
+// 48.16 fixed point.
+#define GRID_FIXED_ONE 65536.0
+
+// Largest magnitude kept by `ToFixed`. Far beyond any useful pixel coordinate.
+#define GRID_FIXED_LIMIT 70368744177664.0 // 2^46
+
+static inline int64_t ToFixed(double value) {
+    if (value > GRID_FIXED_LIMIT) { value = GRID_FIXED_LIMIT; }
+    else if (value < -GRID_FIXED_LIMIT) { value = -GRID_FIXED_LIMIT; }
+
+    return (int64_t)llround(value * GRID_FIXED_ONE);
+}
+
+void Grid_Progression(const double first, const double step, const size_t n,
+    double *const out)
+{
+    const int64_t fixedStep = ToFixed(step);
+    int64_t acc = ToFixed(first);
+
+    // Plain induction variable and independent stores so that
+    // the compiler is free to vectorize the loop.
+    for (size_t i = 0; i < n; i += 1) {
+        out[i] = (double)acc * (1.0 / GRID_FIXED_ONE);
+        acc += fixedStep;
+    }
+}
+
+// Generate `n` parallel lines into `proj` starting at index `at`.
+// Line i goes from `start + i * step` to `start + i * step + span`.
+static void GenerateLines(Grid_Projection *const proj, const size_t at, const size_t n,
+    const V3d start, const V3d step, const V3d span)
+{
+    const V3d end = V3d_Add(start, span);
+
+    Grid_Progression(start.x, step.x, n, proj->x1 + at);
+    Grid_Progression(start.y, step.y, n, proj->y1 + at);
+    Grid_Progression(start.z, step.z, n, proj->z1 + at);
+    Grid_Progression(end.x, step.x, n, proj->x2 + at);
+    Grid_Progression(end.y, step.y, n, proj->y2 + at);
+    Grid_Progression(end.z, step.z, n, proj->z2 + at);
+}
+
+void Grid_Project(const Grid *const grid, const Ortho_View *const view,
+    Grid_Projection *const proj)
+{
+    const size_t numRows = (size_t)grid->numCellsY + 1;
+    const size_t numCols = (size_t)grid->numCellsX + 1;
+
+    Grid_ReserveProjection(proj, numRows + numCols);
+    proj->numLines = numRows + numCols;
+
+    // The only projections done for the whole grid.
+    const V3d origin = Ortho_Project(view, (V3d) {0.0, 0.0, 0.0});
+    const V3d stepX = Ortho_ProjectOffset(view, (V3d) {grid->cellWidth, 0.0, 0.0});
+    const V3d stepY = Ortho_ProjectOffset(view, (V3d) {0.0, grid->cellWidth, 0.0});
+
+    const V3d spanX = V3d_Mul(stepX, grid->numCellsX);
+    const V3d spanY = V3d_Mul(stepY, grid->numCellsY);
+
+    // Lines on xy plane parallel to x-axis.
+    GenerateLines(proj, 0, numRows, origin, stepY, spanX);
+
+    // Lines on xy plane parallel to y-axis.
+    GenerateLines(proj, numRows, numCols, origin, stepX, spanY);
+
+    proj->numRowLines = numRows;
+    proj->lineStride = 1;
+
+    for (size_t i = 0; i < numRows; i += 1) {
+        proj->lineIndex[i] = (int)i;
+    }
+
+    for (size_t i = 0; i < numCols; i += 1) {
+        proj->lineIndex[numRows + i] = (int)i;
+    }
+
+    // Every endpoint lies within the projected corners of the grid.
+    const V3d corners[4] = {
+        origin,
+        V3d_Add(origin, spanX),
+        V3d_Add(origin, spanY),
+        V3d_Add(V3d_Add(origin, spanX), spanY)
+    };
+
+    proj->min = corners[0];
+    proj->max = corners[0];
+
+    for (int i = 1; i < 4; i += 1) {
+        proj->min.x = fmin(proj->min.x, corners[i].x);
+        proj->min.y = fmin(proj->min.y, corners[i].y);
+        proj->min.z = fmin(proj->min.z, corners[i].z);
+        proj->max.x = fmax(proj->max.x, corners[i].x);
+        proj->max.y = fmax(proj->max.y, corners[i].y);
+        proj->max.z = fmax(proj->max.z, corners[i].z);
+    }
+}
+
+void Grid_TransformProjection(const Grid_Projection *const from,
+    const Ortho_ScreenTransform *const transform, Grid_Projection *const to)
+{
+    const size_t n = from->numLines;
+    const double scale = transform->scale;
+    const V3d offset = transform->offset;
+
+    Grid_ReserveProjection(to, n);
+    to->numLines = n;
+
+    // Separate loops over separate arrays so each one vectorizes.
+    for (size_t i = 0; i < n; i += 1) { to->x1[i] = scale * from->x1[i] + offset.x; }
+    for (size_t i = 0; i < n; i += 1) { to->y1[i] = scale * from->y1[i] + offset.y; }
+    for (size_t i = 0; i < n; i += 1) { to->z1[i] = from->z1[i] + offset.z; }
+    for (size_t i = 0; i < n; i += 1) { to->x2[i] = scale * from->x2[i] + offset.x; }
+    for (size_t i = 0; i < n; i += 1) { to->y2[i] = scale * from->y2[i] + offset.y; }
+    for (size_t i = 0; i < n; i += 1) { to->z2[i] = from->z2[i] + offset.z; }
+
+    memcpy(to->lineIndex, from->lineIndex, n * sizeof(int));
+    to->numRowLines = from->numRowLines;
+    to->lineStride = from->lineStride;
+
+    // Scale is positive so the box keeps its orientation.
+    to->min = Ortho_TransformPoint(transform, from->min);
+    to->max = Ortho_TransformPoint(transform, from->max);
+}
+
+// Copy line `i` of `from` to line `k` of `to`.
+static inline void CopyLine(const Grid_Projection *const from, const size_t i,
+    Grid_Projection *const to, const size_t k)
+{
+    to->x1[k] = from->x1[i];
+    to->y1[k] = from->y1[i];
+    to->z1[k] = from->z1[i];
+    to->x2[k] = from->x2[i];
+    to->y2[k] = from->y2[i];
+    to->z2[k] = from->z2[i];
+    to->lineIndex[k] = from->lineIndex[i];
+}
+
+void Grid_ThinProjection(const Grid *const grid, const Grid_Projection *const from,
+    const int stride, Grid_Projection *const to)
+{
+    // Same order as `Grid_Project`: lines parallel to the x-axis, then to the y-axis.
+    const size_t families[2] = {(size_t)grid->numCellsY + 1, (size_t)grid->numCellsX + 1};
+
+    Grid_ReserveProjection(to, from->numLines);
+
+    size_t at = 0;
+    size_t k = 0;
+
+    for (int f = 0; f < 2; f += 1) {
+        const size_t n = families[f];
+
+        for (size_t i = 0; i < n; i += (size_t)stride) {
+            CopyLine(from, at + i, to, k);
+            k += 1;
+        }
+
+        // Always keep the far edge.
+        if ((n - 1) % (size_t)stride != 0) {
+            CopyLine(from, at + n - 1, to, k);
+            k += 1;
+        }
+
+        if (f == 0) {
+            to->numRowLines = k;
+        }
+
+        at += n;
+    }
+
+    to->numLines = k;
+    to->lineStride = stride;
+    to->min = from->min;
+    to->max = from->max;
+}
+
+void Grid_InitProjectionCache(Grid_ProjectionCache *const cache) {
+    *cache = (Grid_ProjectionCache) { .valid = false };
+    Grid_InitProjection(&cache->base);
+}
+
+void Grid_DeinitProjectionCache(Grid_ProjectionCache *const cache) {
+    Grid_DeinitProjection(&cache->base);
+    *cache = (Grid_ProjectionCache) { .valid = false };
+}
+
+bool Grid_ProjectCached(const Grid *const grid, const Ortho_View *const view,
+    Grid_ProjectionCache *const cache, Grid_Projection *const proj)
+{
+    Ortho_ScreenTransform transform;
+
+    // Always transform from the full projection, not the previous frame,
+    // so that rounding does not build up while panning.
+    if (cache->valid && Ortho_GetScreenTransform(&cache->view, view, &transform)) {
+        Grid_TransformProjection(&cache->base, &transform, proj);
+        cache->numTransformed += 1;
+        return true;
+    }
+
+    Grid_Project(grid, view, &cache->base);
+    cache->view = *view;
+    cache->valid = true;
+    cache->numProjected += 1;
+
+    const Ortho_ScreenTransform identity = { .scale = 1.0, .offset = {0.0, 0.0, 0.0} };
+    Grid_TransformProjection(&cache->base, &identity, proj);
+    return false;
+}
+
+// Append line `k` of `proj`, shifted by `shift`, to the current run of `lines`.
+// Unless the instance is `inside` the screen, clip it or drop it if it cannot be seen.
+static inline void EmitLine(const Grid_Projection *const proj, const size_t k, const V3d shift,
+    const bool inside, const Ortho_View *const view, Lines *const lines)
+{
+    Lines_Seg seg = {
+        (float)(proj->x1[k] + shift.x), (float)(proj->y1[k] + shift.y),
+        (float)(proj->x2[k] + shift.x), (float)(proj->y2[k] + shift.y)
+    };
+
+    if (!inside) {
+        // Endpoint is behind projection plane. Cannot be seen.
+        if (proj->z1[k] + shift.z <= 0.0 || proj->z2[k] + shift.z <= 0.0) {
+            return;
+        }
+
+        if (!Lines_Clip(&seg, view->screenWidth, view->screenHeight)) {
+            return;
+        }
+    }
+
+    Lines_Push(lines, seg);
+}
+
+// Lines of one direction of a projection, with the grid index `first` added
+// to make their indices world indices.
+typedef struct Family {
+    size_t begin;
+    size_t end;
+    int first;
+    bool isRow;
+    int firstMajor; // World index of the first major line at or after the first line.
+} Family;
+
+// Return the line of `family` with world index `world`, or `SIZE_MAX` if there
+// is none or it was thinned out.
+static inline size_t FindLine(const Grid_Projection *const proj, const Family *const family,
+    const int world)
+{
+    const int index = world - family->first;
+
+    if (family->begin == family->end || index < 0 || index > proj->lineIndex[family->end - 1]) {
+        return SIZE_MAX;
+    }
+
+    if (proj->lineStride == 1) {
+        return family->begin + (size_t)index;
+    }
+
+    if (index % proj->lineStride == 0) {
+        return family->begin + (size_t)(index / proj->lineStride);
+    }
+
+    return (index == proj->lineIndex[family->end - 1]) ? family->end - 1 : SIZE_MAX;
+}
+
+// Return whether world line `world` of `family` is highlighted by `styles`.
+static inline bool IsHighlighted(const Family *const family, const Grid_Styles *const styles,
+    const int world)
+{
+    return family->isRow && styles->highlight
+        && (world == styles->highlightRow || world == styles->highlightRow + 1);
+}
+
+// Return the smallest multiple of `m` (positive) that is at least `n`.
+static inline int CeilMultiple(const int n, const int m) {
+    const int r = n % m;
+    return (r == 0) ? n : (r > 0) ? n + m - r : n - r;
+}
+
+// Return lines [`begin`, `end`) of `proj` for an instance whose lines start
+// at world index `first` in their direction.
+static inline Family MakeFamily(const Grid_Projection *const proj, const size_t begin,
+    const size_t end, const int first, const bool isRow, const Grid_Styles *const styles)
+{
+    Family family = {begin, end, first, isRow, 0};
+
+    if (styles->majorEvery > 0 && begin < end) {
+        family.firstMajor = CeilMultiple(proj->lineIndex[begin] + first, styles->majorEvery);
+    }
+
+    return family;
+}
+
+// Return the first line of `family` at or after world index `*world`, a multiple
+// of `styles->majorEvery`, and step `*world` to the next multiple after it.
+// Return `family->end` if there is none.
+static inline size_t NextMajor(const Grid_Projection *const proj, const Family *const family,
+    const Grid_Styles *const styles, int *const world)
+{
+    if (styles->majorEvery <= 0 || family->begin == family->end) {
+        return family->end;
+    }
+
+    const int last = proj->lineIndex[family->end - 1] + family->first;
+
+    while (*world <= last) {
+        const size_t k = FindLine(proj, family, *world);
+        *world += styles->majorEvery;
+
+        if (k != SIZE_MAX) {
+            return k;
+        }
+    }
+
+    return family->end;
+}
+
+// Append the lines of `family` that `styles` leaves in the instance's color
+// to the current run. The styled lines are found from their world indices,
+// and the lines between them are appended without tests.
+static void EmitUnstyledLines(const Grid_Projection *const proj, const Family *const family,
+    const Grid_Styles *const styles, const V3d shift, const bool inside,
+    const Ortho_View *const view, Lines *const lines)
+{
+    if (family->begin == family->end) {
+        return;
+    }
+
+    // Axis and highlighted lines, in increasing order. Lines not found are
+    // `SIZE_MAX`, and so is the last entry, which ends the list.
+    size_t others[4] = {SIZE_MAX, SIZE_MAX, SIZE_MAX, SIZE_MAX};
+    others[0] = FindLine(proj, family, 0);
+
+    if (family->isRow && styles->highlight) {
+        others[1] = FindLine(proj, family, styles->highlightRow);
+        others[2] = FindLine(proj, family, styles->highlightRow + 1);
+    }
+
+    for (int i = 1; i < 3; i += 1) {
+        for (int j = i; j > 0 && others[j] < others[j - 1]; j -= 1) {
+            const size_t t = others[j];
+            others[j] = others[j - 1];
+            others[j - 1] = t;
+        }
+    }
+
+    int majorWorld = family->firstMajor;
+    size_t major = NextMajor(proj, family, styles, &majorWorld);
+    int other = 0;
+    size_t k = family->begin;
+
+    while (k < family->end) {
+        const size_t stop = (others[other] < major) ? others[other] : major;
+        const size_t until = (stop < family->end) ? stop : family->end;
+
+        for (; k < until; k += 1) {
+            EmitLine(proj, k, shift, inside, view, lines);
+        }
+
+        if (until == family->end) {
+            break;
+        }
+
+        // Step over the styled line.
+        k = stop + 1;
+
+        if (major == stop) {
+            major = NextMajor(proj, family, styles, &majorWorld);
+        }
+
+        while (others[other] == stop) {
+            other += 1;
+        }
+    }
+}
+
+// Like `EmitLine`, but in a run of `color`, started if the current run is another color.
+// Styles most instances have no lines of then never add a run.
+static inline void EmitStyledLine(const Grid_Projection *const proj, const size_t k,
+    const Rgba color, const V3d shift, const bool inside, const Ortho_View *const view,
+    Lines *const lines)
+{
+    if (!Rgba_Equal(lines->runs[lines->numRuns - 1].color, color)) {
+        Lines_SetColor(lines, color);
+    }
+
+    EmitLine(proj, k, shift, inside, view, lines);
+}
+
+// Append the lines of one instance that `styles` gives their own color,
+// with one run per style, after the instance's lines in its own color.
+// Each styled line is found from its world index, not by testing every line.
+static void EmitStyledLines(const Grid_Projection *const proj, const Family families[2],
+    const Grid_Styles *const styles, const V3d shift, const bool inside,
+    const Ortho_View *const view, Lines *const lines)
+{
+    // Highlighted row: two lines parallel to the x-axis.
+    if (styles->highlight) {
+        for (int w = styles->highlightRow; w <= styles->highlightRow + 1; w += 1) {
+            const size_t k = FindLine(proj, &families[0], w);
+
+            if (k != SIZE_MAX) {
+                EmitStyledLine(proj, k, styles->highlightColor, shift, inside, view, lines);
+            }
+        }
+    }
+
+    for (int f = 0; f < 2; f += 1) {
+        const size_t k = FindLine(proj, &families[f], 0);
+
+        if (k != SIZE_MAX && !IsHighlighted(&families[f], styles, 0)) {
+            EmitStyledLine(proj, k, styles->axisColor, shift, inside, view, lines);
+        }
+    }
+
+    if (styles->majorEvery <= 0) {
+        return;
+    }
+
+    for (int f = 0; f < 2; f += 1) {
+        const Family *const family = &families[f];
+
+        if (family->begin == family->end) {
+            continue;
+        }
+
+        const int last = proj->lineIndex[family->end - 1] + family->first;
+
+        for (int w = family->firstMajor; w <= last; w += styles->majorEvery) {
+            if (w == 0 || IsHighlighted(family, styles, w)) {
+                continue;
+            }
+
+            const size_t k = FindLine(proj, family, w);
+
+            if (k != SIZE_MAX) {
+                EmitStyledLine(proj, k, styles->majorColor, shift, inside, view, lines);
+            }
+        }
+    }
+}
+
+size_t Grid_EmitInstances(const Grid_Projection *const proj, const Ortho_View *const view,
+    const Grid_Instance *const instances, const size_t numInstances,
+    const Grid_Styles *const styles, Lines *const lines)
+{
+    const double maxX = view->screenWidth - 1.0;
+    const double maxY = view->screenHeight - 1.0;
+    const double invCellWidth = (styles != NULL) ? 1.0 / styles->cellWidth : 0.0;
+
+    size_t numDrawn = 0;
+
+    for (size_t i = 0; i < numInstances; i += 1) {
+        const V3d shift = Ortho_ProjectOffset(view, instances[i].offset);
+
+        const V3d min = V3d_Add(proj->min, shift);
+        const V3d max = V3d_Add(proj->max, shift);
+
+        // Whole instance behind the camera or off screen.
+        if (max.z <= 0.0
+            || max.x < 0.0 || min.x > maxX
+            || max.y < 0.0 || min.y > maxY)
+        {
+            continue;
+        }
+
+        numDrawn += 1;
+
+        // Entirely on screen and in front: no per-line tests needed.
+        const bool inside = min.z > 0.0
+            && min.x >= 0.0 && max.x <= maxX
+            && min.y >= 0.0 && max.y <= maxY;
+
+        Lines_SetColor(lines, instances[i].color);
+
+        if (styles == NULL) {
+            for (size_t k = 0; k < proj->numLines; k += 1) {
+                EmitLine(proj, k, shift, inside, view, lines);
+            }
+
+            continue;
+        }
+
+        const Family families[2] = {
+            MakeFamily(proj, 0, proj->numRowLines,
+                (int)lround(instances[i].offset.y * invCellWidth), true, styles),
+            MakeFamily(proj, proj->numRowLines, proj->numLines,
+                (int)lround(instances[i].offset.x * invCellWidth), false, styles)
+        };
+
+        for (int f = 0; f < 2; f += 1) {
+            EmitUnstyledLines(proj, &families[f], styles, shift, inside, view, lines);
+        }
+
+        EmitStyledLines(proj, families, styles, shift, inside, view, lines);
+    }
+
+    return numDrawn;
+}
+
+typedef struct EmitJob {
+    const Grid_Projection *proj;
+    const Ortho_View *view;
+    const Grid_Instance *instances;
+    const Grid_Styles *styles;
+    Lines *chunkLines;
+} EmitJob;
+
+static void EmitChunk(void *ctx, size_t chunk, size_t begin, size_t end) {
+    const EmitJob *const job = ctx;
+    Lines *const lines = &job->chunkLines[chunk];
+
+    Lines_Clear(lines);
+    Grid_EmitInstances(job->proj, job->view, job->instances + begin, end - begin,
+        job->styles, lines);
+}
+
+void Grid_EmitInstancesParallel(const Grid_Projection *const proj, const Ortho_View *const view,
+    const Grid_Instance *const instances, const size_t numInstances,
+    const Grid_Styles *const styles,
+    Jobs *const jobs, Lines *const chunkLines, const size_t numChunks,
+    Lines *const lines)
+{
+    EmitJob job = {
+        .proj = proj,
+        .view = view,
+        .instances = instances,
+        .styles = styles,
+        .chunkLines = chunkLines
+    };
+
+    const size_t chunkSize = Grid_ChunkSize(numInstances, numChunks);
+
+    Jobs_Counter counter;
+    Jobs_InitCounter(&counter);
+    Jobs_ParallelFor(jobs, &counter, numInstances, chunkSize, EmitChunk, &job);
+    Jobs_Wait(jobs, &counter);
+
+    for (size_t k = 0; k < Jobs_NumChunks(numInstances, chunkSize); k += 1) {
+        Lines_Append(lines, &chunkLines[k]);
+    }
+}
+
+// Return the index of the cell containing coordinate `v`, saturated to the range of int.
+static int CellIndex(const double v, const double invCellWidth) {
+    const double i = floor(v * invCellWidth);
+
+    if (i <= (double)INT_MIN) { return INT_MIN + 1; }
+    if (i >= (double)INT_MAX) { return INT_MAX; }
+
+    return (int)i;
+}
+
+// Set `*cell` to the cell at plane hit `hit`. Return false if it is behind the camera.
+static bool CellAtHit(const V3d hit, const double invCellWidth, Grid_Cell *const cell) {
+    if (hit.z <= 0.0) {
+        *cell = GRID_NO_CELL;
+        return false;
+    }
+
+    *cell = (Grid_Cell) {
+        CellIndex(hit.x, invCellWidth),
+        CellIndex(hit.y, invCellWidth)
+    };
+    return true;
+}
+
+bool Grid_PickCell(const Grid *const grid, const Ortho_View *const view,
+    const double px, const double py, Grid_Cell *const cell)
+{
+    Ortho_PlaneMap map;
+
+    if (!Ortho_InitPlaneMap(view, 0.0, &map)) {
+        *cell = GRID_NO_CELL;
+        return false;
+    }
+
+    return CellAtHit(Ortho_UnprojectToPlane(&map, px, py), 1.0 / grid->cellWidth, cell);
+}
+
+size_t Grid_PickCells(const Grid *const grid, const Ortho_PlaneMap *const map,
+    const float *const px, const float *const py, const size_t n, Grid_Cell *const cells)
+{
+    const double invCellWidth = 1.0 / grid->cellWidth;
+    size_t numHits = 0;
+
+    for (size_t i = 0; i < n; i += 1) {
+        const V3d hit = Ortho_UnprojectToPlane(map, px[i], py[i]);
+        numHits += CellAtHit(hit, invCellWidth, &cells[i]) ? 1 : 0;
+    }
+
+    return numHits;
+}
@@ -0,0 +1,206 @@
+#ifndef GRID_H
+#define GRID_H
+
+// Flat grid of square cells on the z = 0 plane, drawn as any number of
+// translated and recolored copies (instances).
+//
+// Because the projection is affine, a translated copy of the grid projects to
+// the projected template shifted by a constant screen-space offset.
+// The template is projected once per frame and each instance only costs
+// one offset projection, a bounding box test and the additions per line.
+
+#include <limits.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "Jobs.h"
+#include "Lines.h"
+#include "Ortho.h"
+#include "Rgba.h"
+#include "V3d.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Cell (0, 0) has a corner at the world origin.
+// Cells extend in the positive x and y directions.
+typedef struct Grid {
+    double cellWidth;
+    int numCellsX;
+    int numCellsY;
+} Grid;
+
+typedef struct Grid_Instance {
+    V3d offset; // World-space translation of the template grid.
+    Rgba color;
+} Grid_Instance;
+
+// Index of a cell of the infinite grid that the template and its instances
+// are aligned to. Cell (x, y) covers world
+// [x * cellWidth, (x + 1) * cellWidth) by [y * cellWidth, (y + 1) * cellWidth) on z = 0.
+// Instances with offsets that are multiples of the cell width line up with it.
+typedef struct Grid_Cell {
+    int x;
+    int y;
+} Grid_Cell;
+
+// Returned for pixels whose ray does not meet z = 0 in front of the camera.
+#define GRID_NO_CELL ((Grid_Cell) {INT_MIN, INT_MIN})
+
+// The template grid projected for one view.
+// Endpoints are stored as separate arrays of pixel x, pixel y and depth
+// so the generator and the instance loop can run over them in lockstep.
+typedef struct Grid_Projection {
+    double *x1;
+    double *y1;
+    double *z1;
+    double *x2;
+    double *y2;
+    double *z2;
+    size_t numLines;
+    size_t linesCap;
+
+    // Lines [0, numRowLines) are parallel to the x-axis, the rest to the y-axis.
+    // `lineIndex` is the index of each line within its direction in the grid:
+    // line i parallel to the x-axis is at y = i * cellWidth, and likewise for x.
+    // Line k of a direction has index k * `lineStride`, except that the far
+    // edge is always the last line.
+    int *lineIndex;
+    size_t numRowLines;
+    int lineStride;
+
+    // Bounding box of all projected endpoints.
+    V3d min;
+    V3d max;
+} Grid_Projection;
+
+// The last full projection of a grid and the view it was made for.
+// Views that only pan or zoom relative to it are derived from it with
+// `Grid_TransformProjection` instead of projecting again.
+typedef struct Grid_ProjectionCache {
+    Grid_Projection base;
+    Ortho_View view; // What `base` was projected for.
+    bool valid;
+
+    uint64_t numProjected;   // Views that needed a full projection.
+    uint64_t numTransformed; // Views derived from `base`.
+} Grid_ProjectionCache;
+
+// Colors a styled instance can have: its own and the three of `Grid_Styles`.
+#define GRID_NUM_STYLES 4
+
+// How `Grid_EmitInstances` colors lines. A line takes the first of these that
+// applies, by its position in the world, and otherwise the color of its instance.
+// Instance offsets must be multiples of the cell width.
+typedef struct Grid_Styles {
+    double cellWidth; // Of the grid.
+
+    bool highlight;   // Whether to highlight the lines bounding cell row `highlightRow`.
+    int highlightRow;
+    Rgba highlightColor;
+
+    Rgba axisColor;   // Lines on x = 0 or y = 0.
+
+    int majorEvery;   // Lines every this many cells from the axes. 0 for none.
+    Rgba majorColor;
+} Grid_Styles;
+
+// Return the number of lines drawn for `grid`.
+static inline size_t Grid_NumLines(const Grid *const grid) {
+    return (size_t)(grid->numCellsX + 1) + (size_t)(grid->numCellsY + 1);
+}
+
+// Fill `instances` with a `tilesPerSide` by `tilesPerSide` field of copies of `grid`
+// placed edge to edge and centered on the world origin, in two alternating colors.
+// A single tile is the grid at the world origin in the first color.
+void Grid_MakeTiles(const Grid *const grid, const int tilesPerSide,
+    const Rgba color, const Rgba altColor, Grid_Instance *const instances);
+
+// Initialize `proj` as empty.
+void Grid_InitProjection(Grid_Projection *const proj);
+
+// Free the internals of `proj`.
+void Grid_DeinitProjection(Grid_Projection *const proj);
+
+// Make room for at least `numLines` lines in `proj`.
+void Grid_ReserveProjection(Grid_Projection *const proj, const size_t numLines);
+
+// Project the lines of `grid` (without any instance offset) into `proj`.
+// Only the grid origin and the screen-space steps between neighboring lines
+// are projected. Every endpoint is then generated by `Grid_Progression`.
+void Grid_Project(const Grid *const grid, const Ortho_View *const view,
+    Grid_Projection *const proj);
+
+// Set `to` to `from` with every endpoint and the bounding box moved by `transform`.
+void Grid_TransformProjection(const Grid_Projection *const from,
+    const Ortho_ScreenTransform *const transform, Grid_Projection *const to);
+
+// Set `to` to every `stride`-th line of `from` in each direction, plus the
+// lines on the edges of the grid. `from` must be a projection of `grid`.
+void Grid_ThinProjection(const Grid *const grid, const Grid_Projection *const from,
+    const int stride, Grid_Projection *const to);
+
+// Initialize `cache` as empty.
+void Grid_InitProjectionCache(Grid_ProjectionCache *const cache);
+
+// Free the internals of `cache`.
+void Grid_DeinitProjectionCache(Grid_ProjectionCache *const cache);
+
+// Set `proj` to `grid` projected for `view`. If `view` has the same orientation
+// and screen size as the cached projection, transform that instead of projecting.
+// Otherwise project and cache the result. `grid` must be the same on every call.
+// Return true if the cached projection was used.
+bool Grid_ProjectCached(const Grid *const grid, const Ortho_View *const view,
+    Grid_ProjectionCache *const cache, Grid_Projection *const proj);
+
+// Write the arithmetic progression first, first + step, first + 2 * step, ...
+// of `n` values to `out` by repeated addition.
+// The sum is accumulated in 48.16 fixed point, so additions are exact and only
+// the rounding of `first` and `step` to fixed point adds error: at most
+// `n` * 2^-17 plus the rounding of `first` (2^-17) per value.
+void Grid_Progression(const double first, const double step, const size_t n,
+    double *const out);
+
+// Append the lines of every instance that can be seen to `lines`.
+// Instances entirely off screen or behind the camera are skipped as a whole.
+// Lines are colored by `styles`, or all in their instance's color if NULL.
+// Each instance's lines are grouped by color, so an instance adds at most
+// `GRID_NUM_STYLES` runs with styles and 1 without. Reserve runs for that.
+// Return the number of instances that were not culled.
+size_t Grid_EmitInstances(const Grid_Projection *const proj, const Ortho_View *const view,
+    const Grid_Instance *const instances, const size_t numInstances,
+    const Grid_Styles *const styles, Lines *const lines);
+
+// Like `Grid_EmitInstances` but split into up to `numChunks` chunks of instances
+// run on `jobs`. Chunk k writes to `chunkLines[k]`, which are then appended to
+// `lines` in order so the result matches `Grid_EmitInstances`.
+// Waits for the chunks to finish.
+void Grid_EmitInstancesParallel(const Grid_Projection *const proj, const Ortho_View *const view,
+    const Grid_Instance *const instances, const size_t numInstances,
+    const Grid_Styles *const styles,
+    Jobs *const jobs, Lines *const chunkLines, const size_t numChunks,
+    Lines *const lines);
+
+// Set `*cell` to the cell under pixel (px, py) of `view`.
+// Return false, and set `GRID_NO_CELL`, if there is none in front of the camera.
+bool Grid_PickCell(const Grid *const grid, const Ortho_View *const view,
+    const double px, const double py, Grid_Cell *const cell);
+
+// Like `Grid_PickCell` for `n` pixels at once. `map` is for the plane z = 0.
+// Costs a few multiply-adds per pixel. Return the number of pixels that hit a cell.
+size_t Grid_PickCells(const Grid *const grid, const Ortho_PlaneMap *const map,
+    const float *const px, const float *const py, const size_t n, Grid_Cell *const cells);
+
+// Return the number of instances per chunk used by `Grid_EmitInstancesParallel`.
+static inline size_t Grid_ChunkSize(const size_t numInstances, const size_t numChunks) {
+    const size_t size = (numInstances + numChunks - 1) / numChunks;
+    return (size == 0) ? 1 : size;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,403 @@
+#include "Heatmap.h"
+
+#include <limits.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "Mem.h"
+#include "Sdlu.h"
+
+// Least depth of a visible cell. Cells closer are partly behind the camera.
+#define NEAR_DEPTH 1e-9
+
+void Heatmap_Init(Heatmap *const heatmap, const Grid *const grid,
+    const Grid_Cell firstCell, const int numCellsX, const int numCellsY)
+{
+    const size_t numCells = (size_t)numCellsX * (size_t)numCellsY;
+
+    // Vertex indices are ints.
+    if (numCellsX <= 0 || numCellsY <= 0 || numCells > (size_t)INT_MAX / 6) {
+        fprintf(stderr, "%s: Bad size %d by %d\n", __func__, numCellsX, numCellsY);
+        exit(1);
+    }
+
+    *heatmap = (Heatmap) {
+        .firstCell = firstCell,
+        .numCellsX = numCellsX,
+        .numCellsY = numCellsY,
+        .cellWidth = grid->cellWidth,
+        .values = Mem_AllocTagged(numCells * sizeof(float), MEM_TAG_HEATMAP),
+        .dirtyCells = Mem_AllocTagged(numCells * sizeof(uint32_t), MEM_TAG_HEATMAP),
+        .numDirty = 0,
+        .isDirty = Mem_AllocTagged(numCells, MEM_TAG_HEATMAP),
+        .allDirty = true,
+        .positions = Mem_AllocTagged(numCells * 4 * sizeof(SDL_FPoint), MEM_TAG_HEATMAP),
+        .vertexColors = Mem_AllocTagged(numCells * 4 * sizeof(SDL_Color), MEM_TAG_HEATMAP),
+        .indices = Mem_AllocTagged(numCells * 6 * sizeof(int), MEM_TAG_HEATMAP),
+        .numIndices = 0,
+        .rowFirst = Mem_AllocTagged((size_t)numCellsY * sizeof(int), MEM_TAG_HEATMAP),
+        .rowLast = Mem_AllocTagged((size_t)numCellsY * sizeof(int), MEM_TAG_HEATMAP),
+        .hasView = false
+    };
+
+    memset(heatmap->values, 0, numCells * sizeof(float));
+    memset(heatmap->isDirty, 0, numCells);
+
+    // Cells off screen are never drawn, but keep their positions defined.
+    memset(heatmap->positions, 0, numCells * 4 * sizeof(SDL_FPoint));
+
+    const Rgba grays[2] = {{0, 0, 0, 255}, {255, 255, 255, 255}};
+    Heatmap_SetColorMap(heatmap, grays, 2, 0.0f, 1.0f);
+}
+
+void Heatmap_Deinit(Heatmap *const heatmap) {
+    Mem_Free(heatmap->values);
+    Mem_Free(heatmap->dirtyCells);
+    Mem_Free(heatmap->isDirty);
+    Mem_Free(heatmap->positions);
+    Mem_Free(heatmap->vertexColors);
+    Mem_Free(heatmap->indices);
+    Mem_Free(heatmap->rowFirst);
+    Mem_Free(heatmap->rowLast);
+    *heatmap = (Heatmap) { 0 };
+}
+
+void Heatmap_SetColorMap(Heatmap *const heatmap, const Rgba *const stops, const int numStops,
+    const float minValue, const float maxValue)
+{
+    for (int k = 0; k < HEATMAP_COLOR_MAP_SIZE; k += 1) {
+        // Position among the stops.
+        const double pos = (numStops > 1)
+            ? (double)k * (numStops - 1) / (HEATMAP_COLOR_MAP_SIZE - 1) : 0.0;
+        const int s = (pos >= numStops - 1) ? numStops - 1 : (int)pos;
+        const int t = (s + 1 < numStops) ? s + 1 : s;
+        const double f = pos - s;
+
+        const Rgba a = stops[s];
+        const Rgba b = stops[t];
+
+        heatmap->colors[k] = (Rgba) {
+            (uint8_t)lround(a.r + (b.r - a.r) * f),
+            (uint8_t)lround(a.g + (b.g - a.g) * f),
+            (uint8_t)lround(a.b + (b.b - a.b) * f),
+            (uint8_t)lround(a.a + (b.a - a.a) * f)
+        };
+    }
+
+    heatmap->minValue = minValue;
+    heatmap->maxValue = maxValue;
+    heatmap->allDirty = true;
+}
+
+// Return true if `view` maps the z = 0 plane the same way as `heatmap->view`.
+static bool SameView(const Heatmap *const heatmap, const Ortho_View *const view) {
+    const Ortho_View *const old = &heatmap->view;
+
+    return heatmap->hasView
+        && old->screenWidth == view->screenWidth && old->screenHeight == view->screenHeight
+        && memcmp(&old->origin, &view->origin, sizeof(V3d)) == 0
+        && memcmp(&old->axisX, &view->axisX, sizeof(V3d)) == 0
+        && memcmp(&old->axisY, &view->axisY, sizeof(V3d)) == 0;
+}
+
+// Narrow [*lo, *hi] to the i where base + i * slope >= bound.
+static void KeepAtLeast(const double base, const double slope, const double bound,
+    double *const lo, double *const hi)
+{
+    if (slope > 0.0) {
+        *lo = fmax(*lo, (bound - base) / slope);
+    }
+    else if (slope < 0.0) {
+        *hi = fmin(*hi, (bound - base) / slope);
+    }
+    else if (base < bound) {
+        *lo = 1.0;
+        *hi = 0.0;
+    }
+}
+
+// Screen-space steps of one cell along x and y in `view`, and the first corner of cell (0, 0).
+typedef struct CellSteps {
+    V3d stepX;
+    V3d stepY;
+    V3d first;
+} CellSteps;
+
+static CellSteps GetCellSteps(const Heatmap *const heatmap, const Ortho_View *const view) {
+    return (CellSteps) {
+        .stepX = Ortho_ProjectOffset(view, (V3d) {heatmap->cellWidth, 0.0, 0.0}),
+        .stepY = Ortho_ProjectOffset(view, (V3d) {0.0, heatmap->cellWidth, 0.0}),
+        .first = Ortho_Project(view, (V3d) {
+            heatmap->firstCell.x * heatmap->cellWidth,
+            heatmap->firstCell.y * heatmap->cellWidth,
+            0.0
+        })
+    };
+}
+
+// Write the positions of cells [firstVisible, lastVisible] of row `j`.
+// Corners are found by multiplying, not adding up steps, so error does not
+// grow across a million cells.
+static inline void PlaceRow(Heatmap *const heatmap, const CellSteps *const steps,
+    const size_t j, const int firstVisible, const int lastVisible)
+{
+    const V3d stepX = steps->stepX;
+    const V3d stepY = steps->stepY;
+    const V3d rowStart = V3d_Add(steps->first, V3d_Mul(stepY, (double)j));
+
+    for (int i = firstVisible; i <= lastVisible; i += 1) {
+        const double ax = rowStart.x + i * stepX.x;
+        const double ay = rowStart.y + i * stepX.y;
+
+        SDL_FPoint *const p = &heatmap->positions[(j * (size_t)heatmap->numCellsX + (size_t)i) * 4];
+
+        p[0] = (SDL_FPoint) {(float)ax, (float)ay};
+        p[1] = (SDL_FPoint) {(float)(ax + stepX.x), (float)(ay + stepX.y)};
+        p[2] = (SDL_FPoint) {(float)(ax + stepX.x + stepY.x), (float)(ay + stepX.y + stepY.y)};
+        p[3] = (SDL_FPoint) {(float)(ax + stepY.x), (float)(ay + stepY.y)};
+    }
+}
+
+// Find the visible cells of rows [begin, end), write their positions and indices.
+// Cells within `HEATMAP_MARGIN` pixels of the screen count as visible.
+// Like grid instances, cells that are partly behind the camera are skipped.
+// The indices go where the rows' own indices would be if every cell were visible,
+// so chunks do not overlap. `Heatmap_Update` packs them afterwards.
+static void RebuildRows(void *const ctx, const size_t chunk, const size_t begin, const size_t end) {
+    Heatmap *const heatmap = ctx;
+    const Ortho_View *const view = &heatmap->view;
+    const int numCellsX = heatmap->numCellsX;
+
+    const CellSteps steps = GetCellSteps(heatmap, view);
+    const V3d stepX = steps.stepX;
+    const V3d stepY = steps.stepY;
+
+    // Every cell is the same parallelogram, so its bounding box relative to
+    // its first corner is the same too.
+    const V3d minOffset = {
+        fmin(stepX.x, 0.0) + fmin(stepY.x, 0.0),
+        fmin(stepX.y, 0.0) + fmin(stepY.y, 0.0),
+        fmin(stepX.z, 0.0) + fmin(stepY.z, 0.0)
+    };
+    const V3d maxOffset = {
+        fmax(stepX.x, 0.0) + fmax(stepY.x, 0.0),
+        fmax(stepX.y, 0.0) + fmax(stepY.y, 0.0),
+        0.0
+    };
+
+    int *const indices = heatmap->indices + begin * (size_t)numCellsX * 6;
+    size_t numIndices = 0;
+    double minDepth = INFINITY;
+    bool depthCulled = false;
+
+    for (size_t j = begin; j < end; j += 1) {
+        const V3d rowStart = V3d_Add(steps.first, V3d_Mul(stepY, (double)j));
+
+        heatmap->rowFirst[j] = 0;
+        heatmap->rowLast[j] = -1;
+
+        // Visible cells of a row are consecutive. Solve for them instead of testing each.
+        double lo = 0.0;
+        double hi = numCellsX - 1.0;
+        KeepAtLeast(rowStart.x + maxOffset.x, stepX.x, -1.0 - HEATMAP_MARGIN, &lo, &hi);
+        KeepAtLeast(-rowStart.x - minOffset.x, -stepX.x,
+            -(view->screenWidth + HEATMAP_MARGIN), &lo, &hi);
+        KeepAtLeast(rowStart.y + maxOffset.y, stepX.y, -1.0 - HEATMAP_MARGIN, &lo, &hi);
+        KeepAtLeast(-rowStart.y - minOffset.y, -stepX.y,
+            -(view->screenHeight + HEATMAP_MARGIN), &lo, &hi);
+
+        if (lo > hi) {
+            continue;
+        }
+
+        const double onScreenLo = lo;
+        const double onScreenHi = hi;
+        KeepAtLeast(rowStart.z + minOffset.z, stepX.z, NEAR_DEPTH, &lo, &hi);
+
+        if (lo != onScreenLo || hi != onScreenHi) {
+            depthCulled = true;
+        }
+
+        if (lo > hi) {
+            continue;
+        }
+
+        const int firstVisible = (int)ceil(lo);
+        const int lastVisible = (int)floor(hi);
+
+        if (firstVisible > lastVisible) {
+            continue;
+        }
+
+        heatmap->rowFirst[j] = firstVisible;
+        heatmap->rowLast[j] = lastVisible;
+
+        // Depth is linear along the row, so least at one of its ends.
+        minDepth = fmin(minDepth, rowStart.z + minOffset.z
+            + fmin(firstVisible * stepX.z, lastVisible * stepX.z));
+
+        PlaceRow(heatmap, &steps, j, firstVisible, lastVisible);
+
+        for (int i = firstVisible; i <= lastVisible; i += 1) {
+            const int base = (int)((j * (size_t)numCellsX + (size_t)i) * 4);
+            indices[numIndices + 0] = base;
+            indices[numIndices + 1] = base + 1;
+            indices[numIndices + 2] = base + 2;
+            indices[numIndices + 3] = base;
+            indices[numIndices + 4] = base + 2;
+            indices[numIndices + 5] = base + 3;
+            numIndices += 6;
+        }
+    }
+
+    heatmap->chunkCounts[chunk] = numIndices;
+    heatmap->chunkMinDepth[chunk] = minDepth;
+    heatmap->chunkDepthCulled[chunk] = depthCulled;
+}
+
+// Rewrite the positions of the visible cells of rows [begin, end) for `heatmap->view`.
+static void MoveRows(void *const ctx, const size_t chunk, const size_t begin, const size_t end) {
+    (void)chunk;
+
+    Heatmap *const heatmap = ctx;
+    const CellSteps steps = GetCellSteps(heatmap, &heatmap->view);
+
+    for (size_t j = begin; j < end; j += 1) {
+        PlaceRow(heatmap, &steps, j, heatmap->rowFirst[j], heatmap->rowLast[j]);
+    }
+}
+
+// Return true if every cell visible after `transform` of the view of the
+// visible list is in the list, and every cell in the list is still in front.
+static bool ListCovers(const Heatmap *const heatmap, const Ortho_ScreenTransform *const transform) {
+    const Ortho_View *const view = &heatmap->listView;
+    const double scale = transform->scale;
+    const V3d offset = transform->offset;
+
+    // Edges of the new screen in pixels of the list's view must stay within the margin.
+    if ((-1.0 - offset.x) / scale < -1.0 - HEATMAP_MARGIN
+        || (-1.0 - offset.y) / scale < -1.0 - HEATMAP_MARGIN
+        || (view->screenWidth - offset.x) / scale > view->screenWidth + HEATMAP_MARGIN
+        || (view->screenHeight - offset.y) / scale > view->screenHeight + HEATMAP_MARGIN)
+    {
+        return false;
+    }
+
+    // Depth only shifts. Moving away brings culled cells in front of the camera,
+    // moving closer puts listed cells behind it.
+    if (offset.z > 0.0) {
+        return !heatmap->depthCulled;
+    }
+
+    return heatmap->minDepth + offset.z >= NEAR_DEPTH;
+}
+
+// Set the vertex colors of `cell` from its value.
+static void ColorCell(Heatmap *const heatmap, const size_t cell, const float scale) {
+    const float t = (heatmap->values[cell] - heatmap->minValue) * scale;
+
+    // Also sends NaN to the first color.
+    const int k = (t > 0.0f)
+        ? ((t < HEATMAP_COLOR_MAP_SIZE - 1) ? (int)(t + 0.5f) : HEATMAP_COLOR_MAP_SIZE - 1)
+        : 0;
+
+    const Rgba c = heatmap->colors[k];
+    const SDL_Color color = {c.r, c.g, c.b, c.a};
+    SDL_Color *const v = &heatmap->vertexColors[cell * 4];
+
+    v[0] = color;
+    v[1] = color;
+    v[2] = color;
+    v[3] = color;
+}
+
+void Heatmap_Update(Heatmap *const heatmap, const Ortho_View *const view, Jobs *const jobs) {
+    if (!SameView(heatmap, view)) {
+        const size_t numRows = (size_t)heatmap->numCellsY;
+        const size_t rowsPerChunk = (numRows + HEATMAP_MAX_CHUNKS - 1) / HEATMAP_MAX_CHUNKS;
+        Ortho_ScreenTransform transform;
+
+        Jobs_Counter counter;
+        Jobs_InitCounter(&counter);
+
+        // Compared with the view of the list, not the previous frame, so small
+        // pans do not add up to cells missing at the edge.
+        if (heatmap->hasView && Ortho_GetScreenTransform(&heatmap->listView, view, &transform)
+            && ListCovers(heatmap, &transform))
+        {
+            heatmap->view = *view;
+
+            Jobs_ParallelFor(jobs, &counter, numRows, rowsPerChunk, MoveRows, heatmap);
+            Jobs_Wait(jobs, &counter);
+
+            heatmap->numMoved += 1;
+        }
+        else {
+            heatmap->view = *view;
+            heatmap->listView = *view;
+            heatmap->hasView = true;
+
+            Jobs_ParallelFor(jobs, &counter, numRows, rowsPerChunk, RebuildRows, heatmap);
+            Jobs_Wait(jobs, &counter);
+
+            // Pack the indices of each chunk after those of the chunks before it.
+            // Each chunk's indices start at or after where they are moved to.
+            size_t numIndices = 0;
+            heatmap->minDepth = INFINITY;
+            heatmap->depthCulled = false;
+
+            for (size_t k = 0; k < Jobs_NumChunks(numRows, rowsPerChunk); k += 1) {
+                const size_t start = k * rowsPerChunk * (size_t)heatmap->numCellsX * 6;
+
+                memmove(heatmap->indices + numIndices, heatmap->indices + start,
+                    heatmap->chunkCounts[k] * sizeof(int));
+                numIndices += heatmap->chunkCounts[k];
+
+                heatmap->minDepth = fmin(heatmap->minDepth, heatmap->chunkMinDepth[k]);
+                heatmap->depthCulled = heatmap->depthCulled || heatmap->chunkDepthCulled[k];
+            }
+
+            heatmap->numIndices = (int)numIndices;
+            heatmap->numRebuilt += 1;
+        }
+    }
+
+    const float range = heatmap->maxValue - heatmap->minValue;
+    const float scale = (range != 0.0f) ? (HEATMAP_COLOR_MAP_SIZE - 1) / range : 0.0f;
+
+    if (heatmap->allDirty) {
+        const size_t numCells = (size_t)heatmap->numCellsX * (size_t)heatmap->numCellsY;
+
+        for (size_t cell = 0; cell < numCells; cell += 1) {
+            ColorCell(heatmap, cell, scale);
+        }
+
+        heatmap->allDirty = false;
+    }
+    else {
+        for (size_t d = 0; d < heatmap->numDirty; d += 1) {
+            ColorCell(heatmap, heatmap->dirtyCells[d], scale);
+        }
+    }
+
+    for (size_t d = 0; d < heatmap->numDirty; d += 1) {
+        heatmap->isDirty[heatmap->dirtyCells[d]] = 0;
+    }
+
+    heatmap->numDirty = 0;
+}
+
+void Heatmap_Draw(const Heatmap *const heatmap, SDL_Renderer *const renderer) {
+    if (heatmap->numIndices == 0) {
+        return;
+    }
+
+    Sdlu_RenderGeometryRaw(renderer, NULL,
+        &heatmap->positions[0].x, (int)sizeof(SDL_FPoint),
+        heatmap->vertexColors, (int)sizeof(SDL_Color),
+        NULL, 0,
+        heatmap->numCellsX * heatmap->numCellsY * 4,
+        heatmap->indices, heatmap->numIndices);
+}
@@ -0,0 +1,134 @@
+#ifndef HEATMAP_H
+#define HEATMAP_H
+
+// Layer of filled grid cells colored from a per-cell value.
+//
+// Every cell is a quad of 4 vertices in vertex buffers that live as long as
+// the heatmap. Positions and colors are kept in separate buffers so that
+// moving cells writes only positions. Vertex colors are rewritten only for
+// cells whose value changed since the last update (dirty cells). Vertex
+// positions are rewritten only when the view changes. The list of visible
+// cells is rebuilt only when the view turns or resizes, or pans or zooms so far
+// that cells outside the list could show. It covers `HEATMAP_MARGIN` pixels
+// around the screen for that reason. Smaller pans and zooms (see
+// `Ortho_GetScreenTransform`) only move the cells of the list.
+//
+// The visible cells are drawn with one `SDL_RenderGeometryRaw` call. SDL2 has no
+// vertex buffers that persist between calls: each call copies 6 vertices per
+// visible cell, one per index, into the renderer's command queue, which goes to
+// the GPU in full every frame. Keeping cells clean saves the work of this module,
+// not that upload.
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include <SDL2/SDL.h>
+
+#include "Grid.h"
+#include "Jobs.h"
+#include "Ortho.h"
+#include "Rgba.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Entries in the color lookup table built from the stops of a color map.
+#define HEATMAP_COLOR_MAP_SIZE 256
+
+// Most job chunks used to rebuild vertex positions.
+#define HEATMAP_MAX_CHUNKS 64
+
+// Pixels beyond each edge of the screen whose cells are kept in the visible list.
+#define HEATMAP_MARGIN 32
+
+typedef struct Heatmap {
+    // Cells covered, in the cell indices of `Grid_Cell`.
+    // Cell (i, j) of the heatmap is grid cell (firstCell.x + i, firstCell.y + j).
+    Grid_Cell firstCell;
+    int numCellsX;
+    int numCellsY;
+    double cellWidth;
+
+    float *values; // Row by row, `numCellsX` per row.
+
+    // Value `minValue` maps to the first color, `maxValue` to the last.
+    Rgba colors[HEATMAP_COLOR_MAP_SIZE];
+    float minValue;
+    float maxValue;
+
+    // Cells changed since the last update. `isDirty` avoids duplicates.
+    uint32_t *dirtyCells;
+    size_t numDirty;
+    uint8_t *isDirty;
+    bool allDirty; // Recolor every cell, e.g. after the color map changed.
+
+    SDL_FPoint *positions;    // 4 per cell.
+    SDL_Color *vertexColors;  // 4 per cell.
+    int *indices;         // 6 per visible cell.
+    int numIndices;
+
+    // Visible cells of each row are [rowFirst[j], rowLast[j]]. None if first > last.
+    int *rowFirst;
+    int *rowLast;
+
+    // View the positions were computed for, and the view the visible cells were found for.
+    bool hasView;
+    Ortho_View view;
+    Ortho_View listView;
+
+    // Of the visible list: least depth of a visible cell, and whether any
+    // cell on or around the screen was left out for being behind the camera.
+    double minDepth;
+    bool depthCulled;
+
+    size_t chunkCounts[HEATMAP_MAX_CHUNKS]; // Indices written by each chunk of a rebuild.
+    double chunkMinDepth[HEATMAP_MAX_CHUNKS];
+    bool chunkDepthCulled[HEATMAP_MAX_CHUNKS];
+
+    uint64_t numRebuilt; // Views that needed the visible list rebuilt.
+    uint64_t numMoved;   // Views that only moved the listed cells.
+} Heatmap;
+
+// Initialize `heatmap` covering `numCellsX` by `numCellsY` cells from `firstCell`
+// with every value 0.0 and a grayscale color map over [0.0, 1.0].
+// If error, print to `stderr` and exit.
+void Heatmap_Init(Heatmap *const heatmap, const Grid *const grid,
+    const Grid_Cell firstCell, const int numCellsX, const int numCellsY);
+
+// Free the internals of `heatmap`.
+void Heatmap_Deinit(Heatmap *const heatmap);
+
+// Set the colors that values from `minValue` to `maxValue` map to.
+// `stops` are spread evenly over the range and blended between. `numStops` >= 1.
+void Heatmap_SetColorMap(Heatmap *const heatmap, const Rgba *const stops, const int numStops,
+    const float minValue, const float maxValue);
+
+// Set the value of heatmap cell (i, j) and mark it dirty.
+static inline void Heatmap_SetValue(Heatmap *const heatmap, const int i, const int j,
+    const float value)
+{
+    const uint32_t cell = (uint32_t)j * (uint32_t)heatmap->numCellsX + (uint32_t)i;
+    heatmap->values[cell] = value;
+
+    if (!heatmap->isDirty[cell]) {
+        heatmap->isDirty[cell] = 1;
+        heatmap->dirtyCells[heatmap->numDirty] = cell;
+        heatmap->numDirty += 1;
+    }
+}
+
+// Bring the vertex buffer up to date for `view`: positions, and the list of
+// visible cells unless `view` only pans or zooms within its margin, if the view
+// changed, then colors of dirty cells. Positions are written in parallel on `jobs`.
+void Heatmap_Update(Heatmap *const heatmap, const Ortho_View *const view, Jobs *const jobs);
+
+// Draw the visible cells with one call.
+void Heatmap_Draw(const Heatmap *const heatmap, SDL_Renderer *const renderer);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,367 @@
+#if defined(__unix__) || defined(__APPLE__)
+// For `sysconf`.
+#define _POSIX_C_SOURCE 200809L
+#include <unistd.h>
+#endif
+
+#include "Jobs.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "Mem.h"
+
+#define JOBS_EMPTY UINT64_MAX
+
+// Index of the calling thread in the job system. -1 if not a worker.
+static _Thread_local int workerIndex = -1;
+
+// Per-thread state for choosing steal victims.
+static _Thread_local uint32_t randomState = 1;
+
+typedef struct WorkerArg {
+    Jobs *jobs;
+    int index;
+} WorkerArg;
+
+static WorkerArg workerArgs[JOBS_MAX_WORKERS];
+
+static uint32_t NextRandom(void) {
+    // xorshift32
+    uint32_t x = randomState;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    randomState = x;
+
+    return x;
+}
+
+// Owner only. Return false if the deque is full.
+static bool Push(Jobs_Deque *const deque, const uint64_t entry) {
+    const int_fast64_t b = atomic_load_explicit(&deque->bottom, memory_order_relaxed);
+    const int_fast64_t t = atomic_load_explicit(&deque->top, memory_order_acquire);
+
+    if (b - t > JOBS_DEQUE_SIZE - 1) {
+        return false;
+    }
+
+    // Release publishes the entry and the batch it refers to to thieves.
+    atomic_store_explicit(&deque->entries[b & (JOBS_DEQUE_SIZE - 1)], entry, memory_order_relaxed);
+    atomic_store_explicit(&deque->bottom, b + 1, memory_order_release);
+
+    return true;
+}
+
+// Owner only. Return JOBS_EMPTY if there is nothing to take.
+static uint64_t Take(Jobs_Deque *const deque) {
+    const int_fast64_t b = atomic_load_explicit(&deque->bottom, memory_order_relaxed) - 1;
+    atomic_store_explicit(&deque->bottom, b, memory_order_relaxed);
+    atomic_thread_fence(memory_order_seq_cst);
+    int_fast64_t t = atomic_load_explicit(&deque->top, memory_order_relaxed);
+
+    if (t > b) {
+        atomic_store_explicit(&deque->bottom, b + 1, memory_order_release);
+        return JOBS_EMPTY;
+    }
+
+    uint64_t entry = atomic_load_explicit(&deque->entries[b & (JOBS_DEQUE_SIZE - 1)], memory_order_relaxed);
+
+    if (t == b) {
+        // Last entry. Race thieves for it.
+        if (!atomic_compare_exchange_strong_explicit(&deque->top, &t, t + 1,
+            memory_order_seq_cst, memory_order_relaxed))
+        {
+            entry = JOBS_EMPTY;
+        }
+
+        atomic_store_explicit(&deque->bottom, b + 1, memory_order_release);
+    }
+
+    return entry;
+}
+
+// Any thread. Return JOBS_EMPTY if there is nothing to steal or another thief won.
+static uint64_t Steal(Jobs_Deque *const deque) {
+    int_fast64_t t = atomic_load_explicit(&deque->top, memory_order_acquire);
+    atomic_thread_fence(memory_order_seq_cst);
+    const int_fast64_t b = atomic_load_explicit(&deque->bottom, memory_order_acquire);
+
+    if (t >= b) {
+        return JOBS_EMPTY;
+    }
+
+    const uint64_t entry = atomic_load_explicit(&deque->entries[t & (JOBS_DEQUE_SIZE - 1)], memory_order_relaxed);
+
+    if (!atomic_compare_exchange_strong_explicit(&deque->top, &t, t + 1,
+        memory_order_seq_cst, memory_order_relaxed))
+    {
+        return JOBS_EMPTY;
+    }
+
+    return entry;
+}
+
+static void RunEntry(Jobs *const jobs, const uint64_t entry) {
+    Jobs_Batch *const batch = &jobs->batches[entry >> 32];
+    const size_t chunk = (size_t)(entry & 0xffffffffu);
+
+    const size_t begin = chunk * batch->chunkSize;
+    const size_t end = (begin + batch->chunkSize < batch->n) ? begin + batch->chunkSize : batch->n;
+
+    batch->fn(batch->ctx, chunk, begin, end);
+
+    // The batch slot may be reused as soon as its count reaches zero.
+    Jobs_Counter *const counter = batch->counter;
+    atomic_fetch_sub_explicit(&batch->pending, 1, memory_order_release);
+    atomic_fetch_sub_explicit(&counter->pending, 1, memory_order_release);
+}
+
+// Run one task from the own deque or stolen from another. Return false if none was found.
+static bool TryRunOne(Jobs *const jobs, const int index) {
+    uint64_t entry = Take(&jobs->deques[index]);
+
+    if (entry == JOBS_EMPTY && jobs->numWorkers > 1) {
+        const int first = (int)(NextRandom() % (uint32_t)jobs->numWorkers);
+
+        for (int k = 0; k < jobs->numWorkers && entry == JOBS_EMPTY; k += 1) {
+            const int victim = (first + k) % jobs->numWorkers;
+
+            if (victim != index) {
+                entry = Steal(&jobs->deques[victim]);
+            }
+        }
+    }
+
+    if (entry == JOBS_EMPTY) {
+        return false;
+    }
+
+    atomic_fetch_sub_explicit(&jobs->numQueued, 1, memory_order_relaxed);
+    RunEntry(jobs, entry);
+
+    return true;
+}
+
+static int Worker(void *arg) {
+    const WorkerArg *const workerArg = arg;
+    Jobs *const jobs = workerArg->jobs;
+
+    workerIndex = workerArg->index;
+    randomState = 2654435761u * (uint32_t)(workerIndex + 1);
+
+    int idleRounds = 0;
+    unsigned generation = 0;
+
+    while (!atomic_load_explicit(&jobs->quit, memory_order_acquire)) {
+        const unsigned latest = atomic_load_explicit(&jobs->workerGeneration, memory_order_acquire);
+
+        if (latest != generation) {
+            generation = latest;
+            jobs->workerFn(jobs->workerCtx, workerIndex);
+            atomic_fetch_sub_explicit(&jobs->workersPending, 1, memory_order_release);
+        }
+
+        if (TryRunOne(jobs, workerIndex)) {
+            idleRounds = 0;
+            continue;
+        }
+
+        // Stay awake briefly since more work usually follows within the frame.
+        if (idleRounds < 256) {
+            idleRounds += 1;
+            thrd_yield();
+            continue;
+        }
+
+        // Announce sleeping before checking for work so a pusher either
+        // sees us sleeping or we see its work.
+        atomic_fetch_add(&jobs->numSleeping, 1);
+        mtx_lock(&jobs->sleepMutex);
+
+        while (atomic_load(&jobs->numQueued) == 0
+            && atomic_load(&jobs->workerGeneration) == generation
+            && !atomic_load_explicit(&jobs->quit, memory_order_acquire))
+        {
+            cnd_wait(&jobs->sleepCond, &jobs->sleepMutex);
+        }
+
+        mtx_unlock(&jobs->sleepMutex);
+        atomic_fetch_sub(&jobs->numSleeping, 1);
+
+        idleRounds = 0;
+    }
+
+    return 0;
+}
+
+int Jobs_NumCpus(void) {
+#if defined(_SC_NPROCESSORS_ONLN)
+    const long n = sysconf(_SC_NPROCESSORS_ONLN);
+
+    if (n > 0) {
+        return (n > JOBS_MAX_WORKERS) ? JOBS_MAX_WORKERS : (int)n;
+    }
+#endif
+
+    return 1;
+}
+
+void Jobs_Init(Jobs *const jobs, int numWorkers) {
+    if (numWorkers < 1) { numWorkers = 1; }
+    if (numWorkers > JOBS_MAX_WORKERS) { numWorkers = JOBS_MAX_WORKERS; }
+
+    jobs->numWorkers = numWorkers;
+    // Deques are cache line aligned so owners and thieves of different deques do not share lines.
+    jobs->deques = Mem_AllocAligned((size_t)numWorkers * sizeof(Jobs_Deque),
+        _Alignof(Jobs_Deque), MEM_TAG_JOBS);
+
+    atomic_init(&jobs->nextBatch, 0);
+
+    for (int i = 0; i < numWorkers; i += 1) {
+        atomic_init(&jobs->deques[i].top, 0);
+        atomic_init(&jobs->deques[i].bottom, 0);
+    }
+
+    for (int i = 0; i < JOBS_MAX_BATCHES; i += 1) {
+        atomic_init(&jobs->batches[i].pending, 0);
+    }
+
+    atomic_init(&jobs->numQueued, 0);
+    atomic_init(&jobs->numSleeping, 0);
+    atomic_init(&jobs->quit, false);
+    atomic_init(&jobs->workerGeneration, 0);
+    atomic_init(&jobs->workersPending, 0);
+
+    if (mtx_init(&jobs->sleepMutex, mtx_plain) != thrd_success
+        || cnd_init(&jobs->sleepCond) != thrd_success)
+    {
+        fprintf(stderr, "%s: Failed to create mutex or condition variable\n", __func__);
+        exit(1);
+    }
+
+    workerIndex = 0;
+
+    for (int i = 1; i < numWorkers; i += 1) {
+        workerArgs[i] = (WorkerArg) {jobs, i};
+
+        if (thrd_create(&jobs->threads[i], Worker, &workerArgs[i]) != thrd_success) {
+            fprintf(stderr, "%s: Failed to create worker thread %d\n", __func__, i);
+            exit(1);
+        }
+    }
+}
+
+void Jobs_Deinit(Jobs *const jobs) {
+    atomic_store_explicit(&jobs->quit, true, memory_order_release);
+
+    mtx_lock(&jobs->sleepMutex);
+    cnd_broadcast(&jobs->sleepCond);
+    mtx_unlock(&jobs->sleepMutex);
+
+    for (int i = 1; i < jobs->numWorkers; i += 1) {
+        thrd_join(jobs->threads[i], NULL);
+    }
+
+    cnd_destroy(&jobs->sleepCond);
+    mtx_destroy(&jobs->sleepMutex);
+    Mem_Free(jobs->deques);
+}
+
+int Jobs_WorkerIndex(void) {
+    return workerIndex;
+}
+
+void Jobs_RunOnEachWorker(Jobs *const jobs, const Jobs_WorkerFn fn, void *const ctx) {
+    jobs->workerFn = fn;
+    jobs->workerCtx = ctx;
+    atomic_store_explicit(&jobs->workersPending, jobs->numWorkers - 1, memory_order_relaxed);
+
+    // Bumped under the mutex so sleeping workers either see it or are woken.
+    mtx_lock(&jobs->sleepMutex);
+    atomic_fetch_add_explicit(&jobs->workerGeneration, 1, memory_order_release);
+    cnd_broadcast(&jobs->sleepCond);
+    mtx_unlock(&jobs->sleepMutex);
+
+    fn(ctx, 0);
+
+    while (atomic_load_explicit(&jobs->workersPending, memory_order_acquire) != 0) {
+        thrd_yield();
+    }
+}
+
+void Jobs_InitCounter(Jobs_Counter *const counter) {
+    atomic_init(&counter->pending, 0);
+}
+
+// Find a free batch slot and mark it `JOBS_CLAIMED`, helping with other work
+// while all are busy. Tasks on several workers may claim slots at once.
+static size_t ClaimBatch(Jobs *const jobs) {
+    while (true) {
+        const size_t start = atomic_load_explicit(&jobs->nextBatch, memory_order_relaxed);
+
+        for (size_t k = 0; k < JOBS_MAX_BATCHES; k += 1) {
+            const size_t i = (start + k) % JOBS_MAX_BATCHES;
+            size_t expected = 0;
+
+            if (atomic_compare_exchange_strong_explicit(&jobs->batches[i].pending, &expected,
+                JOBS_CLAIMED, memory_order_acquire, memory_order_relaxed))
+            {
+                atomic_store_explicit(&jobs->nextBatch, (i + 1) % JOBS_MAX_BATCHES, memory_order_relaxed);
+                return i;
+            }
+        }
+
+        if (!TryRunOne(jobs, workerIndex)) {
+            thrd_yield();
+        }
+    }
+}
+
+void Jobs_ParallelFor(Jobs *const jobs, Jobs_Counter *const counter,
+    const size_t n, const size_t chunkSize, const Jobs_Fn fn, void *const ctx)
+{
+    if (n == 0) {
+        return;
+    }
+
+    const size_t numChunks = Jobs_NumChunks(n, chunkSize);
+    const size_t b = ClaimBatch(jobs);
+    Jobs_Batch *const batch = &jobs->batches[b];
+
+    batch->fn = fn;
+    batch->ctx = ctx;
+    batch->n = n;
+    batch->chunkSize = chunkSize;
+    batch->counter = counter;
+    atomic_store_explicit(&batch->pending, numChunks, memory_order_relaxed);
+    atomic_fetch_add_explicit(&counter->pending, numChunks, memory_order_relaxed);
+
+    Jobs_Deque *const deque = &jobs->deques[workerIndex];
+
+    // Push in reverse so the owner takes chunks in index order.
+    for (size_t k = numChunks; k > 0; k -= 1) {
+        const uint64_t entry = ((uint64_t)b << 32) | (uint64_t)(k - 1);
+
+        if (Push(deque, entry)) {
+            atomic_fetch_add(&jobs->numQueued, 1);
+        }
+        else {
+            RunEntry(jobs, entry);
+        }
+    }
+
+    if (atomic_load(&jobs->numSleeping) > 0) {
+        mtx_lock(&jobs->sleepMutex);
+        cnd_broadcast(&jobs->sleepCond);
+        mtx_unlock(&jobs->sleepMutex);
+    }
+}
+
+void Jobs_Wait(Jobs *const jobs, Jobs_Counter *const counter) {
+    while (atomic_load_explicit(&counter->pending, memory_order_acquire) != 0) {
+        if (!TryRunOne(jobs, workerIndex)) {
+            thrd_yield();
+        }
+    }
+}
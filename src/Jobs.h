@@ -0,0 +1,132 @@
+#ifndef JOBS_H
+#define JOBS_H
+
+// Small work-stealing job system.
+//
+// Each worker thread owns a deque of tasks. It takes its own tasks from the
+// bottom and, when out of work, steals from the top of another worker's deque
+// (Chase-Lev). The thread that calls `Jobs_Init` is worker 0 and helps run
+// tasks while it waits, so one worker means everything runs on the caller.
+//
+// Work is submitted as a parallel-for over an index range, split into chunks.
+// A `Jobs_Counter` counts unfinished chunks of any number of parallel-fors,
+// typically everything submitted in one frame, and `Jobs_Wait` waits on it.
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <threads.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Most threads, including the caller of `Jobs_Init`.
+#define JOBS_MAX_WORKERS 64
+
+// Tasks each worker's deque holds. Power of two.
+// Pushing to a full deque runs the task right away instead.
+#define JOBS_DEQUE_SIZE 4096
+
+// Parallel-fors that can be in flight at once.
+#define JOBS_MAX_BATCHES 64
+
+// `Jobs_Batch.pending` of a slot claimed by a worker that is still filling it in.
+#define JOBS_CLAIMED SIZE_MAX
+
+// Run indices [begin, end) of chunk `chunk`. `ctx` is what was given to `Jobs_ParallelFor`.
+typedef void (*Jobs_Fn)(void *ctx, size_t chunk, size_t begin, size_t end);
+
+// Called once on each worker thread by `Jobs_RunOnEachWorker`.
+typedef void (*Jobs_WorkerFn)(void *ctx, int worker);
+
+typedef struct Jobs_Counter {
+    atomic_size_t pending; // Chunks not finished yet.
+} Jobs_Counter;
+
+// One parallel-for.
+typedef struct Jobs_Batch {
+    Jobs_Fn fn;
+    void *ctx;
+    size_t n;
+    size_t chunkSize;
+    Jobs_Counter *counter;
+    // Chunks of this batch not finished yet. 0 means the slot is free,
+    // `JOBS_CLAIMED` that it is being filled in.
+    atomic_size_t pending;
+} Jobs_Batch;
+
+typedef struct Jobs_Deque {
+    // Only the owner moves `bottom`. Thieves move `top`.
+    _Alignas(64) atomic_int_fast64_t top;
+    _Alignas(64) atomic_int_fast64_t bottom;
+    // Each entry packs a batch index and a chunk index.
+    atomic_uint_fast64_t entries[JOBS_DEQUE_SIZE];
+} Jobs_Deque;
+
+typedef struct Jobs {
+    int numWorkers;
+    thrd_t threads[JOBS_MAX_WORKERS];
+    Jobs_Deque *deques; // One per worker.
+
+    Jobs_Batch batches[JOBS_MAX_BATCHES];
+    atomic_size_t nextBatch; // Where to start looking for a free slot. Only a hint.
+
+    // Idle workers sleep until tasks are queued.
+    atomic_size_t numQueued;
+    atomic_int numSleeping;
+    mtx_t sleepMutex;
+    cnd_t sleepCond;
+    atomic_bool quit;
+
+    // Set by `Jobs_RunOnEachWorker`. Workers run `workerFn` when `workerGeneration` changes.
+    Jobs_WorkerFn workerFn;
+    void *workerCtx;
+    atomic_uint workerGeneration;
+    atomic_int workersPending;
+} Jobs;
+
+// Return the number of online CPUs, at least 1.
+int Jobs_NumCpus(void);
+
+// Start `numWorkers - 1` threads. The caller is worker 0.
+// Only one job system may be running at a time.
+// `numWorkers` is clamped to [1, JOBS_MAX_WORKERS].
+// If error, print to `stderr` and exit.
+void Jobs_Init(Jobs *const jobs, int numWorkers);
+
+// Stop and join the threads. No work may be pending.
+void Jobs_Deinit(Jobs *const jobs);
+
+// Return the index of the calling worker in [0, numWorkers), or -1 if not a worker.
+// Tasks can use it to pick per-worker scratch memory.
+int Jobs_WorkerIndex(void);
+
+// Run `fn` once on every worker thread, the caller being worker 0, and wait
+// for all of them. For per-thread setup such as thread-local counters.
+// Must be called by worker 0 with no work pending.
+void Jobs_RunOnEachWorker(Jobs *const jobs, const Jobs_WorkerFn fn, void *const ctx);
+
+// Initialize `counter` with nothing pending.
+void Jobs_InitCounter(Jobs_Counter *const counter);
+
+// Queue `fn` over [0, n) in chunks of `chunkSize` on the calling worker's deque
+// and add the chunks to `counter`. Must be called by worker 0 or from inside a task.
+// Does not wait. Chunk k covers [k * chunkSize, min((k + 1) * chunkSize, n)).
+void Jobs_ParallelFor(Jobs *const jobs, Jobs_Counter *const counter,
+    const size_t n, const size_t chunkSize, const Jobs_Fn fn, void *const ctx);
+
+// Run tasks until everything added to `counter` is finished.
+void Jobs_Wait(Jobs *const jobs, Jobs_Counter *const counter);
+
+// Return the number of chunks `Jobs_ParallelFor` makes.
+static inline size_t Jobs_NumChunks(const size_t n, const size_t chunkSize) {
+    return (n + chunkSize - 1) / chunkSize;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,169 @@
+#include "Labels.h"
+
+#include <math.h>
+#include <stdio.h>
+
+#include "Mem.h"
+#include "Sdlu.h"
+
+// Glyphs of the font: digits then minus.
+#define LABELS_NUM_GLYPHS 11
+#define LABELS_MINUS 10
+
+// Rows from the top. Bit 4 is the leftmost column.
+static const uint8_t fontRows[LABELS_NUM_GLYPHS][7] = {
+    {0x0E, 0x11, 0x13, 0x15, 0x19, 0x11, 0x0E}, // 0
+    {0x04, 0x0C, 0x04, 0x04, 0x04, 0x04, 0x0E}, // 1
+    {0x0E, 0x11, 0x01, 0x02, 0x04, 0x08, 0x1F}, // 2
+    {0x1F, 0x02, 0x04, 0x02, 0x01, 0x11, 0x0E}, // 3
+    {0x02, 0x06, 0x0A, 0x12, 0x1F, 0x02, 0x02}, // 4
+    {0x1F, 0x10, 0x1E, 0x01, 0x01, 0x11, 0x0E}, // 5
+    {0x06, 0x08, 0x10, 0x1E, 0x11, 0x11, 0x0E}, // 6
+    {0x1F, 0x01, 0x02, 0x04, 0x08, 0x08, 0x08}, // 7
+    {0x0E, 0x11, 0x11, 0x0E, 0x11, 0x11, 0x0E}, // 8
+    {0x0E, 0x11, 0x11, 0x0F, 0x01, 0x02, 0x0C}, // 9
+    {0x00, 0x00, 0x00, 0x1F, 0x00, 0x00, 0x00}  // -
+};
+
+// Each glyph has a cell in the atlas with a transparent border of 1 pixel,
+// so filtering never picks up a neighbor.
+#define LABELS_CELL_WIDTH 7
+#define LABELS_CELL_HEIGHT 9
+#define LABELS_ATLAS_WIDTH (LABELS_NUM_GLYPHS * LABELS_CELL_WIDTH)
+
+#define LABELS_MAX_GLYPHS (LABELS_MAX_LABELS * LABELS_MAX_CHARS)
+
+void Labels_Init(Labels *const labels, SDL_Renderer *const renderer) {
+    *labels = (Labels) {
+        .vertices = Mem_AllocTagged(LABELS_MAX_GLYPHS * 4 * sizeof(SDL_Vertex), MEM_TAG_LABELS),
+        .indices = Mem_AllocTagged(LABELS_MAX_GLYPHS * 6 * sizeof(int), MEM_TAG_LABELS)
+    };
+
+    // White glyphs on transparent white. Vertex colors tint them.
+    static uint32_t pixels[LABELS_CELL_HEIGHT][LABELS_ATLAS_WIDTH];
+
+    for (int row = 0; row < LABELS_CELL_HEIGHT; row += 1) {
+        for (int col = 0; col < LABELS_ATLAS_WIDTH; col += 1) {
+            pixels[row][col] = 0x00FFFFFFu;
+        }
+    }
+
+    for (int g = 0; g < LABELS_NUM_GLYPHS; g += 1) {
+        for (int row = 0; row < 7; row += 1) {
+            for (int col = 0; col < 5; col += 1) {
+                const bool on = (fontRows[g][row] >> (4 - col)) & 1;
+                if (on) {
+                    pixels[row + 1][g * LABELS_CELL_WIDTH + col + 1] = 0xFFFFFFFFu;
+                }
+            }
+        }
+    }
+
+    labels->atlas = Sdlu_CreateTexture(renderer, SDL_PIXELFORMAT_ARGB8888,
+        SDL_TEXTUREACCESS_STATIC, LABELS_ATLAS_WIDTH, LABELS_CELL_HEIGHT);
+    Sdlu_SetTextureBlendMode(labels->atlas, SDL_BLENDMODE_BLEND);
+    Sdlu_UpdateTexture(labels->atlas, NULL, pixels, LABELS_ATLAS_WIDTH * (int)sizeof(uint32_t));
+
+    // Two triangles per glyph quad.
+    for (int q = 0; q < LABELS_MAX_GLYPHS; q += 1) {
+        int *const index = labels->indices + 6 * q;
+        index[0] = 4 * q;
+        index[1] = 4 * q + 1;
+        index[2] = 4 * q + 2;
+        index[3] = 4 * q;
+        index[4] = 4 * q + 2;
+        index[5] = 4 * q + 3;
+    }
+}
+
+void Labels_Deinit(Labels *const labels) {
+    SDL_DestroyTexture(labels->atlas);
+    Mem_Free(labels->vertices);
+    Mem_Free(labels->indices);
+    *labels = (Labels) { 0 };
+}
+
+void Labels_Clear(Labels *const labels) {
+    labels->numGlyphs = 0;
+    labels->numLabels = 0;
+}
+
+// Return the glyphs of `value`, formatting them if not cached.
+static const Labels_CacheEntry *GetGlyphs(Labels *const labels, const int value) {
+    Labels_CacheEntry *const entry = &labels->cache[(unsigned)value & (LABELS_CACHE_SIZE - 1)];
+
+    if (entry->valid && entry->value == value) {
+        labels->numCacheHits += 1;
+        return entry;
+    }
+
+    labels->numCacheMisses += 1;
+
+    char text[LABELS_MAX_CHARS + 1];
+    const int length = snprintf(text, sizeof(text), "%d", value);
+
+    entry->value = value;
+    entry->valid = true;
+    entry->numGlyphs = (uint8_t)length;
+
+    for (int i = 0; i < length; i += 1) {
+        entry->glyphs[i] = (text[i] == '-') ? LABELS_MINUS : (uint8_t)(text[i] - '0');
+    }
+
+    return entry;
+}
+
+int Labels_Width(Labels *const labels, const int value) {
+    const Labels_CacheEntry *const entry = GetGlyphs(labels, value);
+    return entry->numGlyphs * LABELS_ADVANCE - (LABELS_ADVANCE - LABELS_GLYPH_WIDTH);
+}
+
+bool Labels_Add(Labels *const labels, const int value, const float x, const float y,
+    const Rgba color)
+{
+    if (labels->numLabels >= LABELS_MAX_LABELS) {
+        return false;
+    }
+
+    const Labels_CacheEntry *const entry = GetGlyphs(labels, value);
+    const float width = (float)(entry->numGlyphs * LABELS_ADVANCE - (LABELS_ADVANCE - LABELS_GLYPH_WIDTH));
+
+    // Whole pixels so glyphs stay sharp.
+    const float left = floorf(x - width / 2.0f);
+    const float top = floorf(y - LABELS_GLYPH_HEIGHT / 2.0f);
+    const SDL_Color vertexColor = {color.r, color.g, color.b, color.a};
+
+    const float v1 = 1.0f / LABELS_CELL_HEIGHT;
+    const float v2 = 8.0f / LABELS_CELL_HEIGHT;
+
+    for (int i = 0; i < entry->numGlyphs; i += 1) {
+        const float x1 = left + (float)(i * LABELS_ADVANCE);
+        const float x2 = x1 + LABELS_GLYPH_WIDTH;
+        const float y2 = top + LABELS_GLYPH_HEIGHT;
+
+        const int cell = entry->glyphs[i] * LABELS_CELL_WIDTH;
+        const float u1 = (float)(cell + 1) / LABELS_ATLAS_WIDTH;
+        const float u2 = (float)(cell + 6) / LABELS_ATLAS_WIDTH;
+
+        SDL_Vertex *const vertex = labels->vertices + 4 * labels->numGlyphs;
+        vertex[0] = (SDL_Vertex) {{x1, top}, vertexColor, {u1, v1}};
+        vertex[1] = (SDL_Vertex) {{x2, top}, vertexColor, {u2, v1}};
+        vertex[2] = (SDL_Vertex) {{x2, y2}, vertexColor, {u2, v2}};
+        vertex[3] = (SDL_Vertex) {{x1, y2}, vertexColor, {u1, v2}};
+
+        labels->numGlyphs += 1;
+    }
+
+    labels->numLabels += 1;
+
+    return true;
+}
+
+void Labels_Draw(const Labels *const labels, SDL_Renderer *const renderer) {
+    if (labels->numGlyphs == 0) {
+        return;
+    }
+
+    Sdlu_RenderGeometry(renderer, labels->atlas,
+        labels->vertices, 4 * labels->numGlyphs, labels->indices, 6 * labels->numGlyphs);
+}
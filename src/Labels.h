@@ -0,0 +1,85 @@
+#ifndef LABELS_H
+#define LABELS_H
+
+// Integer labels drawn as text, e.g. coordinates along grid lines.
+//
+// Glyphs of a small built-in bitmap font are rasterized once into an atlas
+// texture. The glyphs of each value's string are cached, so a label that was
+// shown before costs no formatting. Labels added during a frame become quads
+// in a fixed-size vertex buffer and are drawn with one `SDL_RenderGeometry`
+// call. At most `LABELS_MAX_LABELS` are drawn per frame, which bounds the cost.
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include <SDL2/SDL.h>
+
+#include "Rgba.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Most labels drawn per frame. Further labels are dropped.
+#define LABELS_MAX_LABELS 256
+
+// Most characters of a label. Enough for any `int`.
+#define LABELS_MAX_CHARS 11
+
+// Entries of the per-value cache of glyph strings. A power of 2.
+#define LABELS_CACHE_SIZE 1024
+
+// Screen pixels per font pixel.
+#define LABELS_SCALE 2
+
+// Size of a glyph on screen. The font is 5x7 with one column between glyphs.
+#define LABELS_GLYPH_WIDTH (5 * LABELS_SCALE)
+#define LABELS_GLYPH_HEIGHT (7 * LABELS_SCALE)
+#define LABELS_ADVANCE (6 * LABELS_SCALE)
+
+typedef struct Labels_CacheEntry {
+    int value;
+    bool valid;
+    uint8_t numGlyphs;
+    uint8_t glyphs[LABELS_MAX_CHARS]; // Index of each glyph in the atlas.
+} Labels_CacheEntry;
+
+typedef struct Labels {
+    SDL_Texture *atlas;
+
+    Labels_CacheEntry cache[LABELS_CACHE_SIZE]; // Indexed by value modulo the size.
+    uint64_t numCacheHits;
+    uint64_t numCacheMisses;
+
+    SDL_Vertex *vertices; // 4 per glyph of the labels added this frame.
+    int *indices;         // 6 per glyph. Written once, the same every frame.
+    int numGlyphs;
+    int numLabels;
+} Labels;
+
+// Initialize `labels` and create the atlas on `renderer`.
+// If error, print to `stderr` and exit.
+void Labels_Init(Labels *const labels, SDL_Renderer *const renderer);
+
+// Free the internals of `labels`.
+void Labels_Deinit(Labels *const labels);
+
+// Remove the labels added since the last clear.
+void Labels_Clear(Labels *const labels);
+
+// Return the width in screen pixels of the label of `value`.
+int Labels_Width(Labels *const labels, const int value);
+
+// Add a label showing `value` centered on pixel (x, y), in `color`.
+// Return false, adding nothing, if `LABELS_MAX_LABELS` were already added.
+bool Labels_Add(Labels *const labels, const int value, const float x, const float y,
+    const Rgba color);
+
+// Draw the labels added since the last clear with one call.
+void Labels_Draw(const Labels *const labels, SDL_Renderer *const renderer);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
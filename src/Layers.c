@@ -0,0 +1,213 @@
+#include "Layers.h"
+
+#include <math.h>
+
+#include "Mem.h"
+#include "Sdlu.h"
+
+void Layers_Init(Layers *const layers) {
+    *layers = (Layers) { 0 };
+}
+
+void Layers_Deinit(Layers *const layers) {
+    Mem_Free(layers->layers);
+    Mem_Free(layers->runLayers);
+    Mem_Free(layers->vertices);
+    Mem_Free(layers->indices);
+    *layers = (Layers) { 0 };
+}
+
+// Make room for `numSegs` segments, writing the index pattern of any new quads.
+static void ReserveSegs(Layers *const layers, const size_t numSegs) {
+    if (numSegs <= layers->segsCap) {
+        return;
+    }
+
+    const size_t cap = (numSegs > layers->segsCap * 2) ? numSegs : layers->segsCap * 2;
+
+    layers->vertices = Mem_ReallocTagged(layers->vertices, cap * 4 * sizeof(SDL_Vertex), MEM_TAG_LINES);
+    layers->indices = Mem_ReallocTagged(layers->indices, cap * 6 * sizeof(int), MEM_TAG_LINES);
+
+    // Two triangles per quad. Indices are relative to the first vertex of
+    // a layer, so every layer draws with the start of the same buffer.
+    for (size_t i = layers->segsCap; i < cap; i += 1) {
+        const int v = (int)(4 * i);
+        int *const q = &layers->indices[6 * i];
+        q[0] = v;
+        q[1] = v + 1;
+        q[2] = v + 2;
+        q[3] = v + 2;
+        q[4] = v + 1;
+        q[5] = v + 3;
+    }
+
+    layers->segsCap = cap;
+}
+
+// Make room for `numRuns` runs.
+static void ReserveRuns(Layers *const layers, const size_t numRuns) {
+    if (numRuns > layers->runLayersCap) {
+        layers->runLayers = Mem_ReallocTagged(layers->runLayers,
+            numRuns * sizeof(size_t), MEM_TAG_LINES);
+        layers->runLayersCap = numRuns;
+    }
+}
+
+void Layers_Reserve(Layers *const layers, const size_t numSegs, const size_t numRuns) {
+    ReserveSegs(layers, numSegs);
+    ReserveRuns(layers, numRuns);
+
+    if (layers->layersCap < LAYERS_RESERVED_COLORS) {
+        layers->layersCap = LAYERS_RESERVED_COLORS;
+        layers->layers = Mem_ReallocTagged(layers->layers,
+            layers->layersCap * sizeof(Layers_Layer), MEM_TAG_LINES);
+    }
+}
+
+// Return the index of the layer of `color`, adding it if new.
+static size_t FindLayer(Layers *const layers, const Rgba color) {
+    for (size_t i = 0; i < layers->numLayers; i += 1) {
+        if (Rgba_Equal(layers->layers[i].color, color)) {
+            return i;
+        }
+    }
+
+    if (layers->numLayers == layers->layersCap) {
+        layers->layersCap = layers->layersCap * 2 + 8;
+        layers->layers = Mem_ReallocTagged(layers->layers,
+            layers->layersCap * sizeof(Layers_Layer), MEM_TAG_LINES);
+    }
+
+    layers->layers[layers->numLayers] = (Layers_Layer) { .color = color };
+    layers->numLayers += 1;
+
+    return layers->numLayers - 1;
+}
+
+// Write the quad covering the pixels of `seg` as `SDL_RenderDrawLine` would, 1 pixel wide.
+static inline void WriteQuad(SDL_Vertex *const v, const Lines_Seg seg, const SDL_Color color) {
+    // Pixel centers are at half coordinates for geometry.
+    const float x1 = seg.x1 + 0.5f;
+    const float y1 = seg.y1 + 0.5f;
+    const float x2 = seg.x2 + 0.5f;
+    const float y2 = seg.y2 + 0.5f;
+
+    const float dx = x2 - x1;
+    const float dy = y2 - y1;
+    const float length = sqrtf(dx * dx + dy * dy);
+
+    // Half a pixel along the segment (a) and across it (n).
+    float ax = 0.5f;
+    float ay = 0.0f;
+
+    if (length > 1e-6f) {
+        ax = 0.5f * dx / length;
+        ay = 0.5f * dy / length;
+    }
+
+    const float nx = -ay;
+    const float ny = ax;
+
+    // Extended by half a pixel at each end to cover the endpoints.
+    v[0] = (SDL_Vertex) { {x1 - ax + nx, y1 - ay + ny}, color, {0.0f, 0.0f} };
+    v[1] = (SDL_Vertex) { {x1 - ax - nx, y1 - ay - ny}, color, {0.0f, 0.0f} };
+    v[2] = (SDL_Vertex) { {x2 + ax + nx, y2 + ay + ny}, color, {0.0f, 0.0f} };
+    v[3] = (SDL_Vertex) { {x2 + ax - nx, y2 + ay - ny}, color, {0.0f, 0.0f} };
+}
+
+void Layers_Build(Layers *const layers, const Lines *const lines) {
+    layers->numLayers = 0;
+
+    ReserveRuns(layers, lines->numRuns);
+    ReserveSegs(layers, lines->numSegs);
+
+    // Count the segments of each layer. Runs often alternate between a few
+    // colors, so check the previous run's layer first.
+    size_t numRuns = 0;
+    size_t last = SIZE_MAX;
+
+    for (size_t r = 0; r < lines->numRuns; r += 1) {
+        const Lines_Run *const run = &lines->runs[r];
+
+        if (run->count == 0) {
+            continue;
+        }
+
+        numRuns += 1;
+
+        if (last == SIZE_MAX || !Rgba_Equal(layers->layers[last].color, run->color)) {
+            last = FindLayer(layers, run->color);
+        }
+
+        layers->runLayers[r] = last;
+        layers->layers[last].count += run->count;
+    }
+
+    size_t start = 0;
+
+    for (size_t i = 0; i < layers->numLayers; i += 1) {
+        layers->layers[i].start = start;
+        start += layers->layers[i].count;
+    }
+
+    // Write each run's quads after those already in its layer.
+    for (size_t r = 0; r < lines->numRuns; r += 1) {
+        const Lines_Run *const run = &lines->runs[r];
+
+        if (run->count == 0) {
+            continue;
+        }
+
+        Layers_Layer *const layer = &layers->layers[layers->runLayers[r]];
+        const SDL_Color color = {run->color.r, run->color.g, run->color.b, run->color.a};
+        SDL_Vertex *const v = &layers->vertices[4 * (layer->start + layer->filled)];
+
+        for (size_t i = 0; i < run->count; i += 1) {
+            WriteQuad(&v[4 * i], lines->segs[run->start + i], color);
+        }
+
+        layer->filled += run->count;
+    }
+
+    layers->frame = (Layers_FrameStats) {
+        .numSegs = lines->numSegs,
+        .numRuns = numRuns,
+        .numStateChanges = layers->numLayers
+    };
+
+    layers->numFrames += 1;
+    layers->totalRuns += numRuns;
+    layers->totalStateChanges += layers->numLayers;
+
+    if (numRuns > layers->maxRuns) {
+        layers->maxRuns = numRuns;
+    }
+
+    if (layers->numLayers > layers->maxStateChanges) {
+        layers->maxStateChanges = layers->numLayers;
+    }
+}
+
+void Layers_Draw(const Layers *const layers, SDL_Renderer *const renderer) {
+    for (size_t i = 0; i < layers->numLayers; i += 1) {
+        const Layers_Layer *const layer = &layers->layers[i];
+
+        Sdlu_RenderGeometry(renderer, NULL,
+            &layers->vertices[4 * layer->start], (int)(4 * layer->count),
+            layers->indices, (int)(6 * layer->count));
+    }
+}
+
+void Layers_PrintSummary(const Layers *const layers, FILE *const file) {
+    if (layers->numFrames == 0) {
+        return;
+    }
+
+    const double numFrames = (double)layers->numFrames;
+
+    fprintf(file, "Line layers over %llu frames: %.1f state changes per frame on average (max %zu) "
+        "instead of %.1f color runs (max %zu).\n",
+        (unsigned long long)layers->numFrames,
+        (double)layers->totalStateChanges / numFrames, layers->maxStateChanges,
+        (double)layers->totalRuns / numFrames, layers->maxRuns);
+}
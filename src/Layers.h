@@ -0,0 +1,91 @@
+#ifndef LAYERS_H
+#define LAYERS_H
+
+// Line segments drawn in one batch per style instead of one call per segment.
+//
+// The runs of a frame's `Lines` are bucketed by color, each bucket being a
+// style layer. Every segment becomes a thin quad in one vertex buffer, laid
+// out layer by layer, and each layer is drawn with one `SDL_RenderGeometry`
+// call. Vertices carry the color, so switching layers is the only change of
+// state. However many runs the frame has, e.g. alternating tile colors, the
+// state changes per frame are bounded by the number of distinct colors.
+//
+// Layers are drawn in the order their color first appears, so later overlays
+// such as the hover outline stay on top.
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include <SDL2/SDL.h>
+
+#include "Lines.h"
+#include "Rgba.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Colors `Layers_Reserve` makes room for. More allocate while building.
+#define LAYERS_RESERVED_COLORS 16
+
+typedef struct Layers_Layer {
+    Rgba color;
+    size_t start; // Index of first segment in the vertex buffer.
+    size_t count;
+    size_t filled; // Segments written while building.
+} Layers_Layer;
+
+// Counts for one frame.
+typedef struct Layers_FrameStats {
+    size_t numSegs;
+    size_t numRuns;         // Color changes drawing run by run would have made.
+    size_t numStateChanges; // Layers drawn, each one call.
+} Layers_FrameStats;
+
+typedef struct Layers {
+    Layers_Layer *layers;
+    size_t numLayers;
+    size_t layersCap;
+
+    size_t *runLayers; // Layer of each run of the frame.
+    size_t runLayersCap;
+
+    SDL_Vertex *vertices; // 4 per segment, grouped by layer.
+    int *indices;         // 6 per segment. The same every frame, so only written on growth.
+    size_t segsCap;
+
+    Layers_FrameStats frame; // Last built frame.
+
+    uint64_t numFrames;
+    uint64_t totalRuns;
+    uint64_t totalStateChanges;
+    size_t maxRuns;
+    size_t maxStateChanges;
+} Layers;
+
+// Initialize `layers` as empty.
+void Layers_Init(Layers *const layers);
+
+// Free the internals of `layers`.
+void Layers_Deinit(Layers *const layers);
+
+// Make room for frames of up to `numSegs` segments in `numRuns` runs of up to
+// `LAYERS_RESERVED_COLORS` colors. Reserving up front keeps drawing free of allocations.
+void Layers_Reserve(Layers *const layers, const size_t numSegs, const size_t numRuns);
+
+// Replace the layers with the segments of `lines`, bucketed by run color.
+// Grows buffers as needed and keeps them for later frames.
+void Layers_Build(Layers *const layers, const Lines *const lines);
+
+// Draw the built layers, one call each.
+void Layers_Draw(const Layers *const layers, SDL_Renderer *const renderer);
+
+// Print runs and state changes per frame over every built frame to `file`.
+void Layers_PrintSummary(const Layers *const layers, FILE *const file);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
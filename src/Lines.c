@@ -0,0 +1,130 @@
+#include "Lines.h"
+
+#include <string.h>
+
+#include "Mem.h"
+
+void Lines_Init(Lines *const lines) {
+    *lines = (Lines) { 0 };
+}
+
+void Lines_Deinit(Lines *const lines) {
+    Mem_Free(lines->segs);
+    Mem_Free(lines->runs);
+    *lines = (Lines) { 0 };
+}
+
+void Lines_Clear(Lines *const lines) {
+    lines->numSegs = 0;
+    lines->numRuns = 0;
+}
+
+void Lines_Reserve(Lines *const lines, const size_t numSegs, const size_t numRuns) {
+    if (numSegs > lines->segsCap) {
+        lines->segs = Mem_ReallocTagged(lines->segs, numSegs * sizeof(Lines_Seg), MEM_TAG_LINES);
+        lines->segsCap = numSegs;
+    }
+
+    if (numRuns > lines->runsCap) {
+        lines->runs = Mem_ReallocTagged(lines->runs, numRuns * sizeof(Lines_Run), MEM_TAG_LINES);
+        lines->runsCap = numRuns;
+    }
+}
+
+void Lines_SetColor(Lines *const lines, const Rgba color) {
+    if (lines->numRuns > 0) {
+        Lines_Run *const last = &lines->runs[lines->numRuns - 1];
+
+        if (Rgba_Equal(last->color, color)) {
+            return;
+        }
+
+        // Reuse a run that never got any segments.
+        if (last->count == 0) {
+            last->color = color;
+            return;
+        }
+    }
+
+    if (lines->numRuns == lines->runsCap) {
+        Lines_Reserve(lines, 0, lines->runsCap * 2 + 16);
+    }
+
+    lines->runs[lines->numRuns] = (Lines_Run) {
+        .color = color,
+        .start = lines->numSegs,
+        .count = 0
+    };
+    lines->numRuns += 1;
+}
+
+void Lines_Append(Lines *const dst, const Lines *const src) {
+    Lines_Reserve(dst, dst->numSegs + src->numSegs, dst->numRuns + src->numRuns);
+
+    for (size_t r = 0; r < src->numRuns; r += 1) {
+        const Lines_Run *const run = &src->runs[r];
+
+        if (run->count == 0) {
+            continue;
+        }
+
+        Lines_SetColor(dst, run->color);
+
+        memcpy(dst->segs + dst->numSegs, src->segs + run->start, run->count * sizeof(Lines_Seg));
+        dst->numSegs += run->count;
+        dst->runs[dst->numRuns - 1].count += run->count;
+    }
+}
+
+// Liang-Barsky clipping.
+// Shrink the parameter range [*t0, *t1] so that p * t <= q holds.
+// Return false if the range becomes empty.
+static bool ClipEdge(const float p, const float q, float *const t0, float *const t1) {
+    if (p == 0.0f) {
+        return q >= 0.0f;
+    }
+
+    const float t = q / p;
+
+    if (p < 0.0f) {
+        if (t > *t1) { return false; }
+        if (t > *t0) { *t0 = t; }
+    }
+    else {
+        if (t < *t0) { return false; }
+        if (t < *t1) { *t1 = t; }
+    }
+
+    return true;
+}
+
+bool Lines_Clip(Lines_Seg *const seg, const int width, const int height) {
+    const float maxX = (float)(width - 1);
+    const float maxY = (float)(height - 1);
+
+    const float dx = seg->x2 - seg->x1;
+    const float dy = seg->y2 - seg->y1;
+
+    float t0 = 0.0f;
+    float t1 = 1.0f;
+
+    if (!ClipEdge(-dx, seg->x1,        &t0, &t1)) { return false; }
+    if (!ClipEdge(+dx, maxX - seg->x1, &t0, &t1)) { return false; }
+    if (!ClipEdge(-dy, seg->y1,        &t0, &t1)) { return false; }
+    if (!ClipEdge(+dy, maxY - seg->y1, &t0, &t1)) { return false; }
+
+    const float x1 = seg->x1;
+    const float y1 = seg->y1;
+
+    if (t1 < 1.0f) {
+        seg->x2 = x1 + t1 * dx;
+        seg->y2 = y1 + t1 * dy;
+    }
+
+    if (t0 > 0.0f) {
+        seg->x1 = x1 + t0 * dx;
+        seg->y1 = y1 + t0 * dy;
+    }
+
+    return true;
+}
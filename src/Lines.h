@@ -0,0 +1,79 @@
+#ifndef LINES_H
+#define LINES_H
+
+// Growable list of screen-space line segments grouped into runs of one color.
+// Built once per frame and then submitted to the renderer.
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "Rgba.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Line segment in pixel coordinates.
+typedef struct Lines_Seg {
+    float x1;
+    float y1;
+    float x2;
+    float y2;
+} Lines_Seg;
+
+// Consecutive segments drawn with the same color.
+typedef struct Lines_Run {
+    Rgba color;
+    size_t start; // Index of first segment.
+    size_t count;
+} Lines_Run;
+
+typedef struct Lines {
+    Lines_Seg *segs;
+    size_t numSegs;
+    size_t segsCap;
+
+    Lines_Run *runs;
+    size_t numRuns;
+    size_t runsCap;
+} Lines;
+
+// Initialize `lines` as empty.
+void Lines_Init(Lines *const lines);
+
+// Free the internals of `lines`.
+void Lines_Deinit(Lines *const lines);
+
+// Remove all segments and runs. Keep allocated capacity.
+void Lines_Clear(Lines *const lines);
+
+// Make room for at least `numSegs` segments and `numRuns` runs in total.
+// Reserving up front keeps the per-frame path free of allocations.
+void Lines_Reserve(Lines *const lines, const size_t numSegs, const size_t numRuns);
+
+// Segments pushed after this call are drawn with `color`.
+void Lines_SetColor(Lines *const lines, const Rgba color);
+
+// Append `seg` to the current run. `Lines_SetColor` must have been called.
+static inline void Lines_Push(Lines *const lines, const Lines_Seg seg) {
+    if (lines->numSegs == lines->segsCap) {
+        Lines_Reserve(lines, lines->segsCap * 2 + 64, 0);
+    }
+
+    lines->segs[lines->numSegs] = seg;
+    lines->numSegs += 1;
+    lines->runs[lines->numRuns - 1].count += 1;
+}
+
+// Append all runs and segments of `src` to `dst`, merging runs of equal color.
+void Lines_Append(Lines *const dst, const Lines *const src);
+
+// Clip `seg` to the rectangle [0, width - 1] x [0, height - 1].
+// Return false if nothing of it is left.
+bool Lines_Clip(Lines_Seg *const seg, const int width, const int height);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -1,26 +1,474 @@
+#if defined(__linux__)
+// For `MAP_ANONYMOUS`, `MAP_HUGETLB`, `MADV_HUGEPAGE` and `mlock`.
+#define _GNU_SOURCE
+#endif
+
 #include "Mem.h"
 
+#include <stdatomic.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
-void *Mem_Alloc(size_t size) {
-    void *const ptr = malloc(size);
+#if defined(__linux__)
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+// Where a block came from, so it can be resized and freed the same way.
+typedef enum BlockKind {
+    BLOCK_HEAP,    // `malloc`. The header is at the start of the heap block.
+    BLOCK_ALIGNED, // `malloc` with room to move the returned pointer to an alignment.
+    BLOCK_MAPPED,  // `mmap` of normal pages, maybe backed by transparent huge pages.
+    BLOCK_HUGETLB  // `mmap` of reserved huge pages.
+} BlockKind;
+
+// Stored right in front of every tracked block.
+// The union keeps the returned pointer aligned like `malloc` would.
+typedef union Header {
+    struct {
+        size_t size;
+        Mem_Tag tag;
+        BlockKind kind;
+        size_t offset;    // Bytes from the start of the heap block or mapping to the returned pointer.
+        size_t alignment; // Requested alignment. 0 for heap blocks.
+        size_t mapLength; // Length of the mapping. 0 if not mapped.
+        bool advised;     // Whether `MADV_HUGEPAGE` was accepted for the mapping.
+        bool locked;      // Whether the mapping is locked in memory (`mlock`).
+    } info;
+
+    max_align_t align;
+} Header;
+
+// Huge page size assumed for rounding mappings. The usual size on x86-64 and arm64.
+#define MEM_HUGE_PAGE_SIZE ((size_t)2 * 1024 * 1024)
+
+typedef struct TagCounts {
+    atomic_uint_fast64_t numAllocs;
+    atomic_uint_fast64_t numFrees;
+    atomic_size_t currentBytes;
+    atomic_size_t peakBytes;
+} TagCounts;
+
+// Index MEM_NUM_TAGS holds the sum over all tags.
+static TagCounts counts[MEM_NUM_TAGS + 1];
+
+static const char *const tagNames[MEM_NUM_TAGS + 1] = {
+    "other", "app", "grid", "lines", "terrain", "capture", "heatmap", "points", "labels", "replay", "jobs", "all"
+};
+
+static atomic_uint_fast64_t heapCalls;
+
+// Allocation events of the calling thread. Frame and steady-state accounting
+// only look at these so that other threads (e.g. loaders) are not blamed on the frame.
+static _Thread_local uint64_t threadAllocEvents;
+
+// Frame and steady-state accounting. Only touched by the thread running the frame.
+static uint64_t frameStart;
+static uint64_t numFrames;
+static uint64_t frameAllocsTotal;
+static uint64_t frameAllocsMax;
+static bool checking;
+static uint64_t noAllocStart;
+static uint64_t noAllocStartTags[MEM_NUM_TAGS];
+static uint64_t numFlagged;
+
+static void AddBytes(TagCounts *const c, const size_t add) {
+    const size_t current = atomic_fetch_add_explicit(&c->currentBytes, add, memory_order_relaxed) + add;
+    size_t peak = atomic_load_explicit(&c->peakBytes, memory_order_relaxed);
+
+    while (current > peak
+        && !atomic_compare_exchange_weak_explicit(&c->peakBytes, &peak, current,
+            memory_order_relaxed, memory_order_relaxed))
+    {
+    }
+}
+
+static void SubBytes(TagCounts *const c, const size_t sub) {
+    atomic_fetch_sub_explicit(&c->currentBytes, sub, memory_order_relaxed);
+}
+
+static void CountAlloc(const Mem_Tag tag, const size_t oldSize, const size_t newSize) {
+    const Mem_Tag indices[2] = {tag, MEM_NUM_TAGS};
 
-    if (size != 0 && ptr == NULL) {
+    for (int i = 0; i < 2; i += 1) {
+        TagCounts *const c = &counts[indices[i]];
+
+        atomic_fetch_add_explicit(&c->numAllocs, 1, memory_order_relaxed);
+        SubBytes(c, oldSize);
+        AddBytes(c, newSize);
+    }
+}
+
+void *Mem_AllocTagged(size_t size, Mem_Tag tag) {
+    Header *const header = malloc(sizeof(Header) + size);
+
+    if (header == NULL) {
         fprintf(stderr, "%s: Failed to malloc %zu bytes\n", __func__, size);
         exit(1);
     }
 
-    return ptr;
+    *header = (Header) { .info = { .size = size, .tag = tag, .kind = BLOCK_HEAP, .offset = sizeof(Header) } };
+    CountAlloc(tag, 0, size);
+
+#if !defined(MEM_INTERPOSE)
+    threadAllocEvents += 1;
+#endif
+
+    return header + 1;
 }
 
-void *Mem_Realloc(void *ptr, size_t newSize) {
-    ptr = realloc(ptr, newSize);
+void *Mem_ReallocTagged(void *ptr, size_t newSize, Mem_Tag tag) {
+    if (ptr == NULL) {
+        return Mem_AllocTagged(newSize, tag);
+    }
 
-    if (newSize != 0 && ptr == NULL) {
+    Header *header = (Header *)ptr - 1;
+    const size_t oldSize = header->info.size;
+    const Mem_Tag oldTag = header->info.tag;
+
+    // Blocks that are not plain heap blocks are replaced by a new block of the same kind.
+    if (header->info.kind != BLOCK_HEAP) {
+        void *const newPtr = (header->info.kind == BLOCK_ALIGNED)
+            ? Mem_AllocAligned(newSize, header->info.alignment, tag)
+            : Mem_AllocLarge(newSize, tag);
+
+        memcpy(newPtr, ptr, (oldSize < newSize) ? oldSize : newSize);
+        Mem_Free(ptr);
+        return newPtr;
+    }
+
+    header = realloc(header, sizeof(Header) + newSize);
+
+    if (header == NULL) {
         fprintf(stderr, "%s: Failed to realloc to %zu bytes\n", __func__, newSize);
         exit(1);
     }
 
+    if (oldTag != tag) {
+        SubBytes(&counts[oldTag], oldSize);
+        SubBytes(&counts[MEM_NUM_TAGS], oldSize);
+        CountAlloc(tag, 0, newSize);
+    }
+    else {
+        CountAlloc(tag, oldSize, newSize);
+    }
+
+    header->info.size = newSize;
+    header->info.tag = tag;
+
+#if !defined(MEM_INTERPOSE)
+    threadAllocEvents += 1;
+#endif
+
+    return header + 1;
+}
+
+void *Mem_Alloc(size_t size) {
+    return Mem_AllocTagged(size, MEM_TAG_OTHER);
+}
+
+void *Mem_Realloc(void *ptr, size_t newSize) {
+    const Mem_Tag tag = (ptr == NULL) ? MEM_TAG_OTHER : ((Header *)ptr - 1)->info.tag;
+
+    return Mem_ReallocTagged(ptr, newSize, tag);
+}
+
+void Mem_Free(void *ptr) {
+    if (ptr == NULL) {
+        return;
+    }
+
+    Header *const header = (Header *)ptr - 1;
+    const Mem_Tag indices[2] = {header->info.tag, MEM_NUM_TAGS};
+
+    for (int i = 0; i < 2; i += 1) {
+        atomic_fetch_add_explicit(&counts[indices[i]].numFrees, 1, memory_order_relaxed);
+        SubBytes(&counts[indices[i]], header->info.size);
+    }
+
+    uint8_t *const start = (uint8_t *)ptr - header->info.offset;
+
+    switch (header->info.kind) {
+        case BLOCK_HEAP:
+        case BLOCK_ALIGNED:
+        {
+            free(start);
+            break;
+        }
+        case BLOCK_MAPPED:
+        case BLOCK_HUGETLB:
+        {
+#if defined(__linux__)
+            munmap(start, header->info.mapLength);
+#endif
+            break;
+        }
+    }
+}
+
+void *Mem_AllocAligned(size_t size, size_t alignment, Mem_Tag tag) {
+    if (alignment == 0 || (alignment & (alignment - 1)) != 0) {
+        fprintf(stderr, "%s: Alignment %zu is not a power of 2\n", __func__, alignment);
+        exit(1);
+    }
+
+    if (alignment < _Alignof(max_align_t)) {
+        alignment = _Alignof(max_align_t);
+    }
+
+    // The header goes in front of the first aligned address after it.
+    uint8_t *const start = malloc(sizeof(Header) + alignment + size);
+
+    if (start == NULL) {
+        fprintf(stderr, "%s: Failed to malloc %zu bytes\n", __func__, size);
+        exit(1);
+    }
+
+    const uintptr_t first = (uintptr_t)(start + sizeof(Header));
+    const uintptr_t aligned = (first + alignment - 1) & ~(uintptr_t)(alignment - 1);
+    uint8_t *const ptr = start + (aligned - (uintptr_t)start);
+
+    ((Header *)ptr)[-1] = (Header) { .info = {
+        .size = size,
+        .tag = tag,
+        .kind = BLOCK_ALIGNED,
+        .offset = (size_t)(ptr - start),
+        .alignment = alignment
+    } };
+
+    CountAlloc(tag, 0, size);
+
+#if !defined(MEM_INTERPOSE)
+    threadAllocEvents += 1;
+#endif
+
     return ptr;
 }
+
+void *Mem_AllocLarge(size_t size, Mem_Tag tag) {
+#if defined(__linux__)
+    if (size < MEM_LARGE_MIN_SIZE) {
+        return Mem_AllocAligned(size, MEM_ALIGNMENT, tag);
+    }
+
+    // The header takes the first `MEM_ALIGNMENT` bytes so the block stays aligned.
+    const size_t length = (MEM_ALIGNMENT + size + MEM_HUGE_PAGE_SIZE - 1) & ~(MEM_HUGE_PAGE_SIZE - 1);
+
+    BlockKind kind = BLOCK_HUGETLB;
+    bool advised = false;
+
+    // Reserved huge pages are only there if an administrator set some aside,
+    // so this usually fails. Populated up front so first use does not fault.
+    uint8_t *start = mmap(NULL, length, PROT_READ | PROT_WRITE,
+        MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB | MAP_POPULATE, -1, 0);
+
+    if (start == MAP_FAILED) {
+        kind = BLOCK_MAPPED;
+        start = mmap(NULL, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+        if (start == MAP_FAILED) {
+            fprintf(stderr, "%s: Failed to mmap %zu bytes\n", __func__, length);
+            exit(1);
+        }
+
+        // Ask for transparent huge pages before touching, so faults can fill 2 MiB at a time.
+        // Fails harmlessly if they are disabled.
+        advised = madvise(start, length, MADV_HUGEPAGE) == 0;
+
+        // Touch every page now instead of on first use.
+        const size_t pageSize = (size_t)sysconf(_SC_PAGESIZE);
+
+        for (size_t at = 0; at < length; at += pageSize) {
+            ((volatile uint8_t *)start)[at] = 0;
+        }
+    }
+
+    // Pin the pages so they are never swapped or moved out from under a capture.
+    // Best effort: most users may only lock a little memory (`RLIMIT_MEMLOCK`),
+    // and the block works the same unlocked. Unmapping unlocks it.
+    const bool locked = mlock(start, length) == 0;
+
+    uint8_t *const ptr = start + MEM_ALIGNMENT;
+
+    ((Header *)ptr)[-1] = (Header) { .info = {
+        .size = size,
+        .tag = tag,
+        .kind = kind,
+        .offset = MEM_ALIGNMENT,
+        .alignment = MEM_ALIGNMENT,
+        .mapLength = length,
+        .advised = advised,
+        .locked = locked
+    } };
+
+    CountAlloc(tag, 0, size);
+
+    // Not a heap call so counted here even with the interposer.
+    threadAllocEvents += 1;
+
+    return ptr;
+#else
+    return Mem_AllocAligned(size, MEM_ALIGNMENT, tag);
+#endif
+}
+
+const char *Mem_DescribeBlock(const void *ptr) {
+    const Header *const header = (const Header *)ptr - 1;
+
+    switch (header->info.kind) {
+        case BLOCK_HEAP: return "malloc";
+        case BLOCK_ALIGNED: return "malloc, aligned";
+        case BLOCK_MAPPED:
+            if (header->info.advised) {
+                return header->info.locked ? "mmap, MADV_HUGEPAGE, mlock" : "mmap, MADV_HUGEPAGE";
+            }
+
+            return header->info.locked ? "mmap, mlock" : "mmap";
+        case BLOCK_HUGETLB: return header->info.locked ? "mmap, MAP_HUGETLB, mlock" : "mmap, MAP_HUGETLB";
+    }
+
+    return "unknown";
+}
+
+Mem_Counts Mem_GetCounts(Mem_Tag tag) {
+    const TagCounts *const c = &counts[tag];
+
+    return (Mem_Counts) {
+        .numAllocs = atomic_load_explicit(&c->numAllocs, memory_order_relaxed),
+        .numFrees = atomic_load_explicit(&c->numFrees, memory_order_relaxed),
+        .currentBytes = atomic_load_explicit(&c->currentBytes, memory_order_relaxed),
+        .peakBytes = atomic_load_explicit(&c->peakBytes, memory_order_relaxed)
+    };
+}
+
+uint64_t Mem_NumHeapCalls(void) {
+    return atomic_load_explicit(&heapCalls, memory_order_relaxed);
+}
+
+// Tracked allocations and heap calls so far by the calling thread.
+// With the interposer, each tracked allocation is also a heap call and is only counted there.
+static uint64_t NumAllocEvents(void) {
+    return threadAllocEvents;
+}
+
+uint64_t Mem_EndFrame(void) {
+    const uint64_t now = NumAllocEvents();
+    const uint64_t frameAllocs = now - frameStart;
+
+    frameStart = now;
+    numFrames += 1;
+    frameAllocsTotal += frameAllocs;
+
+    if (frameAllocs > frameAllocsMax) {
+        frameAllocsMax = frameAllocs;
+    }
+
+    return frameAllocs;
+}
+
+void Mem_SetChecking(bool enabled) {
+    checking = enabled;
+}
+
+void Mem_BeginNoAlloc(void) {
+    noAllocStart = NumAllocEvents();
+
+    for (int t = 0; t < MEM_NUM_TAGS; t += 1) {
+        noAllocStartTags[t] = Mem_GetCounts((Mem_Tag)t).numAllocs;
+    }
+}
+
+uint64_t Mem_EndNoAlloc(const char *where) {
+    const uint64_t numAllocs = NumAllocEvents() - noAllocStart;
+
+    if (numAllocs == 0 || !checking) {
+        return numAllocs;
+    }
+
+    numFlagged += numAllocs;
+
+    fprintf(stderr, "%s: %llu allocation(s) in %s:",
+        __func__, (unsigned long long)numAllocs, where);
+
+    uint64_t numTracked = 0;
+
+    for (int t = 0; t < MEM_NUM_TAGS; t += 1) {
+        const uint64_t n = Mem_GetCounts((Mem_Tag)t).numAllocs - noAllocStartTags[t];
+
+        if (n != 0) {
+            fprintf(stderr, " [%s: %llu]", tagNames[t], (unsigned long long)n);
+            numTracked += n;
+        }
+    }
+
+    if (numAllocs > numTracked) {
+        fprintf(stderr, " [untracked heap calls: %llu]",
+            (unsigned long long)(numAllocs - numTracked));
+    }
+
+    fprintf(stderr, "\n");
+
+    return numAllocs;
+}
+
+void Mem_PrintStats(FILE *file) {
+    fprintf(file, "Memory (tracked by Mem):\n");
+
+    for (int t = 0; t <= MEM_NUM_TAGS; t += 1) {
+        const Mem_Counts c = Mem_GetCounts((Mem_Tag)t);
+
+        fprintf(file, "%-6s current %10zu B  peak %10zu B  allocs %8llu  frees %8llu\n",
+            tagNames[t], c.currentBytes, c.peakBytes,
+            (unsigned long long)c.numAllocs, (unsigned long long)c.numFrees);
+    }
+
+#if defined(MEM_INTERPOSE)
+    fprintf(file, "Heap calls (all code): %llu\n", (unsigned long long)Mem_NumHeapCalls());
+#endif
+
+    if (numFrames != 0) {
+        fprintf(file, "Allocations per frame: avg %.3f  max %llu over %llu frames\n",
+            (double)frameAllocsTotal / (double)numFrames,
+            (unsigned long long)frameAllocsMax, (unsigned long long)numFrames);
+    }
+
+    if (checking) {
+        fprintf(file, "Flagged steady-state allocations: %llu\n", (unsigned long long)numFlagged);
+    }
+}
+
+#if defined(MEM_INTERPOSE)
+
+// Optional interposer. Replaces the C library's `malloc` family for the whole
+// process so that allocations made by SDL and the C library are counted too.
+// Relies on the glibc `__libc_*` entry points.
+
+extern void *__libc_malloc(size_t size);
+extern void *__libc_calloc(size_t num, size_t size);
+extern void *__libc_realloc(void *ptr, size_t size);
+extern void __libc_free(void *ptr);
+
+void *malloc(size_t size) {
+    atomic_fetch_add_explicit(&heapCalls, 1, memory_order_relaxed);
+    threadAllocEvents += 1;
+    return __libc_malloc(size);
+}
+
+void *calloc(size_t num, size_t size) {
+    atomic_fetch_add_explicit(&heapCalls, 1, memory_order_relaxed);
+    threadAllocEvents += 1;
+    return __libc_calloc(num, size);
+}
+
+void *realloc(void *ptr, size_t size) {
+    atomic_fetch_add_explicit(&heapCalls, 1, memory_order_relaxed);
+    threadAllocEvents += 1;
+    return __libc_realloc(ptr, size);
+}
+
+void free(void *ptr) {
+    __libc_free(ptr);
+}
+
+#endif
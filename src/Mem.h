@@ -1,6 +1,10 @@
 #ifndef MEM_H
 #define MEM_H
 
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
 #if defined(__linux__)
 // For `size_t`
 #include <stddef.h>
@@ -10,11 +14,90 @@
 extern "C" {
 #endif
 
+// What a tracked allocation is used for. Used to group the counts.
+typedef enum Mem_Tag {
+    MEM_TAG_OTHER,
+    MEM_TAG_APP,     // Long-lived state of `App`.
+    MEM_TAG_GRID,    // Grid projections.
+    MEM_TAG_LINES,   // Per-frame line lists.
+    MEM_TAG_TERRAIN, // Heightfield tile cache.
+    MEM_TAG_CAPTURE, // Encoded frames waiting to be written.
+    MEM_TAG_HEATMAP, // Cell values and vertex buffers of the heatmap layer.
+    MEM_TAG_POINTS,  // Point cloud and the pixels it is drawn to.
+    MEM_TAG_LABELS,  // Vertex buffers of text labels.
+    MEM_TAG_REPLAY,  // Instant replay frames, raw and compressed.
+    MEM_TAG_JOBS,    // Task deques of the job system.
+    MEM_NUM_TAGS
+} Mem_Tag;
+
 // These functions call `malloc` or `realloc` accordingly.
 // If error, print to `stderr` and exit
+// Memory from these functions is tracked and must be released with `Mem_Free`.
+// `Mem_Alloc` uses `MEM_TAG_OTHER`. `Mem_Realloc` keeps the tag of `ptr`.
 void *Mem_Alloc(size_t size);
 void *Mem_Realloc(void *ptr, size_t newSize);
 
+// Like `Mem_Alloc` and `Mem_Realloc` but count the memory under `tag`.
+void *Mem_AllocTagged(size_t size, Mem_Tag tag);
+void *Mem_ReallocTagged(void *ptr, size_t newSize, Mem_Tag tag);
+
+// Alignment of `Mem_AllocLarge` blocks. One cache line, and enough for any SIMD load.
+#define MEM_ALIGNMENT 64
+
+// Smaller `Mem_AllocLarge` requests come from the heap.
+#define MEM_LARGE_MIN_SIZE ((size_t)1024 * 1024)
+
+// Like `Mem_AllocTagged` but the block starts at a multiple of `alignment`, a power of 2.
+void *Mem_AllocAligned(size_t size, size_t alignment, Mem_Tag tag);
+
+// For big buffers that are kept, e.g. framebuffers and capture buffers.
+// Aligned to `MEM_ALIGNMENT` and, on Linux, mapped straight from the kernel:
+// on reserved huge pages (`MAP_HUGETLB`) if there are any, else on normal pages
+// with transparent huge pages requested (`MADV_HUGEPAGE`). Every page is faulted
+// in up front so first use does not pay for it, and locked in memory (`mlock`)
+// if the limit on locked memory allows. Elsewhere like `Mem_AllocAligned`.
+// Contents start zeroed on Linux and undefined elsewhere.
+void *Mem_AllocLarge(size_t size, Mem_Tag tag);
+
+// Free memory from the functions above. Does nothing if `ptr` is NULL.
+// `Mem_Realloc` of aligned and large blocks keeps their kind.
+void Mem_Free(void *ptr);
+
+// Return how the block `ptr` was allocated, e.g. "mmap, MADV_HUGEPAGE". For logs.
+const char *Mem_DescribeBlock(const void *ptr);
+
+typedef struct Mem_Counts {
+    uint64_t numAllocs; // Calls that allocated or resized a block.
+    uint64_t numFrees;
+    size_t currentBytes;
+    size_t peakBytes;
+} Mem_Counts;
+
+// Get the counts of one tag, or of all tracked memory if `tag` is `MEM_NUM_TAGS`.
+// Safe to call from any thread.
+Mem_Counts Mem_GetCounts(Mem_Tag tag);
+
+// Return the number of heap calls (`malloc`, `calloc`, `realloc`) made by anyone
+// in the process, including libraries such as SDL.
+// Only counted if built with `-DMEM_INTERPOSE` on glibc. Otherwise always 0.
+uint64_t Mem_NumHeapCalls(void);
+
+// Mark the end of a frame and return the number of tracked allocations plus
+// heap calls made since the previous call. Kept for `Mem_PrintStats`.
+uint64_t Mem_EndFrame(void);
+
+// Steady-state checking.
+// Everything between `Mem_BeginNoAlloc` and `Mem_EndNoAlloc` is expected to not
+// allocate. If it does and checking is enabled, print the tags and counts to
+// `stderr` labeled with `where`. Return the number of allocations seen.
+void Mem_SetChecking(bool enabled);
+void Mem_BeginNoAlloc(void);
+uint64_t Mem_EndNoAlloc(const char *where);
+
+// Print current and peak bytes per tag, allocations per frame
+// and the number of flagged steady-state allocations.
+void Mem_PrintStats(FILE *file);
+
 #ifdef __cplusplus
 }
 #endif
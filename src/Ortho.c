@@ -0,0 +1,138 @@
+#include "Ortho.h"
+
+#include <string.h>
+
+#include "M_PI.h"
+
+void Ortho_InitView(Ortho_View *const view,
+    V3d cameraPos,
+    double horizLookRads, double vertLookRads,
+    double projPlaneWidth, double projPlaneHeight,
+    int screenWidth, int screenHeight)
+{
+    view->cameraPos = cameraPos;
+
+    // Direction camera is looking.
+    view->lookForward = Ortho_SphericalToCartesian(horizLookRads, vertLookRads);
+
+    // Calculate the up vector.
+    const double lookUpRads = vertLookRads + (M_PI / 2.0);
+    view->lookUp = Ortho_SphericalToCartesian(horizLookRads, lookUpRads);
+
+    // Assume camera never has roll (only pitch and yaw).
+    const double rightRads = horizLookRads + (M_PI / 2.0);
+    view->lookRight = (V3d) {
+        cos(rightRads),
+        sin(rightRads),
+        0.0
+    };
+
+    view->projPlaneWidth = projPlaneWidth;
+    view->projPlaneHeight = projPlaneHeight;
+    view->screenWidth = screenWidth;
+    view->screenHeight = screenHeight;
+
+    // A point p lands at screen proportions
+    //  x: (+dot(p - cameraPos, lookRight) + projPlaneWidth  / 2) / projPlaneWidth
+    //  y: (-dot(p - cameraPos, lookUp)    + projPlaneHeight / 2) / projPlaneHeight
+    // and a proportion of 1.0 is the last pixel (screen size - 1).
+    // Fold all of that into one linear map plus an offset.
+    const double pixelsPerRight = (screenWidth - 1.0) / projPlaneWidth;
+    const double pixelsPerUp = -(screenHeight - 1.0) / projPlaneHeight;
+
+    const V3d right = V3d_Mul(view->lookRight, pixelsPerRight);
+    const V3d up = V3d_Mul(view->lookUp, pixelsPerUp);
+    const V3d forward = view->lookForward;
+
+    view->axisX = (V3d) {right.x, up.x, forward.x};
+    view->axisY = (V3d) {right.y, up.y, forward.y};
+    view->axisZ = (V3d) {right.z, up.z, forward.z};
+
+    view->origin = (V3d) {
+        (screenWidth - 1.0) / 2.0 - V3d_Dot(cameraPos, right),
+        (screenHeight - 1.0) / 2.0 - V3d_Dot(cameraPos, up),
+        -V3d_Dot(cameraPos, forward)
+    };
+}
+
+bool Ortho_GetScreenTransform(const Ortho_View *const from, const Ortho_View *const to,
+    Ortho_ScreenTransform *const transform)
+{
+    // Same look angles give bitwise equal look vectors.
+    if (from->screenWidth != to->screenWidth || from->screenHeight != to->screenHeight
+        || memcmp(&from->lookForward, &to->lookForward, sizeof(V3d)) != 0
+        || memcmp(&from->lookRight, &to->lookRight, sizeof(V3d)) != 0
+        || memcmp(&from->lookUp, &to->lookUp, sizeof(V3d)) != 0)
+    {
+        return false;
+    }
+
+    // Pixels per unit of the projection plane scale with its inverse size.
+    const double scaleX = from->projPlaneWidth / to->projPlaneWidth;
+    const double scaleY = from->projPlaneHeight / to->projPlaneHeight;
+
+    // Zoom must keep the aspect ratio.
+    if (fabs(scaleX - scaleY) > 1e-12 * scaleX) {
+        return false;
+    }
+
+    // The axes scale by `scaleX` exactly, so only the origin needs matching.
+    *transform = (Ortho_ScreenTransform) {
+        .scale = scaleX,
+        .offset = {
+            to->origin.x - scaleX * from->origin.x,
+            to->origin.y - scaleX * from->origin.y,
+            to->origin.z - from->origin.z
+        }
+    };
+
+    return true;
+}
+
+Ortho_Ray Ortho_Unproject(const Ortho_View *const view, const double px, const double py) {
+    // Undo the screen proportions described in `Ortho_InitView`.
+    const double rightPerPixel = (view->screenWidth > 1)
+        ? view->projPlaneWidth / (view->screenWidth - 1.0) : 0.0;
+    const double upPerPixel = (view->screenHeight > 1)
+        ? -view->projPlaneHeight / (view->screenHeight - 1.0) : 0.0;
+
+    const double right = (px - (view->screenWidth - 1.0) / 2.0) * rightPerPixel;
+    const double up = (py - (view->screenHeight - 1.0) / 2.0) * upPerPixel;
+
+    return (Ortho_Ray) {
+        .origin = V3d_Add(view->cameraPos,
+            V3d_Add(V3d_Mul(view->lookRight, right), V3d_Mul(view->lookUp, up))),
+        .direction = view->lookForward
+    };
+}
+
+// Return (world x, world y, depth) where `ray` meets the plane z = `planeZ`.
+static V3d HitPlane(const Ortho_Ray ray, const double planeZ) {
+    const double t = (planeZ - ray.origin.z) / ray.direction.z;
+    const V3d hit = V3d_Add(ray.origin, V3d_Mul(ray.direction, t));
+
+    return (V3d) {hit.x, hit.y, t};
+}
+
+bool Ortho_InitPlaneMap(const Ortho_View *const view, const double planeZ,
+    Ortho_PlaneMap *const map)
+{
+    if (fabs(view->lookForward.z) < 1e-9) {
+        return false;
+    }
+
+    // Unprojecting and intersecting are both affine,
+    // so three pixels are enough to know every pixel.
+    const V3d hit00 = HitPlane(Ortho_Unproject(view, 0.0, 0.0), planeZ);
+    const V3d hit10 = HitPlane(Ortho_Unproject(view, 1.0, 0.0), planeZ);
+    const V3d hit01 = HitPlane(Ortho_Unproject(view, 0.0, 1.0), planeZ);
+
+    *map = (Ortho_PlaneMap) {
+        .planeZ = planeZ,
+        .origin = hit00,
+        .perPixelX = V3d_Sub(hit10, hit00),
+        .perPixelY = V3d_Sub(hit01, hit00)
+    };
+
+    return true;
+}
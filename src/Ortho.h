@@ -0,0 +1,151 @@
+#ifndef ORTHO_H
+#define ORTHO_H
+
+// Orthographic camera and the world-to-pixel mapping derived from it.
+
+#include <stdbool.h>
+
+#include "V3d.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Everything needed to project world points onto the screen for one frame.
+//
+// Orthographic projection is affine, so projecting a point p is
+//  origin + p.x * axisX + p.y * axisY + p.z * axisZ
+// where each V3d holds (pixel x, pixel y, depth).
+// Pixel [0.0, 0.0] is the center of the top-left pixel of the screen.
+// Depth is the distance from the camera along `lookForward`.
+// Points with depth <= 0.0 are behind the projection plane.
+typedef struct Ortho_View {
+    V3d cameraPos;
+
+    // Unit vectors. Camera never has roll so `lookRight` is in the xy plane.
+    V3d lookForward;
+    V3d lookRight;
+    V3d lookUp;
+
+    double projPlaneWidth;
+    double projPlaneHeight;
+
+    int screenWidth;
+    int screenHeight;
+
+    V3d origin; // Projection of world origin.
+    V3d axisX;  // Change in projection per unit of world x.
+    V3d axisY;  // Change in projection per unit of world y.
+    V3d axisZ;  // Change in projection per unit of world z.
+} Ortho_View;
+
+// The ray through a pixel: every world point that projects onto it.
+typedef struct Ortho_Ray {
+    V3d origin;    // World point on the projection plane, at depth 0.0.
+    V3d direction; // `lookForward`. Depth along the ray equals distance from `origin`.
+} Ortho_Ray;
+
+// Where the rays of all pixels meet the plane z = `planeZ`, as an affine map
+// from pixel coordinates, so that pixel (px, py) hits
+//  origin + px * perPixelX + py * perPixelY
+// where each V3d holds (world x, world y, depth).
+typedef struct Ortho_PlaneMap {
+    double planeZ;
+    V3d origin;    // Hit of pixel (0, 0).
+    V3d perPixelX; // Change in hit per pixel to the right.
+    V3d perPixelY; // Change in hit per pixel down.
+} Ortho_PlaneMap;
+
+// How projections change between two views with the same orientation and
+// screen size, i.e. that differ only by camera position (pan) and projection
+// plane size (zoom). A point projected to q by the first view projects to
+//  (scale * q.x + offset.x, scale * q.y + offset.y, q.z + offset.z)
+// by the second.
+typedef struct Ortho_ScreenTransform {
+    double scale;
+    V3d offset;
+} Ortho_ScreenTransform;
+
+// Converting spherical coordinates to a vector.
+// radius = 1.0 so not shown and no need to normalize the vector.
+static inline V3d Ortho_SphericalToCartesian(const double horizLookRads, const double vertLookRads) {
+    return (V3d) {
+        sin(vertLookRads) * cos(horizLookRads),
+        sin(vertLookRads) * sin(horizLookRads),
+        cos(vertLookRads)
+    };
+}
+
+// Initialize `view` from the camera state and the screen size in pixels.
+// See `App` for the meaning of the look angles.
+void Ortho_InitView(Ortho_View *const view,
+    V3d cameraPos,
+    double horizLookRads, double vertLookRads,
+    double projPlaneWidth, double projPlaneHeight,
+    int screenWidth, int screenHeight);
+
+// Return (pixel x, pixel y, depth) of world point `p`.
+static inline V3d Ortho_Project(const Ortho_View *const view, const V3d p) {
+    return (V3d) {
+        view->origin.x + p.x * view->axisX.x + p.y * view->axisY.x + p.z * view->axisZ.x,
+        view->origin.y + p.x * view->axisX.y + p.y * view->axisY.y + p.z * view->axisZ.y,
+        view->origin.z + p.x * view->axisX.z + p.y * view->axisY.z + p.z * view->axisZ.z
+    };
+}
+
+// Return the change in (pixel x, pixel y, depth) caused by translating
+// a world point by `d`. Unlike `Ortho_Project` the camera position plays no part.
+static inline V3d Ortho_ProjectOffset(const Ortho_View *const view, const V3d d) {
+    return (V3d) {
+        d.x * view->axisX.x + d.y * view->axisY.x + d.z * view->axisZ.x,
+        d.x * view->axisX.y + d.y * view->axisY.y + d.z * view->axisZ.y,
+        d.x * view->axisX.z + d.y * view->axisY.z + d.z * view->axisZ.z
+    };
+}
+
+// Set `transform` to take projections of `from` to projections of `to`.
+// Return false if the views differ by more than pan and zoom.
+bool Ortho_GetScreenTransform(const Ortho_View *const from, const Ortho_View *const to,
+    Ortho_ScreenTransform *const transform);
+
+// Return (pixel x, pixel y, depth) `q` moved by `transform`.
+static inline V3d Ortho_TransformPoint(const Ortho_ScreenTransform *const transform, const V3d q) {
+    return (V3d) {
+        transform->scale * q.x + transform->offset.x,
+        transform->scale * q.y + transform->offset.y,
+        q.z + transform->offset.z
+    };
+}
+
+// Return the ray of pixel (px, py). Inverse of `Ortho_Project`.
+Ortho_Ray Ortho_Unproject(const Ortho_View *const view, const double px, const double py);
+
+// Set `map` for the plane z = `planeZ`.
+// Return false if the camera looks along the plane so that rays do not meet it.
+bool Ortho_InitPlaneMap(const Ortho_View *const view, const double planeZ,
+    Ortho_PlaneMap *const map);
+
+// Return (world x, world y, depth) where pixel (px, py) meets the plane of `map`.
+// The point is behind the camera if depth <= 0.0.
+static inline V3d Ortho_UnprojectToPlane(const Ortho_PlaneMap *const map,
+    const double px, const double py)
+{
+    return (V3d) {
+        map->origin.x + px * map->perPixelX.x + py * map->perPixelY.x,
+        map->origin.y + px * map->perPixelX.y + py * map->perPixelY.y,
+        map->origin.z + px * map->perPixelX.z + py * map->perPixelY.z
+    };
+}
+
+// Return true if the projected point `q` is in front of the camera and on screen.
+static inline bool Ortho_IsVisible(const Ortho_View *const view, const V3d q) {
+    return q.z > 0.0
+        && q.x >= 0.0 && q.x <= view->screenWidth - 1.0
+        && q.y >= 0.0 && q.y <= view->screenHeight - 1.0;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
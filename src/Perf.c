@@ -0,0 +1,386 @@
+#if defined(__linux__)
+// For `syscall`.
+#define _GNU_SOURCE
+#endif
+
+#include "Perf.h"
+
+#include <string.h>
+
+#if defined(__linux__)
+#include <errno.h>
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+static const char *const counterNames[PERF_NUM_COUNTERS] = {
+    "cycles", "instructions", "L1d-misses", "LLC-misses", "branch-misses"
+};
+
+static const char *const stageNames[PERF_NUM_STAGES] = {
+    "events", "update", "project", "draw", "present", "capture"
+};
+
+#if defined(__linux__)
+
+static int OpenCounter(const uint32_t type, const uint64_t config, const int groupFd) {
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+
+    attr.size = sizeof(attr);
+    attr.type = type;
+    attr.config = config;
+    attr.disabled = (groupFd == -1) ? 1 : 0;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_ID
+        | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+    // This thread only, any CPU.
+    return (int)syscall(SYS_perf_event_open, &attr, 0, -1, groupFd, 0);
+}
+
+// Open the counters of `group` on the calling thread and start them.
+// Return false if even the cycles counter is unavailable. If `report`,
+// print which counters are unavailable to `stderr`.
+static bool OpenGroup(Perf_Group *const group, const bool report) {
+    for (int i = 0; i < PERF_NUM_COUNTERS; i += 1) {
+        group->fds[i] = -1;
+    }
+
+    const uint64_t cacheMiss =
+        (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+
+    const struct {
+        uint32_t type;
+        uint64_t config;
+    } configs[PERF_NUM_COUNTERS] = {
+        [PERF_CYCLES]        = {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+        [PERF_INSTRUCTIONS]  = {PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+        [PERF_L1D_MISSES]    = {PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_L1D | cacheMiss},
+        [PERF_LLC_MISSES]    = {PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_LL | cacheMiss},
+        [PERF_BRANCH_MISSES] = {PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES},
+    };
+
+    group->fds[PERF_CYCLES] = OpenCounter(configs[PERF_CYCLES].type, configs[PERF_CYCLES].config, -1);
+
+    if (group->fds[PERF_CYCLES] == -1) {
+        if (report) {
+            fprintf(stderr, "%s: Hardware counters unavailable (%s). "
+                "Continuing without them.\n", __func__, strerror(errno));
+        }
+
+        return false;
+    }
+
+    // Missing secondary counters (common in virtual machines) only lose that column.
+    for (int i = PERF_CYCLES + 1; i < PERF_NUM_COUNTERS; i += 1) {
+        group->fds[i] = OpenCounter(configs[i].type, configs[i].config, group->fds[PERF_CYCLES]);
+
+        if (group->fds[i] == -1 && report) {
+            fprintf(stderr, "%s: Counter %s unavailable (%s).\n",
+                __func__, counterNames[i], strerror(errno));
+        }
+    }
+
+    ioctl(group->fds[PERF_CYCLES], PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+    ioctl(group->fds[PERF_CYCLES], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+
+    return true;
+}
+
+static void CloseGroup(Perf_Group *const group) {
+    for (int i = 0; i < PERF_NUM_COUNTERS; i += 1) {
+        if (group->fds[i] != -1) {
+            close(group->fds[i]);
+            group->fds[i] = -1;
+        }
+    }
+}
+
+// `Jobs_WorkerFn` opening the group of each worker but 0, which `Perf_Init` opens itself.
+static void OpenWorkerGroup(void *const ctx, const int worker) {
+    Perf *const perf = ctx;
+
+    if (worker > 0) {
+        OpenGroup(&perf->groups[worker], false);
+    }
+}
+
+bool Perf_Init(Perf *const perf, const bool printFrames, Jobs *const jobs) {
+    memset(perf, 0, sizeof(*perf));
+    perf->printFrames = printFrames;
+
+    if (!OpenGroup(&perf->groups[0], true)) {
+        return false;
+    }
+
+    perf->numGroups = 1;
+
+    if (jobs != NULL && jobs->numWorkers > 1) {
+        perf->numGroups = jobs->numWorkers;
+        Jobs_RunOnEachWorker(jobs, OpenWorkerGroup, perf);
+
+        int numMissing = 0;
+
+        for (int g = 1; g < perf->numGroups; g += 1) {
+            if (perf->groups[g].fds[PERF_CYCLES] == -1) {
+                numMissing += 1;
+            }
+        }
+
+        if (numMissing > 0) {
+            fprintf(stderr, "%s: Counters unavailable on %d of %d job workers. "
+                "Their work is not counted.\n", __func__, numMissing, perf->numGroups - 1);
+        }
+    }
+
+    perf->enabled = true;
+
+    return true;
+}
+
+void Perf_Deinit(Perf *const perf) {
+    for (int g = 0; g < perf->numGroups; g += 1) {
+        CloseGroup(&perf->groups[g]);
+    }
+
+    perf->numGroups = 0;
+    perf->enabled = false;
+}
+
+// Read all counters of `group` with one syscall into `reading`.
+// Return false if reading fails, printing to `stderr` the first time.
+static bool ReadCounts(Perf *const perf, const Perf_Group *const group, Perf_Reading *const reading) {
+    // Layout of PERF_FORMAT_GROUP | PERF_FORMAT_ID | PERF_FORMAT_TOTAL_TIME_*.
+    struct {
+        uint64_t nr;
+        uint64_t timeEnabled;
+        uint64_t timeRunning;
+        struct {
+            uint64_t value;
+            uint64_t id;
+        } values[PERF_NUM_COUNTERS];
+    } values;
+
+    const ssize_t numRead = read(group->fds[PERF_CYCLES], &values, sizeof(values));
+
+    if (numRead <= 0) {
+        if (perf->numFailedReads == 0) {
+            fprintf(stderr, "%s: read failed (%s). Skipping the stage.\n",
+                __func__, (numRead < 0) ? strerror(errno) : "no data");
+        }
+
+        perf->numFailedReads += 1;
+        return false;
+    }
+
+    reading->timeEnabled = values.timeEnabled;
+    reading->timeRunning = values.timeRunning;
+
+    // Values arrive in the order the counters were added to the group.
+    uint64_t k = 0;
+
+    for (int i = 0; i < PERF_NUM_COUNTERS; i += 1) {
+        if (group->fds[i] != -1 && k < values.nr) {
+            reading->values[i] = values.values[k].value;
+            k += 1;
+        }
+        else {
+            reading->values[i] = 0;
+        }
+    }
+
+    return true;
+}
+
+#else
+
+bool Perf_Init(Perf *const perf, const bool printFrames, Jobs *const jobs) {
+    (void)jobs;
+    memset(perf, 0, sizeof(*perf));
+    perf->printFrames = printFrames;
+
+    fprintf(stderr, "%s: Hardware counters are only supported on Linux. "
+        "Continuing without them.\n", __func__);
+
+    return false;
+}
+
+void Perf_Deinit(Perf *const perf) {
+    perf->enabled = false;
+}
+
+static bool ReadCounts(Perf *const perf, const Perf_Group *const group, Perf_Reading *const reading) {
+    (void)perf;
+    (void)group;
+    memset(reading, 0, sizeof(*reading));
+    return false;
+}
+
+#endif
+
+// Add the counts between readings `start` and `end` to `counts`. Return false
+// if the group was enabled but never on the hardware, so there are no counts.
+// If the group was multiplexed with other events in between, scale the counts
+// up to the whole time it was enabled. Raw values only grow, so the deltas are
+// taken before scaling: each reading has its own ratio of enabled to running.
+static bool AddStage(Perf *const perf, Perf_Counts *const counts,
+    const Perf_Reading *const start, const Perf_Reading *const end)
+{
+    const uint64_t enabled = end->timeEnabled - start->timeEnabled;
+    const uint64_t running = end->timeRunning - start->timeRunning;
+
+    if (running == 0) {
+        return enabled == 0;
+    }
+
+    const double scale = (double)enabled / (double)running;
+
+    if (running < enabled) {
+        perf->multiplexed = true;
+    }
+
+    for (int i = 0; i < PERF_NUM_COUNTERS; i += 1) {
+        const uint64_t delta = end->values[i] - start->values[i];
+
+        counts->values[i] += (running == enabled) ? delta : (uint64_t)((double)delta * scale);
+    }
+
+    return true;
+}
+
+void Perf_BeginStage(Perf *const perf, const Perf_Stage stage) {
+    (void)stage;
+
+    if (!perf->enabled) {
+        return;
+    }
+
+    for (int g = 0; g < perf->numGroups; g += 1) {
+        Perf_Group *const group = &perf->groups[g];
+
+        if (group->fds[PERF_CYCLES] != -1) {
+            group->stageStarted = ReadCounts(perf, group, &group->stageStart);
+        }
+    }
+}
+
+void Perf_EndStage(Perf *const perf, const Perf_Stage stage) {
+    if (!perf->enabled) {
+        return;
+    }
+
+    for (int g = 0; g < perf->numGroups; g += 1) {
+        Perf_Group *const group = &perf->groups[g];
+
+        if (!group->stageStarted) {
+            continue;
+        }
+
+        group->stageStarted = false;
+
+        Perf_Reading now;
+
+        // Only the main thread is sure to run during each stage.
+        if (ReadCounts(perf, group, &now)
+            && !AddStage(perf, &perf->frame[stage], &group->stageStart, &now) && g == 0)
+        {
+            perf->numUnscheduled += 1;
+        }
+    }
+}
+
+// Return `count` per thousand instructions.
+static double PerKiloInstr(const uint64_t count, const uint64_t instructions) {
+    return (instructions == 0) ? 0.0 : 1000.0 * (double)count / (double)instructions;
+}
+
+static double Ipc(const Perf_Counts *const counts) {
+    const uint64_t cycles = counts->values[PERF_CYCLES];
+
+    return (cycles == 0) ? 0.0 : (double)counts->values[PERF_INSTRUCTIONS] / (double)cycles;
+}
+
+static void PrintCounts(FILE *const file, const char *const label, const Perf_Counts *const c) {
+    const uint64_t instructions = c->values[PERF_INSTRUCTIONS];
+
+    fprintf(file, "%-8s %12llu cycles %12llu instr  IPC %5.2f  "
+        "L1d %7.2f  LLC %7.2f  br %7.2f (misses/kinstr)\n",
+        label,
+        (unsigned long long)c->values[PERF_CYCLES],
+        (unsigned long long)instructions,
+        Ipc(c),
+        PerKiloInstr(c->values[PERF_L1D_MISSES], instructions),
+        PerKiloInstr(c->values[PERF_LLC_MISSES], instructions),
+        PerKiloInstr(c->values[PERF_BRANCH_MISSES], instructions));
+}
+
+void Perf_EndFrame(Perf *const perf) {
+    if (!perf->enabled) {
+        return;
+    }
+
+    Perf_Counts frameTotal = { 0 };
+
+    for (int s = 0; s < PERF_NUM_STAGES; s += 1) {
+        for (int i = 0; i < PERF_NUM_COUNTERS; i += 1) {
+            frameTotal.values[i] += perf->frame[s].values[i];
+            perf->total[s].values[i] += perf->frame[s].values[i];
+        }
+    }
+
+    perf->numFrames += 1;
+
+    if (perf->printFrames) {
+        char label[32];
+        snprintf(label, sizeof(label), "f%llu", (unsigned long long)perf->numFrames);
+        PrintCounts(stdout, label, &frameTotal);
+    }
+
+    memset(perf->frame, 0, sizeof(perf->frame));
+}
+
+void Perf_PrintSummary(const Perf *const perf, FILE *const file) {
+    if (!perf->enabled || perf->numFrames == 0) {
+        return;
+    }
+
+    fprintf(file, "Hardware counters over %llu frames, summed over the main thread "
+        "and %d job workers:\n",
+        (unsigned long long)perf->numFrames, perf->numGroups - 1);
+
+    Perf_Counts all = { 0 };
+
+    for (int s = 0; s < PERF_NUM_STAGES; s += 1) {
+        PrintCounts(file, stageNames[s], &perf->total[s]);
+
+        for (int i = 0; i < PERF_NUM_COUNTERS; i += 1) {
+            all.values[i] += perf->total[s].values[i];
+        }
+    }
+
+    PrintCounts(file, "all", &all);
+
+    if (perf->multiplexed) {
+        fprintf(file, "(Counters were shared with other events. Counts are scaled estimates.)\n");
+    }
+
+    if (perf->numFailedReads > 0) {
+        fprintf(file, "(%llu stages are not counted since reading the counters failed.)\n",
+            (unsigned long long)perf->numFailedReads);
+    }
+
+    if (perf->numUnscheduled > 0) {
+        fprintf(file, "(%llu stages ran while other events had the counters and are not counted.)\n",
+            (unsigned long long)perf->numUnscheduled);
+    }
+
+    for (int i = 0; i < PERF_NUM_COUNTERS; i += 1) {
+        if (perf->groups[0].fds[i] == -1) {
+            fprintf(file, "(%s unavailable, shown as 0)\n", counterNames[i]);
+        }
+    }
+}
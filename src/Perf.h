@@ -0,0 +1,108 @@
+#ifndef PERF_H
+#define PERF_H
+
+// Optional hardware performance counters around the stages of a frame.
+// Built on Linux `perf_event_open`. Counts only user space, with one counter
+// group per job system worker, and sums the groups per stage. A stage's counts
+// therefore include its parallel work as well as whatever the workers ran or
+// spun on while it lasted. When the kernel multiplexes the counters with other
+// events, counts are scaled estimates.
+// When counters cannot be opened (other OS, containers, perf_event_paranoid,
+// virtual machines without a PMU) `Perf_Init` returns false and every other
+// function does nothing, so callers need no special casing.
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "Jobs.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef enum Perf_Stage {
+    PERF_STAGE_EVENTS,  // Polling and handling input.
+    PERF_STAGE_UPDATE,  // Moving the camera.
+    PERF_STAGE_PROJECT, // Projection, culling and line generation.
+    PERF_STAGE_DRAW,    // Submitting draw calls.
+    PERF_STAGE_PRESENT, // SDL_RenderPresent.
+    PERF_STAGE_CAPTURE, // Saving frames.
+    PERF_NUM_STAGES
+} Perf_Stage;
+
+typedef enum Perf_Counter {
+    PERF_CYCLES,
+    PERF_INSTRUCTIONS,
+    PERF_L1D_MISSES,
+    PERF_LLC_MISSES,
+    PERF_BRANCH_MISSES,
+    PERF_NUM_COUNTERS
+} Perf_Counter;
+
+typedef struct Perf_Counts {
+    uint64_t values[PERF_NUM_COUNTERS];
+} Perf_Counts;
+
+// Raw values of one read of the counter group, not yet scaled for multiplexing.
+typedef struct Perf_Reading {
+    uint64_t values[PERF_NUM_COUNTERS];
+    uint64_t timeEnabled; // Nanoseconds the group was enabled.
+    uint64_t timeRunning; // Nanoseconds the group was on the hardware.
+} Perf_Reading;
+
+// Counters of one thread.
+typedef struct Perf_Group {
+    // File descriptor per counter. -1 if that counter is unavailable.
+    // The cycles counter leads the group so all are read in one syscall.
+    int fds[PERF_NUM_COUNTERS];
+
+    Perf_Reading stageStart; // Snapshot taken by Perf_BeginStage.
+    bool stageStarted;       // Whether `stageStart` was read.
+} Perf_Group;
+
+typedef struct Perf {
+    bool enabled;
+
+    // Group of each job system worker, 0 being the thread that called Perf_Init.
+    // Workers whose cycles counter failed to open are not counted.
+    Perf_Group groups[JOBS_MAX_WORKERS];
+    int numGroups;
+
+    bool multiplexed;        // Whether the counters ever ran only part of a stage.
+    uint64_t numUnscheduled; // Stages the main thread's counters never ran during.
+    uint64_t numFailedReads; // Stages skipped because reading the counters failed.
+
+    Perf_Counts frame[PERF_NUM_STAGES]; // Counts of the current frame.
+    Perf_Counts total[PERF_NUM_STAGES]; // Counts of all ended frames.
+    uint64_t numFrames;
+
+    bool printFrames; // Whether Perf_EndFrame prints a line per frame.
+} Perf;
+
+// Open the counters of the calling thread and, if `jobs` is not NULL, of each of
+// its workers. Must be called by worker 0 of `jobs` with no work pending.
+// Print to `stderr` and return false if unavailable.
+bool Perf_Init(Perf *const perf, const bool printFrames, Jobs *const jobs);
+
+// Close the counters.
+void Perf_Deinit(Perf *const perf);
+
+// Start counting `stage`. Stages must not nest.
+void Perf_BeginStage(Perf *const perf, const Perf_Stage stage);
+
+// Stop counting `stage` and add the counts to the current frame.
+void Perf_EndStage(Perf *const perf, const Perf_Stage stage);
+
+// Add the current frame to the totals and start a new frame.
+// Print the frame's IPC and miss rates if enabled.
+void Perf_EndFrame(Perf *const perf);
+
+// Print per-stage totals, IPC and misses per thousand instructions.
+void Perf_PrintSummary(const Perf *const perf, FILE *const file);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
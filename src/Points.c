@@ -0,0 +1,313 @@
+#include "Points.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "Mem.h"
+
+#define POINTS_MAGIC "OGPC"
+
+// Points read per `fread` while loading.
+#define POINTS_READ_BLOCK 65536
+
+// Bytes of one point in a file.
+#define POINTS_RECORD_SIZE 16
+
+// Points projected at a time before the visible ones are drawn.
+#define POINTS_BLOCK 256
+
+// Pixel of a point that is not drawn.
+#define POINTS_NO_PIXEL UINT32_MAX
+
+bool Points_Load(Points *const points, const char *const path) {
+    *points = (Points) { 0 };
+
+    FILE *const file = fopen(path, "rb");
+
+    if (file == NULL) {
+        fprintf(stderr, "%s: Failed to open %s\n", __func__, path);
+        return false;
+    }
+
+    uint8_t header[16];
+    uint32_t version;
+    uint64_t count;
+
+    if (fread(header, sizeof(header), 1, file) != 1 || memcmp(header, POINTS_MAGIC, 4) != 0) {
+        fprintf(stderr, "%s: %s is not a point cloud\n", __func__, path);
+        fclose(file);
+        return false;
+    }
+
+    // Like heightfield tiles, files are read as they are on little-endian machines.
+    memcpy(&version, header + 4, sizeof(version));
+    memcpy(&count, header + 8, sizeof(count));
+
+    if (version != POINTS_VERSION || count > SIZE_MAX / POINTS_RECORD_SIZE) {
+        fprintf(stderr, "%s: %s has unsupported version %u or size\n",
+            __func__, path, (unsigned)version);
+        fclose(file);
+        return false;
+    }
+
+    const size_t n = (size_t)count;
+    points->numPoints = n;
+    points->x = Mem_AllocTagged(n * sizeof(float), MEM_TAG_POINTS);
+    points->y = Mem_AllocTagged(n * sizeof(float), MEM_TAG_POINTS);
+    points->z = Mem_AllocTagged(n * sizeof(float), MEM_TAG_POINTS);
+    points->colors = Mem_AllocTagged(n * sizeof(uint32_t), MEM_TAG_POINTS);
+
+    uint8_t *const block = Mem_Alloc(POINTS_READ_BLOCK * POINTS_RECORD_SIZE);
+    bool ok = true;
+
+    points->min = (V3d) {INFINITY, INFINITY, INFINITY};
+    points->max = (V3d) {-INFINITY, -INFINITY, -INFINITY};
+
+    for (size_t first = 0; ok && first < n; first += POINTS_READ_BLOCK) {
+        const size_t numRead = (n - first < POINTS_READ_BLOCK) ? n - first : POINTS_READ_BLOCK;
+
+        if (fread(block, POINTS_RECORD_SIZE, numRead, file) != numRead) {
+            fprintf(stderr, "%s: %s is truncated\n", __func__, path);
+            ok = false;
+            break;
+        }
+
+        for (size_t k = 0; k < numRead; k += 1) {
+            const uint8_t *const record = block + k * POINTS_RECORD_SIZE;
+            const size_t i = first + k;
+
+            memcpy(&points->x[i], record, 4);
+            memcpy(&points->y[i], record + 4, 4);
+            memcpy(&points->z[i], record + 8, 4);
+            memcpy(&points->colors[i], record + 12, 4);
+
+            points->min.x = fmin(points->min.x, points->x[i]);
+            points->min.y = fmin(points->min.y, points->y[i]);
+            points->min.z = fmin(points->min.z, points->z[i]);
+            points->max.x = fmax(points->max.x, points->x[i]);
+            points->max.y = fmax(points->max.y, points->y[i]);
+            points->max.z = fmax(points->max.z, points->z[i]);
+        }
+    }
+
+    Mem_Free(block);
+    fclose(file);
+
+    if (!ok) {
+        Points_Deinit(points);
+    }
+
+    return ok;
+}
+
+void Points_Deinit(Points *const points) {
+    Mem_Free(points->x);
+    Mem_Free(points->y);
+    Mem_Free(points->z);
+    Mem_Free(points->colors);
+    *points = (Points) { 0 };
+}
+
+void Points_InitTarget(Points_Target *const target) {
+    *target = (Points_Target) { 0 };
+}
+
+void Points_DeinitTarget(Points_Target *const target) {
+    Mem_Free((void *)target->pixels);
+    *target = (Points_Target) { 0 };
+}
+
+void Points_ResizeTarget(Points_Target *const target, const int width, const int height) {
+    // The pixels are handed to SDL as plain 32-bit values.
+    _Static_assert(sizeof(_Atomic uint32_t) == sizeof(uint32_t), "Atomic pixels must be plain size");
+
+    const size_t numPixels = (size_t)width * (size_t)height;
+
+    if (numPixels > target->pixelsCap) {
+        Mem_Free((void *)target->pixels);
+        target->pixels = Mem_AllocLarge(numPixels * sizeof(uint32_t), MEM_TAG_POINTS);
+        target->pixelsCap = numPixels;
+    }
+
+    target->width = width;
+    target->height = height;
+}
+
+size_t Points_NumToDraw(const Points *const points, const Ortho_View *const view,
+    const double maxPerPixel)
+{
+    if (points->numPoints == 0) {
+        return 0;
+    }
+
+    double minX = INFINITY;
+    double minY = INFINITY;
+    double maxX = -INFINITY;
+    double maxY = -INFINITY;
+
+    for (int c = 0; c < 8; c += 1) {
+        const V3d corner = {
+            (c & 1) ? points->max.x : points->min.x,
+            (c & 2) ? points->max.y : points->min.y,
+            (c & 4) ? points->max.z : points->min.z
+        };
+        const V3d q = Ortho_Project(view, corner);
+
+        minX = fmin(minX, q.x);
+        minY = fmin(minY, q.y);
+        maxX = fmax(maxX, q.x);
+        maxY = fmax(maxY, q.y);
+    }
+
+    // Assume the points spread evenly over their projected box.
+    const double area = (maxX - minX + 1.0) * (maxY - minY + 1.0);
+    const double numToDraw = ceil(area * maxPerPixel);
+
+    return (numToDraw < (double)points->numPoints) ? (size_t)numToDraw : points->numPoints;
+}
+
+typedef struct DrawJob {
+    const Points *points;
+    Points_Target *target;
+
+    // The view as floats. Enough precision for pixels and faster over many points.
+    float origin[3];
+    float axisX[3];
+    float axisY[3];
+    float axisZ[3];
+
+    size_t numDrawn[POINTS_MAX_CHUNKS];
+} DrawJob;
+
+static void ClearRows(void *const ctx, const size_t chunk, const size_t begin, const size_t end) {
+    (void)chunk;
+
+    DrawJob *const job = ctx;
+    const size_t width = (size_t)job->target->width;
+
+    for (size_t i = begin * width; i < end * width; i += 1) {
+        atomic_store_explicit(&job->target->pixels[i], 0, memory_order_relaxed);
+    }
+}
+
+static void DrawChunk(void *const ctx, const size_t chunk, const size_t begin, const size_t end) {
+    DrawJob *const job = ctx;
+    const Points *const points = job->points;
+    Points_Target *const target = job->target;
+
+    // Copied to locals so the compiler knows stores do not change them.
+    const float ox = job->origin[0], oy = job->origin[1], oz = job->origin[2];
+    const float xx = job->axisX[0], xy = job->axisX[1], xz = job->axisX[2];
+    const float yx = job->axisY[0], yy = job->axisY[1], yz = job->axisY[2];
+    const float zx = job->axisZ[0], zy = job->axisZ[1], zz = job->axisZ[2];
+
+    const float width = (float)target->width;
+    const float height = (float)target->height;
+    const float maxX = width - 1.0f;
+    const float maxY = height - 1.0f;
+    const int32_t rowPixels = target->width;
+
+    // Pixel of each point of the current block, then which of them are visible.
+    uint32_t pixels[POINTS_BLOCK];
+    uint32_t visible[POINTS_BLOCK];
+
+    size_t numDrawn = 0;
+
+    for (size_t blockBegin = begin; blockBegin < end; blockBegin += POINTS_BLOCK) {
+        const size_t count = (end - blockBegin < POINTS_BLOCK) ? end - blockBegin : POINTS_BLOCK;
+
+        const float *const xs = points->x + blockBegin;
+        const float *const ys = points->y + blockBegin;
+        const float *const zs = points->z + blockBegin;
+
+        // No branches or calls, so this loop vectorizes.
+        for (size_t k = 0; k < count; k += 1) {
+            // Shift by half a pixel so truncating rounds to the nearest pixel.
+            const float px = ox + xs[k] * xx + ys[k] * yx + zs[k] * zx + 0.5f;
+            const float py = oy + xs[k] * xy + ys[k] * yy + zs[k] * zy + 0.5f;
+            const float depth = oz + xs[k] * xz + ys[k] * yz + zs[k] * zz;
+
+            // Non-short-circuit so it does not branch. NaN is rejected too.
+            const bool isVisible = (depth > 0.0f) & (px >= 0.0f) & (px < width)
+                & (py >= 0.0f) & (py < height);
+
+            // Clamped so the conversion is defined for rejected points.
+            // Written as single selects so they compile to `minss`/`maxss`, unlike
+            // `fminf`/`fmaxf` which are library calls unless NaN can be ignored.
+            float cx = (px < maxX) ? px : maxX;
+            float cy = (py < maxY) ? py : maxY;
+            cx = (cx > -1.0f) ? cx : -1.0f;
+            cy = (cy > -1.0f) ? cy : -1.0f;
+
+            const int32_t pixel = (int32_t)cy * rowPixels + (int32_t)cx;
+            pixels[k] = isVisible ? (uint32_t)pixel : POINTS_NO_PIXEL;
+        }
+
+        // Whether a point is on screen is close to random, so branching on it
+        // mispredicts often. Every point is appended and the count only advances
+        // past visible ones.
+        size_t numVisible = 0;
+
+        for (size_t k = 0; k < count; k += 1) {
+            visible[numVisible] = (uint32_t)k;
+            numVisible += (pixels[k] != POINTS_NO_PIXEL);
+        }
+
+        const uint32_t *const colors = points->colors + blockBegin;
+
+        for (size_t v = 0; v < numVisible; v += 1) {
+            const uint32_t k = visible[v];
+            atomic_store_explicit(&target->pixels[pixels[k]], colors[k], memory_order_relaxed);
+        }
+
+        numDrawn += numVisible;
+    }
+
+    job->numDrawn[chunk] = numDrawn;
+}
+
+size_t Points_Draw(const Points *const points, const Ortho_View *const view,
+    const size_t numToDraw, Jobs *const jobs, Points_Target *const target)
+{
+    DrawJob job = {
+        .points = points,
+        .target = target,
+        .origin = {(float)view->origin.x, (float)view->origin.y, (float)view->origin.z},
+        .axisX = {(float)view->axisX.x, (float)view->axisX.y, (float)view->axisX.z},
+        .axisY = {(float)view->axisY.x, (float)view->axisY.y, (float)view->axisY.z},
+        .axisZ = {(float)view->axisZ.x, (float)view->axisZ.y, (float)view->axisZ.z}
+    };
+
+    Jobs_Counter counter;
+    Jobs_InitCounter(&counter);
+
+    const size_t numRows = (size_t)target->height;
+    const size_t rowsPerChunk = (numRows + POINTS_MAX_CHUNKS - 1) / POINTS_MAX_CHUNKS;
+
+    if (numRows > 0) {
+        Jobs_ParallelFor(jobs, &counter, numRows, rowsPerChunk, ClearRows, &job);
+        Jobs_Wait(jobs, &counter);
+    }
+
+    const size_t n = (numToDraw < points->numPoints) ? numToDraw : points->numPoints;
+
+    if (n == 0) {
+        return 0;
+    }
+
+    // Whole blocks per chunk, so only the last block of all is partial.
+    const size_t numBlocks = (n + POINTS_BLOCK - 1) / POINTS_BLOCK;
+    const size_t chunkSize = (numBlocks + POINTS_MAX_CHUNKS - 1) / POINTS_MAX_CHUNKS * POINTS_BLOCK;
+
+    Jobs_ParallelFor(jobs, &counter, n, chunkSize, DrawChunk, &job);
+    Jobs_Wait(jobs, &counter);
+
+    size_t numDrawn = 0;
+
+    for (size_t k = 0; k < Jobs_NumChunks(n, chunkSize); k += 1) {
+        numDrawn += job.numDrawn[k];
+    }
+
+    return numDrawn;
+}
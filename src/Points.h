@@ -0,0 +1,92 @@
+#ifndef POINTS_H
+#define POINTS_H
+
+// Point cloud drawn straight into a pixel buffer.
+//
+// Points are stored as separate arrays of x, y, z and color so projection
+// runs over them in lockstep. Drawing splits the points into chunks on the
+// job system. Each point is projected and tested against the screen, then
+// its color is stored to its pixel. Chunks store concurrently, so when points
+// share a pixel, which of them shows is not defined and may differ per frame.
+// When zoomed out, only the first points are drawn (see `Points_NumToDraw`).
+//
+// File format, all little-endian:
+//  char[4] magic "OGPC"
+//  u32     version (POINTS_VERSION)
+//  u64     number of points
+//  Per point: f32 x, f32 y, f32 z, u32 color 0xAARRGGBB
+// Decimation draws the first points of the file, so they should be in random
+// order, e.g. shuffled, for any number of first points to cover the whole cloud.
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "Jobs.h"
+#include "Ortho.h"
+#include "V3d.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define POINTS_VERSION 1
+
+// Most chunks drawing is split into.
+#define POINTS_MAX_CHUNKS 256
+
+typedef struct Points {
+    size_t numPoints;
+    float *x;
+    float *y;
+    float *z;
+    uint32_t *colors; // 0xAARRGGBB.
+
+    // Bounding box of all points.
+    V3d min;
+    V3d max;
+} Points;
+
+// Pixels written by any number of threads at once, so they are atomic.
+// Relaxed stores compile to plain stores. Pixels are 0xAARRGGBB, rows from the top.
+// Pixels without a point have alpha 0.
+typedef struct Points_Target {
+    _Atomic uint32_t *pixels;
+    int width;
+    int height;
+    size_t pixelsCap;
+} Points_Target;
+
+// Read the point cloud at `path`.
+// If error, print to `stderr` and return false.
+bool Points_Load(Points *const points, const char *const path);
+
+// Free the internals of `points`.
+void Points_Deinit(Points *const points);
+
+// Initialize `target` as empty.
+void Points_InitTarget(Points_Target *const target);
+
+// Free the internals of `target`.
+void Points_DeinitTarget(Points_Target *const target);
+
+// Set the size. Keeps the allocation if it is big enough.
+void Points_ResizeTarget(Points_Target *const target, const int width, const int height);
+
+// Return how many points to draw for about `maxPerPixel` points per covered pixel,
+// estimated from the projected bounding box of `points`.
+size_t Points_NumToDraw(const Points *const points, const Ortho_View *const view,
+    const double maxPerPixel);
+
+// Clear `target` and draw the first `numToDraw` points into it, on `jobs`.
+// `target` must have the screen size of `view`.
+// Return the number of points drawn.
+size_t Points_Draw(const Points *const points, const Ortho_View *const view,
+    const size_t numToDraw, Jobs *const jobs, Points_Target *const target);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
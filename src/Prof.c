@@ -0,0 +1,309 @@
+#if defined(__linux__)
+// For `dladdr`.
+#define _GNU_SOURCE
+#endif
+
+#include "Prof.h"
+
+#if defined(__linux__)
+
+#include <dlfcn.h>
+#include <errno.h>
+#include <execinfo.h>
+#include <signal.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+#include <threads.h>
+#include <time.h>
+
+#include "Mem.h"
+
+// Frames of the signal handler and the kernel's signal trampoline.
+#define PROF_SKIP_FRAMES 2
+
+typedef struct Sample {
+    uint32_t depth;
+    void *frames[PROF_MAX_DEPTH]; // Innermost first, as from `backtrace`.
+} Sample;
+
+// Shared with the signal handler, which may run on any thread.
+static Sample *samples;
+static atomic_size_t numClaimed;     // Slots claimed. Can exceed PROF_MAX_SAMPLES.
+static atomic_bool paused;
+static atomic_int numInHandler;
+static atomic_uint_fast64_t numSignals;
+static atomic_uint_fast64_t numDropped;
+static atomic_uint_fast64_t handlerNs;
+
+static bool running;
+static int rateHz;
+static uint64_t startCpuNs; // CPU time of the process when sampling started.
+static uint64_t numWritten;
+
+static uint64_t GetNs(const clockid_t clock) {
+    struct timespec ts;
+    clock_gettime(clock, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+// Only async-signal-safe work in here. `backtrace` is safe once libgcc
+// is loaded, which `Prof_Start` makes sure of.
+static void HandleSignal(const int signum) {
+    (void)signum;
+    const int savedErrno = errno;
+
+    atomic_fetch_add(&numInHandler, 1);
+
+    if (!atomic_load(&paused)) {
+        const uint64_t startNs = GetNs(CLOCK_MONOTONIC);
+        atomic_fetch_add_explicit(&numSignals, 1, memory_order_relaxed);
+
+        const size_t slot = atomic_fetch_add_explicit(&numClaimed, 1, memory_order_relaxed);
+
+        if (slot < PROF_MAX_SAMPLES) {
+            void *frames[PROF_MAX_DEPTH + PROF_SKIP_FRAMES];
+            const int depth = backtrace(frames, PROF_MAX_DEPTH + PROF_SKIP_FRAMES);
+            const int kept = (depth > PROF_SKIP_FRAMES) ? depth - PROF_SKIP_FRAMES : 0;
+
+            Sample *const sample = &samples[slot];
+            memcpy(sample->frames, frames + PROF_SKIP_FRAMES, (size_t)kept * sizeof(void *));
+            sample->depth = (uint32_t)kept;
+        }
+        else {
+            atomic_fetch_add_explicit(&numDropped, 1, memory_order_relaxed);
+        }
+
+        atomic_fetch_add_explicit(&handlerNs, GetNs(CLOCK_MONOTONIC) - startNs, memory_order_relaxed);
+    }
+
+    atomic_fetch_sub(&numInHandler, 1);
+    errno = savedErrno;
+}
+
+static bool SetTimer(const int hz) {
+    const long periodUs = (hz > 0) ? 1000000L / hz : 0;
+
+    struct itimerval timer = {
+        .it_interval = {.tv_sec = periodUs / 1000000L, .tv_usec = periodUs % 1000000L},
+        .it_value = {.tv_sec = periodUs / 1000000L, .tv_usec = periodUs % 1000000L}
+    };
+
+    return setitimer(ITIMER_PROF, &timer, NULL) == 0;
+}
+
+bool Prof_Start(const int hz) {
+    if (running) {
+        fprintf(stderr, "%s: Already running\n", __func__);
+        return false;
+    }
+
+    if (hz <= 0 || hz > 1000000) {
+        fprintf(stderr, "%s: Rate must be in [1, 1000000] Hz. Got %d\n", __func__, hz);
+        return false;
+    }
+
+    // The first call of `backtrace` loads libgcc, which allocates.
+    // Get that out of the way before it could happen in the handler.
+    void *warmup[4];
+    backtrace(warmup, 4);
+
+    samples = Mem_Alloc(PROF_MAX_SAMPLES * sizeof(Sample));
+    atomic_store(&numClaimed, 0);
+    atomic_store(&numSignals, 0);
+    atomic_store(&numDropped, 0);
+    atomic_store(&handlerNs, 0);
+    atomic_store(&paused, false);
+    numWritten = 0;
+
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = HandleSignal;
+    action.sa_flags = SA_RESTART;
+    sigemptyset(&action.sa_mask);
+
+    if (sigaction(SIGPROF, &action, NULL) != 0 || !SetTimer(hz)) {
+        fprintf(stderr, "%s: Failed to set up SIGPROF timer: %s\n", __func__, strerror(errno));
+        Mem_Free(samples);
+        samples = NULL;
+        return false;
+    }
+
+    running = true;
+    rateHz = hz;
+    startCpuNs = GetNs(CLOCK_PROCESS_CPUTIME_ID);
+    return true;
+}
+
+// Stop taking samples and wait for handlers that already started.
+static void Pause(void) {
+    atomic_store(&paused, true);
+
+    while (atomic_load(&numInHandler) > 0) {
+        thrd_yield();
+    }
+}
+
+void Prof_Stop(void) {
+    if (!running) {
+        return;
+    }
+
+    SetTimer(0);
+    Pause();
+    signal(SIGPROF, SIG_IGN);
+
+    Mem_Free(samples);
+    samples = NULL;
+    running = false;
+}
+
+bool Prof_IsRunning(void) {
+    return running;
+}
+
+// Order samples by stack so equal stacks are next to each other.
+static int CompareSamples(const void *const a, const void *const b) {
+    const Sample *const sa = a;
+    const Sample *const sb = b;
+
+    if (sa->depth != sb->depth) {
+        return (sa->depth < sb->depth) ? -1 : 1;
+    }
+
+    return memcmp(sa->frames, sb->frames, sa->depth * sizeof(void *));
+}
+
+// Write the name of the function containing `addr`.
+static void WriteFrameName(FILE *const file, const void *const addr) {
+    Dl_info info;
+
+    // `info` is only written if the address is in a loaded object.
+    if (dladdr(addr, &info) == 0) {
+        fprintf(file, "0x%lx", (unsigned long)addr);
+    }
+    else if (info.dli_sname != NULL) {
+        fputs(info.dli_sname, file);
+    }
+    else if (info.dli_fname != NULL) {
+        const char *const slash = strrchr(info.dli_fname, '/');
+        fprintf(file, "%s+0x%lx", (slash != NULL) ? slash + 1 : info.dli_fname,
+            (unsigned long)((const char *)addr - (const char *)info.dli_fbase));
+    }
+    else {
+        fprintf(file, "0x%lx", (unsigned long)addr);
+    }
+}
+
+static void WriteStack(FILE *const file, const Sample *const sample, const size_t count) {
+    if (sample->depth == 0) {
+        fprintf(file, "[unknown] %zu\n", count);
+        return;
+    }
+
+    // Folded stacks go from the root to the leaf.
+    for (uint32_t k = sample->depth; k > 0; k -= 1) {
+        // Outer frames hold return addresses, which may point past the end of
+        // the calling function. Look up the call instruction instead.
+        const char *addr = sample->frames[k - 1];
+
+        if (k - 1 > 0) {
+            addr -= 1;
+        }
+
+        WriteFrameName(file, addr);
+        fputc((k > 1) ? ';' : ' ', file);
+    }
+
+    fprintf(file, "%zu\n", count);
+}
+
+bool Prof_WriteFolded(const char *const path) {
+    if (!running) {
+        return false;
+    }
+
+    Pause();
+
+    const size_t claimed = atomic_load(&numClaimed);
+    const size_t n = (claimed < PROF_MAX_SAMPLES) ? claimed : PROF_MAX_SAMPLES;
+
+    qsort(samples, n, sizeof(Sample), CompareSamples);
+
+    FILE *const file = fopen(path, "w");
+    bool ok = (file != NULL);
+
+    if (ok) {
+        for (size_t i = 0; i < n; ) {
+            size_t j = i + 1;
+
+            while (j < n && CompareSamples(&samples[i], &samples[j]) == 0) {
+                j += 1;
+            }
+
+            WriteStack(file, &samples[i], j - i);
+            i = j;
+        }
+
+        ok = (fclose(file) == 0);
+    }
+
+    if (!ok) {
+        fprintf(stderr, "%s: Failed to write %s\n", __func__, path);
+    }
+
+    numWritten += n;
+    atomic_store(&numClaimed, 0);
+    atomic_store(&paused, false);
+
+    return ok;
+}
+
+void Prof_PrintStats(FILE *const file) {
+    if (!running) {
+        return;
+    }
+
+    const uint64_t signals = atomic_load(&numSignals);
+    const uint64_t dropped = atomic_load(&numDropped);
+    const uint64_t ns = atomic_load(&handlerNs);
+
+    const double cpuNs = (double)(GetNs(CLOCK_PROCESS_CPUTIME_ID) - startCpuNs);
+
+    // The kernel checks CPU timers on its scheduler tick, which can cap the rate.
+    fprintf(file, "Profiler at %d Hz (%.0f Hz achieved): "
+        "%llu samples, %llu written, %llu dropped (buffer full)\n",
+        rateHz, (cpuNs > 0.0) ? (double)signals * 1e9 / cpuNs : 0.0,
+        (unsigned long long)signals, (unsigned long long)numWritten,
+        (unsigned long long)dropped);
+    fprintf(file, "  handler avg %.2f us, overhead %.3f%% of CPU time\n",
+        (signals > 0) ? (double)ns / (double)signals / 1e3 : 0.0,
+        (cpuNs > 0.0) ? 100.0 * (double)ns / cpuNs : 0.0);
+}
+
+#else
+
+bool Prof_Start(const int hz) {
+    (void)hz;
+    fprintf(stderr, "%s: Profiler needs Linux\n", __func__);
+    return false;
+}
+
+void Prof_Stop(void) {
+}
+
+bool Prof_IsRunning(void) {
+    return false;
+}
+
+bool Prof_WriteFolded(const char *const path) {
+    (void)path;
+    return false;
+}
+
+void Prof_PrintStats(FILE *const file) {
+    (void)file;
+}
+
+#endif
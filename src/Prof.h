@@ -0,0 +1,57 @@
+#ifndef PROF_H
+#define PROF_H
+
+// Optional in-process sampling profiler.
+//
+// A `SIGPROF` timer (`setitimer(ITIMER_PROF)`) interrupts whichever thread of
+// the process is using CPU time. The signal handler records the call stack with
+// `backtrace` into a preallocated buffer, claiming a slot with one atomic add,
+// so nothing is locked or allocated while sampling. Samples are aggregated and
+// written as folded stacks (one `root;caller;callee count` line per stack),
+// the input format of flamegraph tools.
+//
+// Function names come from the dynamic symbol table (`dladdr`), so link with
+// `-rdynamic` to see names of non-static functions. Other frames are written as
+// `module+0xoffset`, which `addr2line -f -e module offset` resolves.
+//
+// Linux only. Elsewhere `Prof_Start` returns false and every other function does nothing.
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Deepest call stack recorded. Deeper stacks keep their innermost frames.
+#define PROF_MAX_DEPTH 48
+
+// Samples held before further samples are dropped. Writing the samples empties the buffer.
+#define PROF_MAX_SAMPLES (1 << 16)
+
+// Start sampling `hz` times per second of CPU time used by the process.
+// Higher rates give more detail at more overhead.
+// Print to `stderr` and return false if the profiler cannot run.
+bool Prof_Start(const int hz);
+
+// Stop sampling and free the buffer.
+void Prof_Stop(void);
+
+// Return true if sampling.
+bool Prof_IsRunning(void);
+
+// Write the samples taken since the last write to `path` as folded stacks
+// and empty the buffer. Sampling pauses while writing.
+// If error, print to `stderr` and return false.
+bool Prof_WriteFolded(const char *const path);
+
+// Print sample counts, the rate achieved and the time spent in the signal
+// handler as a share of the CPU time used since `Prof_Start`.
+void Prof_PrintStats(FILE *const file);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,157 @@
+#include "Raster.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "Mem.h"
+
+void Raster_Init(Raster *const raster) {
+    *raster = (Raster) { 0 };
+}
+
+void Raster_Deinit(Raster *const raster) {
+    Mem_Free(raster->pixels);
+    *raster = (Raster) { 0 };
+}
+
+void Raster_Resize(Raster *const raster, const int width, const int height) {
+    const size_t numPixels = (size_t)width * (size_t)height;
+
+    if (numPixels > raster->pixelsCap) {
+        Mem_Free(raster->pixels);
+        raster->pixels = Mem_AllocLarge(numPixels * sizeof(uint32_t), MEM_TAG_OTHER);
+        raster->pixelsCap = numPixels;
+    }
+
+    raster->width = width;
+    raster->height = height;
+}
+
+void Raster_Clear(Raster *const raster, const Rgba color) {
+    const uint32_t pixel = Raster_Pixel(color);
+    const size_t numPixels = (size_t)raster->width * (size_t)raster->height;
+
+    for (size_t i = 0; i < numPixels; i += 1) {
+        raster->pixels[i] = pixel;
+    }
+}
+
+void Raster_DrawLine(Raster *const raster, Lines_Seg seg, const uint32_t pixel) {
+    if (!Lines_Clip(&seg, raster->width, raster->height)) {
+        return;
+    }
+
+    // Bresenham. Both endpoints are inside after clipping.
+    int x = (int)lroundf(seg.x1);
+    int y = (int)lroundf(seg.y1);
+    const int x2 = (int)lroundf(seg.x2);
+    const int y2 = (int)lroundf(seg.y2);
+
+    const int dx = abs(x2 - x);
+    const int dy = -abs(y2 - y);
+    const int sx = (x < x2) ? 1 : -1;
+    const int sy = (y < y2) ? raster->width : -raster->width;
+    const int stepY = (y < y2) ? 1 : -1;
+
+    uint32_t *p = raster->pixels + (size_t)y * (size_t)raster->width + (size_t)x;
+    int err = dx + dy;
+
+    while (true) {
+        *p = pixel;
+
+        if (x == x2 && y == y2) {
+            break;
+        }
+
+        const int e2 = 2 * err;
+
+        if (e2 >= dy) {
+            err += dy;
+            x += sx;
+            p += sx;
+        }
+
+        if (e2 <= dx) {
+            err += dx;
+            y += stepY;
+            p += sy;
+        }
+    }
+}
+
+void Raster_DrawLines(Raster *const raster, const Lines *const lines) {
+    for (size_t r = 0; r < lines->numRuns; r += 1) {
+        const Lines_Run *const run = &lines->runs[r];
+        const uint32_t pixel = Raster_Pixel(run->color);
+
+        for (size_t i = run->start; i < run->start + run->count; i += 1) {
+            Raster_DrawLine(raster, lines->segs[i], pixel);
+        }
+    }
+}
+
+static void Put16(uint8_t *const p, const uint32_t v) {
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+}
+
+static void Put32(uint8_t *const p, const uint32_t v) {
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+    p[2] = (uint8_t)(v >> 16);
+    p[3] = (uint8_t)(v >> 24);
+}
+
+bool Raster_WriteBmp(const Raster *const raster, const char *const path) {
+    // BITMAPFILEHEADER and BITMAPINFOHEADER.
+    enum { FILE_HEADER = 14, INFO_HEADER = 40 };
+
+    const uint32_t dataSize = (uint32_t)raster->width * (uint32_t)raster->height * 4u;
+    uint8_t header[FILE_HEADER + INFO_HEADER] = { 0 };
+
+    header[0] = 'B';
+    header[1] = 'M';
+    Put32(header + 2, FILE_HEADER + INFO_HEADER + dataSize);
+    Put32(header + 10, FILE_HEADER + INFO_HEADER);
+
+    Put32(header + 14, INFO_HEADER);
+    Put32(header + 18, (uint32_t)raster->width);
+    Put32(header + 22, (uint32_t)-raster->height); // Negative: rows go top to bottom.
+    Put16(header + 26, 1);  // Planes.
+    Put16(header + 28, 32); // Bits per pixel.
+    Put32(header + 34, dataSize);
+
+    FILE *const file = fopen(path, "wb");
+
+    if (file == NULL) {
+        fprintf(stderr, "%s: Failed to open %s\n", __func__, path);
+        return false;
+    }
+
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    bool ok = fwrite(header, sizeof(header), 1, file) == 1;
+
+    for (size_t i = 0; ok && i < (size_t)raster->width * (size_t)raster->height; i += 1) {
+        uint8_t bytes[4];
+        Put32(bytes, raster->pixels[i]);
+        ok = fwrite(bytes, 4, 1, file) == 1;
+    }
+#else
+    // Pixels are already in file order. Let stdio write them straight from the raster.
+    setvbuf(file, NULL, _IONBF, 0);
+
+    bool ok = fwrite(header, sizeof(header), 1, file) == 1;
+    ok = ok && fwrite(raster->pixels, dataSize, 1, file) == 1;
+#endif
+
+    if (fclose(file) != 0) {
+        ok = false;
+    }
+
+    if (!ok) {
+        fprintf(stderr, "%s: Failed to write %s\n", __func__, path);
+    }
+
+    return ok;
+}
@@ -0,0 +1,59 @@
+#ifndef RASTER_H
+#define RASTER_H
+
+// Software render target. 32-bit pixels, no SDL.
+// Used where there is no window, e.g. rendering offline on many threads.
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "Lines.h"
+#include "Rgba.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Pixels are 0xAARRGGBB, row by row from the top, `width` pixels per row.
+// In memory on little-endian machines that is B, G, R, A as BMP expects.
+typedef struct Raster {
+    uint32_t *pixels;
+    int width;
+    int height;
+    size_t pixelsCap; // Number of pixels `pixels` has room for.
+} Raster;
+
+// Initialize `raster` as empty.
+void Raster_Init(Raster *const raster);
+
+// Free the internals of `raster`.
+void Raster_Deinit(Raster *const raster);
+
+// Set the size. Keeps the allocation if it is big enough. Contents are undefined.
+void Raster_Resize(Raster *const raster, const int width, const int height);
+
+// Return `color` as a pixel value.
+static inline uint32_t Raster_Pixel(const Rgba color) {
+    return ((uint32_t)color.a << 24) | ((uint32_t)color.r << 16)
+        | ((uint32_t)color.g << 8) | (uint32_t)color.b;
+}
+
+// Fill the whole raster with `color`.
+void Raster_Clear(Raster *const raster, const Rgba color);
+
+// Draw a one pixel wide line including both endpoints. Clipped to the raster.
+void Raster_DrawLine(Raster *const raster, Lines_Seg seg, const uint32_t pixel);
+
+// Draw every segment of `lines` using the color of its run.
+void Raster_DrawLines(Raster *const raster, const Lines *const lines);
+
+// Write the raster to `path` as a 32-bit top-down .bmp.
+// The pixels are written as they are, without encoding or copying.
+// Print to stderr and return false if error.
+bool Raster_WriteBmp(const Raster *const raster, const char *const path);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,538 @@
+#include "Replay.h"
+
+#include <inttypes.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "Clock.h"
+#include "Mem.h"
+
+#define REPLAY_MAGIC "OGRP"
+
+// Bytes of a frame record before its tokens, including the size field.
+#define REPLAY_FRAME_HEADER (4 + 8 + 2 + 2)
+
+// Top bit of a token count marks a run.
+#define REPLAY_RUN_BIT 0x80000000u
+
+// Most pixels one token covers.
+#define REPLAY_MAX_COUNT 0x7FFFFFFFu
+
+// Shortest repeat stored as a run. A run token is 8 bytes, so with 3 or more
+// the encoding is never bigger than the pixels plus one token.
+#define REPLAY_MIN_RUN 3
+
+static uint8_t *Put16(uint8_t *const p, const uint16_t v) {
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+    return p + 2;
+}
+
+static uint8_t *Put32(uint8_t *const p, const uint32_t v) {
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+    p[2] = (uint8_t)(v >> 16);
+    p[3] = (uint8_t)(v >> 24);
+    return p + 4;
+}
+
+static uint8_t *Put64(uint8_t *const p, const uint64_t v) {
+    Put32(p, (uint32_t)v);
+    return Put32(p + 4, (uint32_t)(v >> 32));
+}
+
+static uint16_t Get16(const uint8_t *const p) {
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static uint32_t Get32(const uint8_t *const p) {
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static uint64_t Get64(const uint8_t *const p) {
+    return (uint64_t)Get32(p) | ((uint64_t)Get32(p + 4) << 32);
+}
+
+// Copy `n` pixels to `out` in file order. Return the end.
+static uint8_t *PutPixels(uint8_t *const out, const uint32_t *const pixels, const size_t n) {
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    for (size_t i = 0; i < n; i += 1) {
+        Put32(out + 4 * i, pixels[i]);
+    }
+#else
+    memcpy(out, pixels, n * sizeof(uint32_t));
+#endif
+
+    return out + n * sizeof(uint32_t);
+}
+
+// Append literal tokens for `n` pixels. Return the end.
+static uint8_t *PutLiteral(uint8_t *p, const uint32_t *pixels, size_t n) {
+    while (n > 0) {
+        const size_t count = (n < REPLAY_MAX_COUNT) ? n : REPLAY_MAX_COUNT;
+
+        p = Put32(p, (uint32_t)count);
+        p = PutPixels(p, pixels, count);
+        pixels += count;
+        n -= count;
+    }
+
+    return p;
+}
+
+size_t Replay_MaxEncodedSize(const size_t numPixels) {
+    // Every pixel in a literal, plus the tokens split at the largest count
+    // and the one before each run.
+    return numPixels * sizeof(uint32_t) + 8 * (numPixels / REPLAY_MAX_COUNT + 2);
+}
+
+size_t Replay_Encode(const uint32_t *const pixels, const size_t numPixels, uint8_t *const out) {
+    uint8_t *p = out;
+    size_t literalStart = 0;
+    size_t i = 0;
+
+    while (i < numPixels) {
+        const uint32_t v = pixels[i];
+        size_t j = i + 1;
+
+        while (j < numPixels && pixels[j] == v) {
+            j += 1;
+        }
+
+        if (j - i >= REPLAY_MIN_RUN) {
+            p = PutLiteral(p, pixels + literalStart, i - literalStart);
+
+            for (size_t n = j - i; n > 0; ) {
+                const size_t count = (n < REPLAY_MAX_COUNT) ? n : REPLAY_MAX_COUNT;
+
+                p = Put32(p, REPLAY_RUN_BIT | (uint32_t)count);
+                p = Put32(p, v);
+                n -= count;
+            }
+
+            literalStart = j;
+        }
+
+        i = j;
+    }
+
+    p = PutLiteral(p, pixels + literalStart, numPixels - literalStart);
+
+    return (size_t)(p - out);
+}
+
+bool Replay_Decode(const uint8_t *const data, const size_t size,
+    uint32_t *const pixels, const size_t numPixels)
+{
+    const uint8_t *p = data;
+    const uint8_t *const end = data + size;
+    size_t at = 0;
+
+    while (end - p >= 4) {
+        const uint32_t token = Get32(p);
+        const size_t count = token & REPLAY_MAX_COUNT;
+        p += 4;
+
+        if (count > numPixels - at) {
+            return false;
+        }
+
+        if ((token & REPLAY_RUN_BIT) != 0) {
+            if (end - p < 4) {
+                return false;
+            }
+
+            const uint32_t v = Get32(p);
+            p += 4;
+
+            for (size_t i = 0; i < count; i += 1) {
+                pixels[at + i] = v;
+            }
+        }
+        else {
+            if ((size_t)(end - p) / 4 < count) {
+                return false;
+            }
+
+            for (size_t i = 0; i < count; i += 1) {
+                pixels[at + i] = Get32(p + 4 * i);
+            }
+
+            p += 4 * count;
+        }
+
+        at += count;
+    }
+
+    return p == end && at == numPixels;
+}
+
+static void DropOldest(Replay *const replay) {
+    replay->entriesHead = (replay->entriesHead + 1) % replay->entriesCap;
+    replay->numEntries -= 1;
+}
+
+static const Replay_Entry *Oldest(const Replay *const replay) {
+    return &replay->entries[replay->entriesHead];
+}
+
+// Encode the frame in `slot` into the ring.
+static void Store(Replay *const replay, const Replay_Slot *const slot) {
+    const size_t numPixels = (size_t)slot->width * (size_t)slot->height;
+    const size_t maxSize = Replay_MaxEncodedSize(numPixels);
+
+    if (maxSize > replay->scratchCap) {
+        Mem_Free(replay->scratch);
+        replay->scratch = Mem_AllocLarge(maxSize, MEM_TAG_REPLAY);
+        replay->scratchCap = maxSize;
+    }
+
+    const size_t size = Replay_Encode(slot->pixels, numPixels, replay->scratch);
+    Replay_Stats *const stats = &replay->stats;
+
+    atomic_fetch_add_explicit(&stats->rawBytes, numPixels * sizeof(uint32_t), memory_order_relaxed);
+    atomic_fetch_add_explicit(&stats->compressedBytes, size, memory_order_relaxed);
+
+    if (size > replay->ringSize) {
+        atomic_fetch_add_explicit(&stats->numTooBig, 1, memory_order_relaxed);
+        return;
+    }
+
+    // Drop frames that are too old or have no room in the queue.
+    while (replay->numEntries > 0
+        && (slot->timeNs - Oldest(replay)->timeNs > replay->keepNs
+            || replay->numEntries == replay->entriesCap))
+    {
+        DropOldest(replay);
+    }
+
+    // Frames are not split, so wrap early if the frame does not fit before the end.
+    // Everything from the head to the end is older than the rest of the ring.
+    if (replay->ringHead + size > replay->ringSize) {
+        while (replay->numEntries > 0 && Oldest(replay)->offset >= replay->ringHead) {
+            DropOldest(replay);
+        }
+
+        replay->ringHead = 0;
+    }
+
+    // Drop the oldest frames where this one goes. Frames before the head are newer.
+    while (replay->numEntries > 0
+        && Oldest(replay)->offset >= replay->ringHead
+        && Oldest(replay)->offset < replay->ringHead + size)
+    {
+        DropOldest(replay);
+    }
+
+    memcpy(replay->ring + replay->ringHead, replay->scratch, size);
+
+    replay->entries[(replay->entriesHead + replay->numEntries) % replay->entriesCap] = (Replay_Entry) {
+        .offset = replay->ringHead,
+        .size = size,
+        .timeNs = slot->timeNs,
+        .width = slot->width,
+        .height = slot->height
+    };
+
+    replay->numEntries += 1;
+    replay->ringHead += size;
+}
+
+// Write the frames in the ring to `path`.
+static void WriteRing(const Replay *const replay, const char *const path) {
+    if (replay->numEntries == 0) {
+        fprintf(stdout, "No replay frames to save.\n");
+        return;
+    }
+
+    FILE *const file = fopen(path, "wb");
+
+    if (file == NULL) {
+        fprintf(stderr, "%s: Failed to open %s\n", __func__, path);
+        return;
+    }
+
+    uint8_t header[8];
+    memcpy(header, REPLAY_MAGIC, 4);
+    Put32(header + 4, REPLAY_VERSION);
+
+    bool ok = fwrite(header, sizeof(header), 1, file) == 1;
+    uint64_t numBytes = sizeof(header);
+
+    const uint64_t firstNs = Oldest(replay)->timeNs;
+    uint64_t lastNs = firstNs;
+
+    for (size_t i = 0; ok && i < replay->numEntries; i += 1) {
+        const Replay_Entry *const entry = &replay->entries[(replay->entriesHead + i) % replay->entriesCap];
+
+        uint8_t frameHeader[REPLAY_FRAME_HEADER];
+        uint8_t *p = Put32(frameHeader, (uint32_t)(REPLAY_FRAME_HEADER - 4 + entry->size));
+        p = Put64(p, entry->timeNs - firstNs);
+        p = Put16(p, (uint16_t)entry->width);
+        Put16(p, (uint16_t)entry->height);
+
+        ok = fwrite(frameHeader, sizeof(frameHeader), 1, file) == 1
+            && fwrite(replay->ring + entry->offset, entry->size, 1, file) == 1;
+
+        numBytes += sizeof(frameHeader) + entry->size;
+        lastNs = entry->timeNs;
+    }
+
+    if (fclose(file) != 0) {
+        ok = false;
+    }
+
+    if (!ok) {
+        fprintf(stderr, "%s: Failed to write %s\n", __func__, path);
+        return;
+    }
+
+    fprintf(stdout, "Saved replay of %zu frames (%.1f s, %.1f MiB) to %s\n",
+        replay->numEntries, (double)(lastNs - firstNs) / 1e9,
+        (double)numBytes / (1024.0 * 1024.0), path);
+}
+
+static int Compressor(void *arg) {
+    Replay *const replay = arg;
+
+    char path[REPLAY_PATH_LEN];
+
+    while (true) {
+        mtx_lock(&replay->mutex);
+
+        while (replay->numFilled == 0 && replay->savePath[0] == '\0' && !replay->quit) {
+            cnd_wait(&replay->cond, &replay->mutex);
+        }
+
+        if (replay->quit) {
+            mtx_unlock(&replay->mutex);
+            break;
+        }
+
+        // Frames first so a save includes the frames handed over before it.
+        if (replay->numFilled == 0) {
+            memcpy(path, replay->savePath, sizeof(path));
+            replay->savePath[0] = '\0';
+            mtx_unlock(&replay->mutex);
+
+            WriteRing(replay, path);
+            continue;
+        }
+
+        const int slot = replay->filled[replay->filledHead];
+        replay->filledHead = (replay->filledHead + 1) % REPLAY_POOL_SIZE;
+        replay->numFilled -= 1;
+
+        mtx_unlock(&replay->mutex);
+
+        const uint64_t startNs = Clock_GetTimeNs();
+        Store(replay, &replay->slots[slot]);
+
+        Replay_Stats *const stats = &replay->stats;
+        atomic_fetch_add_explicit(&stats->compressNs, Clock_GetTimeNs() - startNs, memory_order_relaxed);
+        atomic_fetch_add_explicit(&stats->numCompressed, 1, memory_order_relaxed);
+
+        mtx_lock(&replay->mutex);
+        replay->free[replay->numFree] = slot;
+        replay->numFree += 1;
+        mtx_unlock(&replay->mutex);
+    }
+
+    return 0;
+}
+
+void Replay_Init(Replay *const replay, const double seconds, const size_t ringBytes,
+    const int framesPerSec)
+{
+    *replay = (Replay) {
+        .keepNs = (uint64_t)(seconds * 1e9),
+        .numFree = REPLAY_POOL_SIZE,
+        .writing = -1,
+        .ring = Mem_AllocLarge(ringBytes, MEM_TAG_REPLAY),
+        .ringSize = ringBytes,
+        // Room for frames coming faster than expected, up to twice as fast.
+        .entriesCap = (size_t)(seconds * framesPerSec * 2.0) + 1
+    };
+
+    replay->entries = Mem_AllocTagged(replay->entriesCap * sizeof(Replay_Entry), MEM_TAG_REPLAY);
+
+    for (int i = 0; i < REPLAY_POOL_SIZE; i += 1) {
+        replay->free[i] = i;
+    }
+
+    atomic_init(&replay->stats.rawBytes, 0);
+    atomic_init(&replay->stats.compressedBytes, 0);
+    atomic_init(&replay->stats.compressNs, 0);
+    atomic_init(&replay->stats.numCompressed, 0);
+    atomic_init(&replay->stats.numTooBig, 0);
+
+    if (mtx_init(&replay->mutex, mtx_plain) != thrd_success
+        || cnd_init(&replay->cond) != thrd_success
+        || thrd_create(&replay->compressor, Compressor, replay) != thrd_success)
+    {
+        fprintf(stderr, "%s: Failed to start compressor thread\n", __func__);
+        exit(1);
+    }
+}
+
+void Replay_Deinit(Replay *const replay) {
+    mtx_lock(&replay->mutex);
+    replay->quit = true;
+    cnd_signal(&replay->cond);
+    mtx_unlock(&replay->mutex);
+
+    thrd_join(replay->compressor, NULL);
+
+    cnd_destroy(&replay->cond);
+    mtx_destroy(&replay->mutex);
+
+    for (int i = 0; i < REPLAY_POOL_SIZE; i += 1) {
+        Mem_Free(replay->slots[i].pixels);
+    }
+
+    Mem_Free(replay->scratch);
+    Mem_Free(replay->entries);
+    Mem_Free(replay->ring);
+
+    *replay = (Replay) { 0 };
+}
+
+uint32_t *Replay_BeginFrame(Replay *const replay, const int width, const int height) {
+    mtx_lock(&replay->mutex);
+
+    if (replay->numFree == 0) {
+        mtx_unlock(&replay->mutex);
+        replay->stats.numSkipped += 1;
+        return NULL;
+    }
+
+    replay->numFree -= 1;
+    replay->writing = replay->free[replay->numFree];
+
+    mtx_unlock(&replay->mutex);
+
+    // Free slots belong to the frame thread, so this needs no lock.
+    Replay_Slot *const slot = &replay->slots[replay->writing];
+    const size_t numPixels = (size_t)width * (size_t)height;
+
+    if (numPixels > slot->pixelsCap) {
+        Mem_Free(slot->pixels);
+        slot->pixels = Mem_AllocLarge(numPixels * sizeof(uint32_t), MEM_TAG_REPLAY);
+        slot->pixelsCap = numPixels;
+    }
+
+    slot->width = width;
+    slot->height = height;
+
+    return slot->pixels;
+}
+
+void Replay_EndFrame(Replay *const replay, const uint64_t timeNs) {
+    replay->slots[replay->writing].timeNs = timeNs;
+
+    mtx_lock(&replay->mutex);
+    replay->filled[(replay->filledHead + replay->numFilled) % REPLAY_POOL_SIZE] = replay->writing;
+    replay->numFilled += 1;
+    cnd_signal(&replay->cond);
+    mtx_unlock(&replay->mutex);
+
+    replay->writing = -1;
+    replay->stats.numFrames += 1;
+}
+
+void Replay_CancelFrame(Replay *const replay) {
+    mtx_lock(&replay->mutex);
+    replay->free[replay->numFree] = replay->writing;
+    replay->numFree += 1;
+    mtx_unlock(&replay->mutex);
+
+    replay->writing = -1;
+}
+
+void Replay_Save(Replay *const replay, const char *const path) {
+    mtx_lock(&replay->mutex);
+    snprintf(replay->savePath, sizeof(replay->savePath), "%s", path);
+    cnd_signal(&replay->cond);
+    mtx_unlock(&replay->mutex);
+}
+
+bool Replay_ReadHeader(FILE *const file) {
+    uint8_t header[8];
+
+    if (fread(header, sizeof(header), 1, file) != 1) {
+        fprintf(stderr, "%s: File too short\n", __func__);
+        return false;
+    }
+
+    if (memcmp(header, REPLAY_MAGIC, 4) != 0) {
+        fprintf(stderr, "%s: Not a replay file\n", __func__);
+        return false;
+    }
+
+    if (Get32(header + 4) != REPLAY_VERSION) {
+        fprintf(stderr, "%s: Unsupported version %" PRIu32 "\n", __func__, Get32(header + 4));
+        return false;
+    }
+
+    return true;
+}
+
+int Replay_ReadFrame(FILE *const file, Raster *const raster, uint64_t *const timeNs) {
+    uint8_t sizeBytes[4];
+
+    if (fread(sizeBytes, sizeof(sizeBytes), 1, file) != 1) {
+        return 0;
+    }
+
+    const uint32_t size = Get32(sizeBytes);
+
+    if (size < REPLAY_FRAME_HEADER - 4) {
+        fprintf(stderr, "%s: Bad frame size %" PRIu32 "\n", __func__, size);
+        return -1;
+    }
+
+    uint8_t *const buf = Mem_AllocTagged(size, MEM_TAG_REPLAY);
+
+    if (fread(buf, size, 1, file) != 1) {
+        fprintf(stderr, "%s: Truncated frame\n", __func__);
+        Mem_Free(buf);
+        return -1;
+    }
+
+    *timeNs = Get64(buf);
+    const int width = Get16(buf + 8);
+    const int height = Get16(buf + 10);
+
+    Raster_Resize(raster, width, height);
+
+    const bool ok = Replay_Decode(buf + REPLAY_FRAME_HEADER - 4, size - (REPLAY_FRAME_HEADER - 4),
+        raster->pixels, (size_t)width * (size_t)height);
+
+    Mem_Free(buf);
+
+    if (!ok) {
+        fprintf(stderr, "%s: Corrupt frame\n", __func__);
+        return -1;
+    }
+
+    return 1;
+}
+
+void Replay_PrintSummary(const Replay *const replay, FILE *const file) {
+    const Replay_Stats *const stats = &replay->stats;
+    const uint64_t rawBytes = atomic_load_explicit(&stats->rawBytes, memory_order_relaxed);
+    const uint64_t compressedBytes = atomic_load_explicit(&stats->compressedBytes, memory_order_relaxed);
+    const uint64_t compressNs = atomic_load_explicit(&stats->compressNs, memory_order_relaxed);
+    const uint64_t numTooBig = atomic_load_explicit(&stats->numTooBig, memory_order_relaxed);
+    const uint64_t numCompressed = atomic_load_explicit(&stats->numCompressed, memory_order_relaxed);
+
+    fprintf(file, "Replay: %" PRIu64 " frames recorded, %" PRIu64 " skipped (compressor behind), "
+        "%" PRIu64 " too big for the ring\n",
+        stats->numFrames, stats->numSkipped, numTooBig);
+
+    if (compressedBytes > 0) {
+        fprintf(file, "Replay: compressed %.1fx, %.2f ms per frame\n",
+            (double)rawBytes / (double)compressedBytes,
+            (numCompressed > 0) ? (double)compressNs / (double)numCompressed / 1e6 : 0.0);
+    }
+}
@@ -0,0 +1,169 @@
+#ifndef REPLAY_H
+#define REPLAY_H
+
+// Instant replay. Keeps the last few seconds of frames in memory, compressed,
+// so they can be saved after something worth keeping happened.
+//
+// The frame thread reads each frame's pixels straight into a pooled buffer
+// (`Replay_BeginFrame`, `Replay_EndFrame`). A compressor thread encodes them
+// into a fixed-size ring, dropping the oldest frames to make room or when
+// older than the kept duration. If the compressor falls behind, frames are
+// skipped instead of waiting for it. `Replay_Save` asks the compressor thread
+// to write the ring to a file, with no decoding.
+//
+// A replay file is a header followed by one record per frame, oldest first.
+// All values are little-endian.
+//
+//  Header:
+//   char[4] magic "OGRP"
+//   u32     version (REPLAY_VERSION)
+//
+//  Frame:
+//   u32     size of the rest of the record in bytes
+//   u64     time in nanoseconds since the first frame of the file
+//   u16     width
+//   u16     height
+//   Tokens until width * height pixels are covered. Each is a u32 count n
+//   with the top bit set for a run (one u32 pixel repeated n times),
+//   else a literal (n u32 pixels).
+//
+// Pixels are 0xAARRGGBB, row by row from the top.
+// Frames are encoded on their own, so any frame can be dropped from the ring.
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <threads.h>
+
+#include "Raster.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define REPLAY_VERSION 1
+
+// Raw frames that can wait for the compressor.
+#define REPLAY_POOL_SIZE 4
+
+// Longest path `Replay_Save` takes.
+#define REPLAY_PATH_LEN 512
+
+// Where a compressed frame is in the ring.
+typedef struct Replay_Entry {
+    size_t offset;
+    size_t size;
+    uint64_t timeNs;
+    int width;
+    int height;
+} Replay_Entry;
+
+// One raw frame buffer of the pool.
+typedef struct Replay_Slot {
+    uint32_t *pixels;
+    size_t pixelsCap;
+    int width;
+    int height;
+    uint64_t timeNs;
+} Replay_Slot;
+
+typedef struct Replay_Stats {
+    uint64_t numFrames;   // Handed to the compressor.
+    uint64_t numSkipped;  // Not recorded because the pool was full.
+
+    // Updated by the compressor thread.
+    atomic_uint_fast64_t rawBytes;
+    atomic_uint_fast64_t compressedBytes;
+    atomic_uint_fast64_t compressNs;
+    atomic_uint_fast64_t numCompressed;
+    atomic_uint_fast64_t numTooBig; // Frames that did not fit in the ring.
+} Replay_Stats;
+
+typedef struct Replay {
+    uint64_t keepNs; // Frames older than this are dropped.
+
+    // Pool of raw frames. Slots in `filled` wait for the compressor.
+    // Slots in `free` can be written by the frame thread. Both guarded by `mutex`.
+    Replay_Slot slots[REPLAY_POOL_SIZE];
+    int filled[REPLAY_POOL_SIZE];
+    int filledHead;
+    int numFilled;
+    int free[REPLAY_POOL_SIZE];
+    int numFree;
+    int writing; // Slot handed out by `Replay_BeginFrame`. -1 if none.
+
+    // Save request. Guarded by `mutex`. Empty if none.
+    char savePath[REPLAY_PATH_LEN];
+
+    mtx_t mutex;
+    cnd_t cond;
+    bool quit;
+    thrd_t compressor;
+
+    // Only touched by the compressor thread.
+    uint8_t *ring;
+    size_t ringSize;
+    size_t ringHead;       // Where the next frame goes.
+    Replay_Entry *entries; // Frames in the ring, oldest first, as a circular queue.
+    size_t entriesCap;
+    size_t entriesHead;
+    size_t numEntries;
+    uint8_t *scratch;      // One frame encoded before it is copied into the ring.
+    size_t scratchCap;
+
+    Replay_Stats stats;
+} Replay;
+
+// Keep up to `seconds` of frames in a ring of `ringBytes` and start the compressor thread.
+// Frames are expected at about `framesPerSec`. If error, print to `stderr` and exit.
+void Replay_Init(Replay *const replay, const double seconds, const size_t ringBytes,
+    const int framesPerSec);
+
+// Stop the compressor thread and free everything.
+void Replay_Deinit(Replay *const replay);
+
+// Return a buffer for a `width` x `height` frame to be filled with pixels,
+// `width` per row. Return NULL, skipping the frame, if the compressor is behind.
+// Call from the frame thread, then `Replay_EndFrame` if not NULL.
+uint32_t *Replay_BeginFrame(Replay *const replay, const int width, const int height);
+
+// Hand the frame from `Replay_BeginFrame`, shown at `timeNs`, to the compressor.
+void Replay_EndFrame(Replay *const replay, const uint64_t timeNs);
+
+// Give back the frame from `Replay_BeginFrame` without recording it.
+void Replay_CancelFrame(Replay *const replay);
+
+// Ask the compressor thread to write the frames it holds to `path`.
+// Returns at once. The result is printed when written.
+void Replay_Save(Replay *const replay, const char *const path);
+
+// Encode `numPixels` pixels as tokens into `out`, which has room for
+// `Replay_MaxEncodedSize(numPixels)` bytes. Return the number of bytes written.
+size_t Replay_Encode(const uint32_t *const pixels, const size_t numPixels, uint8_t *const out);
+
+// Return the most bytes `Replay_Encode` writes for `numPixels` pixels.
+size_t Replay_MaxEncodedSize(const size_t numPixels);
+
+// Decode `size` bytes of tokens into `numPixels` pixels.
+// Return false if the tokens do not cover exactly `numPixels` pixels.
+bool Replay_Decode(const uint8_t *const data, const size_t size,
+    uint32_t *const pixels, const size_t numPixels);
+
+// Read and check the header of a replay file.
+// If error, print to `stderr` and return false.
+bool Replay_ReadHeader(FILE *const file);
+
+// Read the next frame from `file` into `raster`, resizing it, and its time into `timeNs`.
+// Return 1 if a frame was read, 0 at the end of the file and -1 if error,
+// after printing to `stderr`.
+int Replay_ReadFrame(FILE *const file, Raster *const raster, uint64_t *const timeNs);
+
+// Print the frames recorded and skipped and the compression ratio to `file`.
+void Replay_PrintSummary(const Replay *const replay, FILE *const file);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,21 @@
+#ifndef RGBA_H
+#define RGBA_H
+
+// Color with 4 uint8_t channels
+
+#include <stdbool.h>
+#include <stdint.h>
+
+typedef struct Rgba {
+    uint8_t r;
+    uint8_t g;
+    uint8_t b;
+    uint8_t a;
+} Rgba;
+
+// Return true if all channels of a and b are equal
+static inline bool Rgba_Equal(const struct Rgba a, const struct Rgba b) {
+    return a.r == b.r && a.g == b.g && a.b == b.b && a.a == b.a;
+}
+
+#endif // RGBA_H
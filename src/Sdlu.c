@@ -230,6 +230,91 @@ void Sdlu_RenderDrawLine(SDL_Renderer *renderer, int x1, int y1, int x2, int y2)
     }
 }
 
+void Sdlu_RenderGeometry(SDL_Renderer *renderer, SDL_Texture *texture,
+    const SDL_Vertex *vertices, int numVertices, const int *indices, int numIndices)
+{
+    const int code = SDL_RenderGeometry(renderer, texture,
+        vertices, numVertices, indices, numIndices);
+
+    if (code != 0) {
+        fprintf(stderr, "%s: SDL_RenderGeometry returned %d instead of 0. "
+            "[numVertices: %d] [numIndices: %d] [Error: %s]\n",
+            __func__, code, numVertices, numIndices, SDL_GetError());
+
+        exit(1);
+    }
+}
+
+void Sdlu_RenderGeometryRaw(SDL_Renderer *renderer, SDL_Texture *texture,
+    const float *xy, int xyStride, const SDL_Color *color, int colorStride,
+    const float *uv, int uvStride, int numVertices, const int *indices, int numIndices)
+{
+    const int code = SDL_RenderGeometryRaw(renderer, texture,
+        xy, xyStride, color, colorStride, uv, uvStride,
+        numVertices, indices, numIndices, (int)sizeof(int));
+
+    if (code != 0) {
+        fprintf(stderr, "%s: SDL_RenderGeometryRaw returned %d instead of 0. "
+            "[numVertices: %d] [numIndices: %d] [Error: %s]\n",
+            __func__, code, numVertices, numIndices, SDL_GetError());
+
+        exit(1);
+    }
+}
+
+SDL_Texture *Sdlu_CreateTexture(SDL_Renderer *renderer,
+    uint32_t format, int access, int w, int h)
+{
+    SDL_Texture *const texture = SDL_CreateTexture(renderer, format, access, w, h);
+
+    if (texture == NULL) {
+        fprintf(stderr, "%s: SDL_CreateTexture returned NULL. "
+            "[format: %u] [access: %d] [w: %d] [h: %d] [Error: %s]\n",
+            __func__, format, access, w, h, SDL_GetError());
+
+        exit(1);
+    }
+
+    return texture;
+}
+
+void Sdlu_SetTextureBlendMode(SDL_Texture *texture, SDL_BlendMode blendMode) {
+    const int code = SDL_SetTextureBlendMode(texture, blendMode);
+
+    if (code != 0) {
+        fprintf(stderr, "%s: SDL_SetTextureBlendMode returned %d instead of 0. "
+            "[blendMode: %d] [Error: %s]\n",
+            __func__, code, (int)blendMode, SDL_GetError());
+
+        exit(1);
+    }
+}
+
+void Sdlu_UpdateTexture(SDL_Texture *texture, const SDL_Rect *rect, const void *pixels, int pitch) {
+    const int code = SDL_UpdateTexture(texture, rect, pixels, pitch);
+
+    if (code != 0) {
+        fprintf(stderr, "%s: SDL_UpdateTexture returned %d instead of 0. "
+            "[pitch: %d] [Error: %s]\n",
+            __func__, code, pitch, SDL_GetError());
+
+        exit(1);
+    }
+}
+
+void Sdlu_RenderCopy(SDL_Renderer *renderer, SDL_Texture *texture,
+    const SDL_Rect *srcrect, const SDL_Rect *dstrect)
+{
+    const int code = SDL_RenderCopy(renderer, texture, srcrect, dstrect);
+
+    if (code != 0) {
+        fprintf(stderr, "%s: SDL_RenderCopy returned %d instead of 0. Error: %s\n",
+            __func__, code, SDL_GetError());
+
+        exit(1);
+    }
+}
+
 void Sdlu_SetRelativeMouseMode(SDL_bool enabled) {
     const int code = SDL_SetRelativeMouseMode(enabled);
 
@@ -80,6 +80,31 @@ void Sdlu_RenderDrawPoint(SDL_Renderer *renderer, int x, int y);
 // SDL_RenderDrawLine but, if error, print to `stderr` and exit.
 void Sdlu_RenderDrawLine(SDL_Renderer *renderer, int x1, int y1, int x2, int y2);
 
+// SDL_RenderGeometry but, if error, print to `stderr` and exit.
+// Requires SDL 2.0.18.
+void Sdlu_RenderGeometry(SDL_Renderer *renderer, SDL_Texture *texture,
+    const SDL_Vertex *vertices, int numVertices, const int *indices, int numIndices);
+
+// SDL_RenderGeometryRaw with `int` indices but, if error, print to `stderr` and exit.
+// `uv` may be NULL if `texture` is. Requires SDL 2.0.18.
+void Sdlu_RenderGeometryRaw(SDL_Renderer *renderer, SDL_Texture *texture,
+    const float *xy, int xyStride, const SDL_Color *color, int colorStride,
+    const float *uv, int uvStride, int numVertices, const int *indices, int numIndices);
+
+// SDL_CreateTexture but, if error, print to `stderr` and exit.
+SDL_Texture *Sdlu_CreateTexture(SDL_Renderer *renderer,
+    uint32_t format, int access, int w, int h);
+
+// SDL_SetTextureBlendMode but, if error, print to `stderr` and exit.
+void Sdlu_SetTextureBlendMode(SDL_Texture *texture, SDL_BlendMode blendMode);
+
+// SDL_UpdateTexture but, if error, print to `stderr` and exit.
+void Sdlu_UpdateTexture(SDL_Texture *texture, const SDL_Rect *rect, const void *pixels, int pitch);
+
+// SDL_RenderCopy but, if error, print to `stderr` and exit.
+void Sdlu_RenderCopy(SDL_Renderer *renderer, SDL_Texture *texture,
+    const SDL_Rect *srcrect, const SDL_Rect *dstrect);
+
 // SDL_SetRelativeMouseMode but, if error, print to `stderr` and exit.
 void Sdlu_SetRelativeMouseMode(SDL_bool enabled);
 
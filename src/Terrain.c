@@ -0,0 +1,525 @@
+#include "Terrain.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "Clock.h"
+#include "Mem.h"
+
+// Most tile requests made per frame for prefetching.
+#define TERRAIN_MAX_PREFETCHES_PER_FRAME 8
+
+// Floor division for possibly negative `a` and positive `b`.
+static inline int FloorDiv(const int a, const int b) {
+    return (a >= 0) ? a / b : -((-a + b - 1) / b);
+}
+
+static int Loader(void *arg) {
+    Terrain *const terrain = arg;
+
+    char path[1024];
+
+    while (true) {
+        mtx_lock(&terrain->queueMutex);
+
+        while (terrain->queueCount == 0 && !terrain->quit) {
+            cnd_wait(&terrain->queueCond, &terrain->queueMutex);
+        }
+
+        if (terrain->quit) {
+            mtx_unlock(&terrain->queueMutex);
+            break;
+        }
+
+        const int slot = terrain->queue[terrain->queueHead];
+        terrain->queueHead = (terrain->queueHead + 1) % terrain->numTiles;
+        terrain->queueCount -= 1;
+
+        mtx_unlock(&terrain->queueMutex);
+
+        Terrain_Tile *const tile = &terrain->tiles[slot];
+
+        snprintf(path, sizeof(path), "%s/tile_%d_%d.bin", terrain->dir, tile->tx, tile->ty);
+
+        const size_t numHeights = TERRAIN_TILE_SIZE * TERRAIN_TILE_SIZE;
+        size_t numRead = 0;
+
+        FILE *const file = fopen(path, "rb");
+
+        if (file != NULL) {
+            numRead = fread(tile->heights, sizeof(float), numHeights, file);
+            fclose(file);
+        }
+
+        const uint64_t loadNs = Clock_GetTimeNs() - tile->requestNs;
+        Terrain_Stats *const stats = &terrain->stats;
+
+        atomic_fetch_add_explicit(&stats->loads, 1, memory_order_relaxed);
+        atomic_fetch_add_explicit(&stats->totalLoadNs, loadNs, memory_order_relaxed);
+
+        uint64_t maxNs = atomic_load_explicit(&stats->maxLoadNs, memory_order_relaxed);
+        while (loadNs > maxNs
+            && !atomic_compare_exchange_weak_explicit(&stats->maxLoadNs, &maxNs, loadNs,
+                memory_order_relaxed, memory_order_relaxed))
+        {
+        }
+
+        if (numRead != numHeights) {
+            atomic_fetch_add_explicit(&stats->missingFiles, 1, memory_order_relaxed);
+            atomic_store_explicit(&tile->state, TERRAIN_TILE_MISSING, memory_order_release);
+        }
+        else {
+            atomic_store_explicit(&tile->state, TERRAIN_TILE_READY, memory_order_release);
+        }
+    }
+
+    return 0;
+}
+
+void Terrain_Init(Terrain *const terrain, const char *const dir,
+    const double cellWidth, const size_t budgetBytes)
+{
+    memset(terrain, 0, sizeof(*terrain));
+
+    snprintf(terrain->dir, sizeof(terrain->dir), "%s", dir);
+    terrain->cellWidth = cellWidth;
+
+    const size_t tileBytes = TERRAIN_TILE_SIZE * TERRAIN_TILE_SIZE * sizeof(float);
+    terrain->numTiles = budgetBytes / tileBytes;
+
+    // The largest window plus a margin for prefetching must fit.
+    const size_t tilesPerSide = TERRAIN_MAX_WINDOW / TERRAIN_TILE_SIZE + 2;
+    const size_t minTiles = 2 * tilesPerSide * tilesPerSide;
+
+    if (terrain->numTiles < minTiles) {
+        fprintf(stderr, "%s: Budget of %zu bytes raised to %zu bytes "
+            "to hold the largest window.\n",
+            __func__, budgetBytes, minTiles * tileBytes);
+
+        terrain->numTiles = minTiles;
+    }
+
+    terrain->tiles = Mem_AllocTagged(terrain->numTiles * sizeof(Terrain_Tile), MEM_TAG_TERRAIN);
+    terrain->heightBlock = Mem_AllocTagged(terrain->numTiles * tileBytes, MEM_TAG_TERRAIN);
+    terrain->queue = Mem_AllocTagged(terrain->numTiles * sizeof(int), MEM_TAG_TERRAIN);
+
+    for (size_t i = 0; i < terrain->numTiles; i += 1) {
+        Terrain_Tile *const tile = &terrain->tiles[i];
+
+        tile->tx = 0;
+        tile->ty = 0;
+        atomic_init(&tile->state, TERRAIN_TILE_EMPTY);
+        tile->lastUsedFrame = 0;
+        tile->requestNs = 0;
+        tile->heights = terrain->heightBlock + i * TERRAIN_TILE_SIZE * TERRAIN_TILE_SIZE;
+    }
+
+    const size_t windowSize = (size_t)TERRAIN_MAX_WINDOW * TERRAIN_MAX_WINDOW;
+    terrain->windowHeights = Mem_AllocTagged(windowSize * sizeof(float), MEM_TAG_TERRAIN);
+    terrain->windowX = Mem_AllocTagged(windowSize * sizeof(float), MEM_TAG_TERRAIN);
+    terrain->windowY = Mem_AllocTagged(windowSize * sizeof(float), MEM_TAG_TERRAIN);
+    terrain->windowDepth = Mem_AllocTagged(windowSize * sizeof(float), MEM_TAG_TERRAIN);
+
+    atomic_init(&terrain->stats.loads, 0);
+    atomic_init(&terrain->stats.missingFiles, 0);
+    atomic_init(&terrain->stats.totalLoadNs, 0);
+    atomic_init(&terrain->stats.maxLoadNs, 0);
+
+    if (mtx_init(&terrain->queueMutex, mtx_plain) != thrd_success
+        || cnd_init(&terrain->queueCond) != thrd_success
+        || thrd_create(&terrain->loader, Loader, terrain) != thrd_success)
+    {
+        fprintf(stderr, "%s: Failed to start loader thread\n", __func__);
+        exit(1);
+    }
+}
+
+void Terrain_Deinit(Terrain *const terrain) {
+    mtx_lock(&terrain->queueMutex);
+    terrain->quit = true;
+    cnd_signal(&terrain->queueCond);
+    mtx_unlock(&terrain->queueMutex);
+
+    thrd_join(terrain->loader, NULL);
+
+    cnd_destroy(&terrain->queueCond);
+    mtx_destroy(&terrain->queueMutex);
+
+    Mem_Free(terrain->windowDepth);
+    Mem_Free(terrain->windowY);
+    Mem_Free(terrain->windowX);
+    Mem_Free(terrain->windowHeights);
+    Mem_Free(terrain->queue);
+    Mem_Free(terrain->heightBlock);
+    Mem_Free(terrain->tiles);
+}
+
+size_t Terrain_MaxSegs(void) {
+    return 2 * (size_t)TERRAIN_MAX_WINDOW * TERRAIN_MAX_WINDOW;
+}
+
+// Return the slot holding tile (tx, ty) or -1.
+static int FindTile(const Terrain *const terrain, const int tx, const int ty) {
+    for (size_t i = 0; i < terrain->numTiles; i += 1) {
+        const Terrain_Tile *const tile = &terrain->tiles[i];
+
+        if (tile->tx == tx && tile->ty == ty
+            && atomic_load_explicit(&tile->state, memory_order_relaxed) != TERRAIN_TILE_EMPTY)
+        {
+            return (int)i;
+        }
+    }
+
+    return -1;
+}
+
+// Claim a slot for tile (tx, ty) and queue it for loading.
+// Prefer an empty slot, else evict the least recently used loaded tile
+// that was not used this frame. Return false if no slot is available.
+static bool RequestTile(Terrain *const terrain, const int tx, const int ty, const bool prefetch) {
+    int victim = -1;
+
+    for (size_t i = 0; i < terrain->numTiles; i += 1) {
+        const Terrain_Tile *const tile = &terrain->tiles[i];
+        const int state = atomic_load_explicit(&tile->state, memory_order_acquire);
+
+        if (state == TERRAIN_TILE_EMPTY) {
+            victim = (int)i;
+            break;
+        }
+
+        if (state == TERRAIN_TILE_QUEUED || tile->lastUsedFrame == terrain->frame) {
+            continue;
+        }
+
+        if (victim == -1 || tile->lastUsedFrame < terrain->tiles[victim].lastUsedFrame) {
+            victim = (int)i;
+        }
+    }
+
+    if (victim == -1) {
+        return false;
+    }
+
+    Terrain_Tile *const tile = &terrain->tiles[victim];
+
+    if (atomic_load_explicit(&tile->state, memory_order_relaxed) != TERRAIN_TILE_EMPTY) {
+        terrain->stats.evictions += 1;
+    }
+
+    tile->tx = tx;
+    tile->ty = ty;
+    tile->lastUsedFrame = terrain->frame;
+    tile->requestNs = Clock_GetTimeNs();
+    atomic_store_explicit(&tile->state, TERRAIN_TILE_QUEUED, memory_order_relaxed);
+
+    mtx_lock(&terrain->queueMutex);
+
+    // Each slot is queued at most once, so the queue never overflows.
+    if (prefetch) {
+        const size_t back = (terrain->queueHead + terrain->queueCount) % terrain->numTiles;
+        terrain->queue[back] = victim;
+    }
+    else {
+        terrain->queueHead = (terrain->queueHead + terrain->numTiles - 1) % terrain->numTiles;
+        terrain->queue[terrain->queueHead] = victim;
+    }
+
+    terrain->queueCount += 1;
+    cnd_signal(&terrain->queueCond);
+    mtx_unlock(&terrain->queueMutex);
+
+    if (prefetch) {
+        terrain->stats.prefetches += 1;
+    }
+    else {
+        terrain->stats.requests += 1;
+    }
+
+    return true;
+}
+
+// Return the number of cells from the window center to its edge for `view`.
+static int HalfCells(const Terrain *const terrain, const Ortho_View *const view) {
+    // Ground covered vertically grows as the camera looks more sideways.
+    const double tilt = fmax(fabs(view->lookForward.z), 0.1);
+    const double extent = fmax(view->projPlaneWidth, view->projPlaneHeight / tilt);
+    const double half = ceil(0.5 * extent / terrain->cellWidth) + 1.0;
+
+    return (half > TERRAIN_MAX_HALF_CELLS) ? TERRAIN_MAX_HALF_CELLS : (int)half;
+}
+
+// Request tiles around `center` that are not in the cache, as prefetches.
+static void Prefetch(Terrain *const terrain, const V3d center, const int half) {
+    const int ci = (int)floor(center.x / terrain->cellWidth);
+    const int cj = (int)floor(center.y / terrain->cellWidth);
+
+    const int tx0 = FloorDiv(ci - half, TERRAIN_TILE_SIZE);
+    const int tx1 = FloorDiv(ci + half, TERRAIN_TILE_SIZE);
+    const int ty0 = FloorDiv(cj - half, TERRAIN_TILE_SIZE);
+    const int ty1 = FloorDiv(cj + half, TERRAIN_TILE_SIZE);
+
+    int numRequested = 0;
+
+    for (int ty = ty0; ty <= ty1; ty += 1) {
+        for (int tx = tx0; tx <= tx1; tx += 1) {
+            if (numRequested == TERRAIN_MAX_PREFETCHES_PER_FRAME) {
+                return;
+            }
+
+            if (FindTile(terrain, tx, ty) == -1) {
+                if (!RequestTile(terrain, tx, ty, true)) {
+                    return;
+                }
+
+                numRequested += 1;
+            }
+        }
+    }
+}
+
+// Copy the heights of window vertices [i0, i0 + n) x [j0, j0 + n) from the cache.
+static void GatherHeights(Terrain *const terrain, const int i0, const int j0, const int n) {
+    const int tx0 = FloorDiv(i0, TERRAIN_TILE_SIZE);
+    const int tx1 = FloorDiv(i0 + n - 1, TERRAIN_TILE_SIZE);
+    const int ty0 = FloorDiv(j0, TERRAIN_TILE_SIZE);
+    const int ty1 = FloorDiv(j0 + n - 1, TERRAIN_TILE_SIZE);
+
+    for (int ty = ty0; ty <= ty1; ty += 1) {
+        for (int tx = tx0; tx <= tx1; tx += 1) {
+            // Part of the window covered by this tile.
+            const int iBegin = (tx * TERRAIN_TILE_SIZE > i0) ? tx * TERRAIN_TILE_SIZE : i0;
+            const int iEnd = ((tx + 1) * TERRAIN_TILE_SIZE < i0 + n) ? (tx + 1) * TERRAIN_TILE_SIZE : i0 + n;
+            const int jBegin = (ty * TERRAIN_TILE_SIZE > j0) ? ty * TERRAIN_TILE_SIZE : j0;
+            const int jEnd = ((ty + 1) * TERRAIN_TILE_SIZE < j0 + n) ? (ty + 1) * TERRAIN_TILE_SIZE : j0 + n;
+
+            terrain->stats.lookups += 1;
+
+            const int slot = FindTile(terrain, tx, ty);
+            int state = TERRAIN_TILE_EMPTY;
+
+            if (slot != -1) {
+                terrain->tiles[slot].lastUsedFrame = terrain->frame;
+                state = atomic_load_explicit(&terrain->tiles[slot].state, memory_order_acquire);
+            }
+            else {
+                RequestTile(terrain, tx, ty, false);
+            }
+
+            if (state == TERRAIN_TILE_READY || state == TERRAIN_TILE_MISSING) {
+                terrain->stats.hits += 1;
+            }
+
+            for (int j = jBegin; j < jEnd; j += 1) {
+                float *const dst = terrain->windowHeights + (size_t)(j - j0) * (size_t)n + (size_t)(iBegin - i0);
+                const size_t count = (size_t)(iEnd - iBegin);
+
+                if (state == TERRAIN_TILE_READY) {
+                    const float *const src = terrain->tiles[slot].heights
+                        + (size_t)(j - ty * TERRAIN_TILE_SIZE) * TERRAIN_TILE_SIZE
+                        + (size_t)(iBegin - tx * TERRAIN_TILE_SIZE);
+
+                    memcpy(dst, src, count * sizeof(float));
+                }
+                else {
+                    const float fill = (state == TERRAIN_TILE_MISSING) ? 0.0f : NAN;
+
+                    for (size_t k = 0; k < count; k += 1) {
+                        dst[k] = fill;
+                    }
+                }
+            }
+        }
+    }
+}
+
+// Push the segment between window vertices a and b if both are loaded and in front.
+static inline void PushEdge(const Terrain *const terrain, const Ortho_View *const view,
+    const size_t a, const size_t b, Lines *const lines)
+{
+    if (isnan(terrain->windowHeights[b]) || terrain->windowDepth[b] <= 0.0f) {
+        return;
+    }
+
+    Lines_Seg seg = {
+        terrain->windowX[a], terrain->windowY[a],
+        terrain->windowX[b], terrain->windowY[b]
+    };
+
+    if (Lines_Clip(&seg, view->screenWidth, view->screenHeight)) {
+        Lines_Push(lines, seg);
+    }
+}
+
+int Terrain_Prepare(Terrain *const terrain, const Ortho_View *const view, const V3d center) {
+    terrain->frame += 1;
+
+    const int half = HalfCells(terrain, view);
+    const int n = 2 * half + 1;
+    const int i0 = (int)floor(center.x / terrain->cellWidth) - half;
+    const int j0 = (int)floor(center.y / terrain->cellWidth) - half;
+
+    terrain->windowI0 = i0;
+    terrain->windowJ0 = j0;
+    terrain->windowN = n;
+
+    GatherHeights(terrain, i0, j0, n);
+
+    // Look ahead along the motion of the window.
+    if (terrain->hasPrevCenter) {
+        const V3d velocity = V3d_Sub(center, terrain->prevCenter);
+
+        if (velocity.x != 0.0 || velocity.y != 0.0) {
+            Prefetch(terrain, V3d_Add(center, V3d_Mul(velocity, TERRAIN_PREFETCH_FRAMES)), half);
+        }
+    }
+
+    terrain->prevCenter = center;
+    terrain->hasPrevCenter = true;
+
+    return n;
+}
+
+void Terrain_ProjectRows(Terrain *const terrain, const Ortho_View *const view,
+    const size_t begin, const size_t end)
+{
+    const int n = terrain->windowN;
+    const int i0 = terrain->windowI0;
+    const int j0 = terrain->windowJ0;
+
+    // Along a row only the height term is not a plain step.
+    const double cw = terrain->cellWidth;
+    const V3d stepX = Ortho_ProjectOffset(view, (V3d) {cw, 0.0, 0.0});
+    const V3d down = view->axisZ; // Per unit of world z. Height is -z.
+
+    for (size_t j = begin; j < end; j += 1) {
+        const V3d rowStart = Ortho_Project(view, (V3d) {i0 * cw, (j0 + (int)j) * cw, 0.0});
+        const size_t row = j * (size_t)n;
+
+        for (int i = 0; i < n; i += 1) {
+            const double h = terrain->windowHeights[row + (size_t)i];
+
+            terrain->windowX[row + (size_t)i] = (float)(rowStart.x + i * stepX.x - h * down.x);
+            terrain->windowY[row + (size_t)i] = (float)(rowStart.y + i * stepX.y - h * down.y);
+            terrain->windowDepth[row + (size_t)i] = (float)(rowStart.z + i * stepX.z - h * down.z);
+        }
+    }
+}
+
+void Terrain_EmitRows(const Terrain *const terrain, const Ortho_View *const view,
+    const size_t begin, const size_t end, Lines *const lines)
+{
+    const int n = terrain->windowN;
+
+    // Lines to the next vertex along x and along y.
+    for (size_t j = begin; j < end; j += 1) {
+        for (int i = 0; i < n; i += 1) {
+            const size_t a = j * (size_t)n + (size_t)i;
+
+            if (isnan(terrain->windowHeights[a]) || terrain->windowDepth[a] <= 0.0f) {
+                continue;
+            }
+
+            if (i + 1 < n) {
+                PushEdge(terrain, view, a, a + 1, lines);
+            }
+
+            if (j + 1 < (size_t)n) {
+                PushEdge(terrain, view, a, a + (size_t)n, lines);
+            }
+        }
+    }
+}
+
+void Terrain_Emit(Terrain *const terrain, const Ortho_View *const view,
+    const V3d center, Lines *const lines)
+{
+    const size_t n = (size_t)Terrain_Prepare(terrain, view, center);
+
+    Terrain_ProjectRows(terrain, view, 0, n);
+    Terrain_EmitRows(terrain, view, 0, n, lines);
+}
+
+typedef struct RowsJob {
+    Terrain *terrain;
+    const Ortho_View *view;
+    Rgba color;
+    Lines *chunkLines;
+} RowsJob;
+
+static void ProjectChunk(void *ctx, size_t chunk, size_t begin, size_t end) {
+    const RowsJob *const job = ctx;
+    (void)chunk;
+
+    Terrain_ProjectRows(job->terrain, job->view, begin, end);
+}
+
+static void EmitChunk(void *ctx, size_t chunk, size_t begin, size_t end) {
+    const RowsJob *const job = ctx;
+    Lines *const lines = &job->chunkLines[chunk];
+
+    Lines_Clear(lines);
+    Lines_SetColor(lines, job->color);
+    Terrain_EmitRows(job->terrain, job->view, begin, end, lines);
+}
+
+static size_t RowsPerChunk(const size_t numRows, const size_t numChunks) {
+    const size_t size = (numRows + numChunks - 1) / numChunks;
+    return (size == 0) ? 1 : size;
+}
+
+size_t Terrain_MaxSegsPerChunk(const size_t numChunks) {
+    return RowsPerChunk(TERRAIN_MAX_WINDOW, numChunks) * 2 * TERRAIN_MAX_WINDOW;
+}
+
+void Terrain_EmitParallel(Terrain *const terrain, const Ortho_View *const view,
+    const V3d center, const Rgba color,
+    Jobs *const jobs, Lines *const chunkLines, const size_t numChunks,
+    Lines *const lines)
+{
+    const size_t n = (size_t)Terrain_Prepare(terrain, view, center);
+    const size_t chunkSize = RowsPerChunk(n, numChunks);
+
+    RowsJob job = {
+        .terrain = terrain,
+        .view = view,
+        .color = color,
+        .chunkLines = chunkLines
+    };
+
+    Jobs_Counter counter;
+    Jobs_InitCounter(&counter);
+
+    // Emitting a row needs the next row projected, so finish projecting first.
+    Jobs_ParallelFor(jobs, &counter, n, chunkSize, ProjectChunk, &job);
+    Jobs_Wait(jobs, &counter);
+
+    Jobs_ParallelFor(jobs, &counter, n, chunkSize, EmitChunk, &job);
+    Jobs_Wait(jobs, &counter);
+
+    for (size_t k = 0; k < Jobs_NumChunks(n, chunkSize); k += 1) {
+        Lines_Append(lines, &chunkLines[k]);
+    }
+}
+
+void Terrain_PrintStats(const Terrain *const terrain, FILE *const file) {
+    const Terrain_Stats *const s = &terrain->stats;
+
+    const uint64_t loads = atomic_load_explicit(&s->loads, memory_order_relaxed);
+    const uint64_t totalNs = atomic_load_explicit(&s->totalLoadNs, memory_order_relaxed);
+    const uint64_t maxNs = atomic_load_explicit(&s->maxLoadNs, memory_order_relaxed);
+
+    fprintf(file, "Heightfield tile cache (%zu tiles of %d x %d):\n",
+        terrain->numTiles, TERRAIN_TILE_SIZE, TERRAIN_TILE_SIZE);
+    fprintf(file, "  lookups %llu  hits %llu  hit rate %.1f%%\n",
+        (unsigned long long)s->lookups, (unsigned long long)s->hits,
+        (s->lookups == 0) ? 0.0 : 100.0 * (double)s->hits / (double)s->lookups);
+    fprintf(file, "  requests %llu  prefetches %llu  evictions %llu\n",
+        (unsigned long long)s->requests, (unsigned long long)s->prefetches,
+        (unsigned long long)s->evictions);
+    fprintf(file, "  loads %llu (missing files %llu)  latency avg %.3f ms  max %.3f ms\n",
+        (unsigned long long)loads,
+        (unsigned long long)atomic_load_explicit(&s->missingFiles, memory_order_relaxed),
+        (loads == 0) ? 0.0 : (double)totalNs / (double)loads / 1e6,
+        (double)maxNs / 1e6);
+}
@@ -0,0 +1,161 @@
+#ifndef TERRAIN_H
+#define TERRAIN_H
+
+// Heightfield drawn as a wireframe grid, streamed from tiled files on disk.
+//
+// The heightfield is a lattice of vertices `cellWidth` apart on the xy plane.
+// Vertex (i, j) sits at world (i * cellWidth, j * cellWidth, -height).
+// Tiles of TERRAIN_TILE_SIZE x TERRAIN_TILE_SIZE vertices are stored as files
+//  <dir>/tile_<tx>_<ty>.bin
+// holding the heights as little-endian float32, row by row (j major).
+// Tile (tx, ty) holds vertices i in [tx * TERRAIN_TILE_SIZE, (tx + 1) * TERRAIN_TILE_SIZE)
+// and likewise for j. A missing file is a flat tile.
+//
+// Tiles are read on a loader thread into an LRU cache with a fixed memory budget.
+// Tiles in the direction the view is moving are prefetched.
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <threads.h>
+
+#include "Jobs.h"
+#include "Lines.h"
+#include "Ortho.h"
+#include "V3d.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Vertices along each side of a tile.
+#define TERRAIN_TILE_SIZE 128
+
+// The drawn window of vertices extends at most this many cells from its center.
+#define TERRAIN_MAX_HALF_CELLS 256
+
+// Vertices along each side of the largest window.
+#define TERRAIN_MAX_WINDOW (2 * TERRAIN_MAX_HALF_CELLS + 1)
+
+// Number of frames of motion to look ahead when prefetching.
+#define TERRAIN_PREFETCH_FRAMES 30
+
+typedef enum Terrain_TileState {
+    TERRAIN_TILE_EMPTY,   // Slot holds nothing.
+    TERRAIN_TILE_QUEUED,  // Waiting for the loader. Not evictable.
+    TERRAIN_TILE_READY,   // Heights are valid.
+    TERRAIN_TILE_MISSING  // No file. Treated as flat.
+} Terrain_TileState;
+
+// One cache slot.
+typedef struct Terrain_Tile {
+    int32_t tx;
+    int32_t ty;
+    atomic_int state;        // Terrain_TileState. Written by loader, read by frame thread.
+    uint64_t lastUsedFrame;  // For LRU eviction.
+    uint64_t requestNs;      // When the load was requested.
+    float *heights;          // TERRAIN_TILE_SIZE * TERRAIN_TILE_SIZE.
+} Terrain_Tile;
+
+typedef struct Terrain_Stats {
+    uint64_t lookups;  // Tile lookups made while drawing.
+    uint64_t hits;     // Lookups that found the tile loaded.
+    uint64_t requests; // Loads requested because a tile was needed.
+    uint64_t prefetches;
+    uint64_t evictions;
+
+    // Updated by the loader thread.
+    atomic_uint_fast64_t loads;
+    atomic_uint_fast64_t missingFiles;
+    atomic_uint_fast64_t totalLoadNs; // From request to ready.
+    atomic_uint_fast64_t maxLoadNs;
+} Terrain_Stats;
+
+typedef struct Terrain {
+    char dir[512];
+    double cellWidth;
+
+    Terrain_Tile *tiles;
+    size_t numTiles;
+    float *heightBlock; // Storage for all tiles' heights.
+
+    // Slot indices waiting for the loader. Demand loads go to the front,
+    // prefetches to the back.
+    int *queue;
+    size_t queueHead;
+    size_t queueCount;
+    mtx_t queueMutex;
+    cnd_t queueCond;
+    bool quit;
+    thrd_t loader;
+
+    uint64_t frame;
+    bool hasPrevCenter;
+    V3d prevCenter;
+
+    // Window of vertices drawn this frame: [windowI0, windowI0 + windowN) along x
+    // and likewise along y, stored row by row.
+    int windowI0;
+    int windowJ0;
+    int windowN;
+
+    // Per-frame scratch for the drawn window of vertices.
+    float *windowHeights;   // NAN where the tile is not loaded yet.
+    float *windowX;         // Projected pixel x.
+    float *windowY;         // Projected pixel y.
+    float *windowDepth;
+
+    Terrain_Stats stats;
+} Terrain;
+
+// Set up the cache with room for `budgetBytes` of tiles and start the loader thread.
+// Tiles are read from directory `dir`. If error, print to `stderr` and exit.
+void Terrain_Init(Terrain *const terrain, const char *const dir,
+    const double cellWidth, const size_t budgetBytes);
+
+// Stop the loader thread and free everything.
+void Terrain_Deinit(Terrain *const terrain);
+
+// Return the number of segments `Terrain_Emit` can append at most.
+size_t Terrain_MaxSegs(void);
+
+// Choose the window of vertices around `center` (a point on the z = 0 plane)
+// to cover about what `view` can see, and copy its heights out of the cache.
+// Request tiles that are missing and prefetch along the motion of `center`.
+// Does not block on loads. Unloaded parts are left out until they arrive.
+// Return the number of rows in the window.
+// Call from one thread. Then call the row functions below, which may run in parallel.
+int Terrain_Prepare(Terrain *const terrain, const Ortho_View *const view, const V3d center);
+
+// Project the vertices of window rows [begin, end).
+void Terrain_ProjectRows(Terrain *const terrain, const Ortho_View *const view,
+    const size_t begin, const size_t end);
+
+// Append the segments starting in window rows [begin, end) to `lines`
+// using its current color. All rows must have been projected.
+void Terrain_EmitRows(const Terrain *const terrain, const Ortho_View *const view,
+    const size_t begin, const size_t end, Lines *const lines);
+
+// Prepare, project and emit the whole window on the calling thread.
+void Terrain_Emit(Terrain *const terrain, const Ortho_View *const view,
+    const V3d center, Lines *const lines);
+
+// Like `Terrain_Emit` but project and emit rows in up to `numChunks` chunks on `jobs`.
+// Chunk k writes to `chunkLines[k]` using `color`. Those are then appended to `lines` in order.
+void Terrain_EmitParallel(Terrain *const terrain, const Ortho_View *const view,
+    const V3d center, const Rgba color,
+    Jobs *const jobs, Lines *const chunkLines, const size_t numChunks,
+    Lines *const lines);
+
+// Return the most segments one chunk of `Terrain_EmitParallel` can produce.
+size_t Terrain_MaxSegsPerChunk(const size_t numChunks);
+
+// Print cache hit rate and load latency.
+void Terrain_PrintStats(const Terrain *const terrain, FILE *const file);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif